@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Builds a large, valid Pudl program for the benchmarks in this directory:
+ * aFunctions functions, each with a couple of arguments, comments,
+ * indentation, declarations, a while loop and arithmetic -- roughly the
+ * shape (and token mix) of the machine-generated sources that motivated
+ * them -- plus a `mast` that calls the last one so the program is complete.
+ *
+ * aSparse makes the same program mostly whitespace and comments: a banner
+ * comment block per function and deep, tab-and-space indentation, the way
+ * code generators that pretty-print their output tend to look. Lexing it
+ * is dominated by skipping rather than by tokens.
+ */
+inline std::string GenerateSource(std::size_t aFunctions, bool aSparse = false) {
+    std::string source;
+    source.reserve(aFunctions * (aSparse ? 1600 : 400));
+
+    for (std::size_t i = 0; i < aFunctions; i++) {
+        std::string name = "function" + std::to_string(i);
+        if (aSparse) {
+            source += "#######################################################################\n";
+            source += "#\n";
+            source += "#   " + name + "\n";
+            source += "#\n";
+            source += "#   Generated. Sums a little series; see the generator's input for the\n";
+            source += "#   parameters it was built from. Do not edit by hand.\n";
+            source += "#\n";
+            source += "#######################################################################\n\n";
+        }
+        source += "# " + name + ": generated, sums a little series\n";
+        source += "func " + name + "( int count, int step ) : int {\n";
+        source += "  # running total and loop counter\n";
+        source += "  int total = 0\n";
+        source += "  int index = 0\n";
+        source += "  float scale = 1.5\n";
+        source += "  while index < count && total >= 0 {\n";
+        source += "    total = total + index * step - ( index / 2 )\n";
+        source += "    index = index + 1\n";
+        source += "  }\n";
+        source += "  if total == 0 || step != 1 {\n";
+        source += "    return total + 42\n";
+        source += "  }\n";
+        source += "  return total\n";
+        source += "}\n\n";
+    }
+
+    if (aSparse) {
+        // Re-indent every code line (comments stay in column 1): a tab,
+        // then four times its original indentation, plus trailing blanks.
+        std::string sparse;
+        sparse.reserve(source.size() * 2);
+        std::size_t lineBegin = 0;
+        while (lineBegin < source.size()) {
+            std::size_t lineEnd = source.find('\n', lineBegin);
+            std::size_t indent = source.find_first_not_of(' ', lineBegin);
+            if (lineEnd != indent && source[indent] != '#') {
+                sparse += '\t';
+                sparse.append((indent - lineBegin) * 4, ' ');
+            }
+            sparse.append(source, indent, lineEnd - indent);
+            sparse += "    \n";
+            lineBegin = lineEnd + 1;
+        }
+        source = std::move(sparse);
+    }
+
+    source += "func mast : int {\n";
+    source += "  print function" + std::to_string(aFunctions - 1) + "( 10, 2 )\n";
+    source += "  return 0\n";
+    source += "}\n";
+    return source;
+}
+
+/**
+ * A program whose `mast` computes one expression of aTerms integer
+ * literals chained by `+`, `-` and (every fourth term) `*` -- the shape of
+ * generated code that unrolls a long computation into a single expression.
+ * Used to check that parsing and codegen handle chains far longer than
+ * any call stack could nest.
+ */
+inline std::string GenerateExpressionChain(std::size_t aTerms) {
+    static const char *const operators[] = {" + ", " - ", " + ", " * "};
+
+    std::string source;
+    source.reserve(aTerms * 8 + 64);
+    source += "func mast : int {\n";
+    source += "  int x = 1";
+    for (std::size_t i = 1; i < aTerms; i++) {
+        source += operators[i % 4];
+        source += std::to_string(i % 10);
+    }
+    source += "\n";
+    source += "  print x\n";
+    source += "  return 0\n";
+    source += "}\n";
+    return source;
+}
+
+/**
+ * Like GenerateExpressionChain(), but aTerms `True`/`False` literals
+ * chained by aOperator (" && " or " || ") alone -- the short-circuit
+ * operators, which Codegen branches on rather than evaluating both sides,
+ * so they take a different path through it.
+ */
+inline std::string GenerateLogicalChain(std::size_t aTerms, const char *aOperator) {
+    std::string source;
+    source.reserve(aTerms * 10 + 64);
+    source += "func mast : int {\n";
+    source += "  bool x = True";
+    for (std::size_t i = 1; i < aTerms; i++) {
+        source += aOperator;
+        source += i % 3 == 0 ? "False" : "True";
+    }
+    source += "\n";
+    source += "  print x\n";
+    source += "  return 0\n";
+    source += "}\n";
+    return source;
+}
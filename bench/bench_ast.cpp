@@ -0,0 +1,163 @@
+// AST memory benchmark: parse a large generated program (default 20000
+// functions, see SourceGenerator.h) and report how long parsing takes, how
+// much memory the parsed program holds per source line, and how long
+// tearing it down takes -- once into a tree of Nodes, once into a FlatAST.
+//
+// "Held" is every heap byte allocated while parsing and still allocated
+// afterwards -- the nodes themselves, but also anything a node owns on the
+// side (a name's std::string, a child list's std::vector), which the
+// Arena's own figure alone wouldn't show. It's counted by this program's
+// own operator new/delete below. "Nodes" is the representation's own
+// figure: the Arena's bytes, or the FlatAST's arrays. Teardown is
+// destroying the Parser, and with it every node.
+//
+// Then the same program as an AST file (--emit-ast, see ASTFile.h): its
+// size, and how long loading it takes against parsing the source -- as a
+// FlatAST, and as a tree of Nodes built from one.
+//
+// Build (off by default -- see CMakeLists.txt):
+//   cmake -S . -B build -G Ninja -DPUDL_ENABLE_BENCHMARKS=ON
+//   cmake --build build --target pudl_bench_ast
+//   ./build/pudl_bench_ast [functions]   # default 20000
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "Parser/ASTFile.h"
+#include "Parser/Parser.h"
+#include "SourceGenerator.h"
+
+static std::size_t liveBytes = 0;
+
+// In front of every allocation, so operator delete knows its size.
+static constexpr std::size_t Header = alignof(std::max_align_t);
+
+void *operator new(std::size_t aSize) {
+    void *block = std::malloc(aSize + Header);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t *>(block) = aSize;
+    liveBytes += aSize;
+    return static_cast<std::byte *>(block) + Header;
+}
+
+void operator delete(void *aPtr) noexcept {
+    if (aPtr == nullptr) {
+        return;
+    }
+    void *block = static_cast<std::byte *>(aPtr) - Header;
+    liveBytes -= *static_cast<std::size_t *>(block);
+    std::free(block);
+}
+
+void *operator new[](std::size_t aSize) { return operator new(aSize); }
+
+void operator delete[](void *aPtr) noexcept { operator delete(aPtr); }
+
+void operator delete(void *aPtr, std::size_t) noexcept { operator delete(aPtr); }
+
+void operator delete[](void *aPtr, std::size_t) noexcept { operator delete(aPtr); }
+
+// Parses aSource with a fresh ParserType, three times, and reports the
+// best parse and teardown times of the three. aNodeBytes gives the bytes
+// the parsed program's representation itself takes.
+template<typename ParserType, typename NodeBytes>
+static int report(const char *aName, const std::string &aSource, std::size_t aLines, NodeBytes aNodeBytes) {
+    double parseSeconds = 0;
+    double teardownSeconds = 0;
+    std::size_t held = 0;
+    std::size_t nodeBytes = 0;
+    for (int run = 0; run < 3; run++) {
+        auto parser = std::make_unique<ParserType>();
+        std::size_t before = liveBytes;
+        auto start = std::chrono::steady_clock::now();
+        auto root = parser->parse(llvm::MemoryBuffer::getMemBuffer(aSource));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (root == nullptr || parser->isFailed()) {
+            std::fprintf(stderr, "generated source failed to parse\n");
+            return 1;
+        }
+        parseSeconds = run == 0 ? seconds : std::min(parseSeconds, seconds);
+        held = liveBytes - before;
+        nodeBytes = aNodeBytes(*parser);
+
+        start = std::chrono::steady_clock::now();
+        parser.reset();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        teardownSeconds = run == 0 ? seconds : std::min(teardownSeconds, seconds);
+    }
+
+    std::printf("%s\n", aName);
+    std::printf("  parse:    %.1f ms, %.1f ns per line, %.1f MB/s\n", parseSeconds * 1e3,
+                parseSeconds * 1e9 / aLines, aSource.size() / 1e6 / parseSeconds);
+    std::printf("  held:     %.1f MB, %.1f bytes per line\n", held / 1e6, double(held) / aLines);
+    std::printf("  nodes:    %.1f MB, %.1f bytes per line\n", nodeBytes / 1e6, double(nodeBytes) / aLines);
+    std::printf("  teardown: %.2f ms\n", teardownSeconds * 1e3);
+    return 0;
+}
+
+// Writes the program aParser parsed to an AST file in memory, then loads
+// it three times (building a tree from it each time, too) and reports the
+// best times of the three.
+static int reportFile(const FlatParser &aParser, FlatNode aRoot, std::size_t aLines) {
+    std::string file;
+    llvm::raw_string_ostream out(file);
+    ASTFile::Write(aParser.getBuilder().getAST(), aRoot.getIndex(), out);
+    out.flush();
+
+    double loadSeconds = 0;
+    double treeSeconds = 0;
+    for (int run = 0; run < 3; run++) {
+        ASTFile astFile;
+        auto start = std::chrono::steady_clock::now();
+        if (astFile.load(llvm::MemoryBuffer::getMemBuffer(file, "generated.pudlast", false)) != 0) {
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        loadSeconds = run == 0 ? seconds : std::min(loadSeconds, seconds);
+
+        TreeBuilder builder;
+        start = std::chrono::steady_clock::now();
+        astFile.buildTree(builder);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        treeSeconds = run == 0 ? seconds : std::min(treeSeconds, seconds);
+    }
+
+    std::printf("AST file (--emit-ast, ASTFile.h):\n");
+    std::printf("  size:     %.1f MB, %.1f bytes per line\n", file.size() / 1e6, double(file.size()) / aLines);
+    std::printf("  load:     %.1f ms, %.1f ns per line (flat)\n", loadSeconds * 1e3, loadSeconds * 1e9 / aLines);
+    std::printf("  tree:     %.1f ms more, %.1f ns per line\n", treeSeconds * 1e3, treeSeconds * 1e9 / aLines);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::string source = GenerateSource(functions);
+    std::size_t lines = std::count(source.begin(), source.end(), '\n');
+
+    std::printf("source: %zu functions, %zu lines, %.1f MB\n", functions, lines, source.size() / 1e6);
+    if (report<Parser>("tree (--ast=tree, Arena.h):", source, lines, [](const Parser &aParser) {
+        return aParser.getBuilder().getArena().getBytesUsed();
+    }) != 0) {
+        return 1;
+    }
+    if (report<FlatParser>("flat (--ast=flat, FlatAST.h):", source, lines, [](const FlatParser &aParser) {
+        return aParser.getBuilder().getAST().getBytesUsed();
+    }) != 0) {
+        return 1;
+    }
+
+    FlatParser parser;
+    FlatNode root = parser.parse(llvm::MemoryBuffer::getMemBuffer(source));
+    if (root == nullptr || parser.isFailed()) {
+        std::fprintf(stderr, "generated source failed to parse\n");
+        return 1;
+    }
+    return reportFile(parser, root, lines);
+}
@@ -0,0 +1,269 @@
+// Codegen traversal benchmark: how long generating (unoptimized) IR for a
+// parsed program takes as the program grows -- generated programs of
+// 1000, 4000, 16000 and 64000 functions by default (see
+// SourceGenerator.h), or the sizes given on the command line.
+//
+// Only the walk over an already-parsed AST is timed, best of three, each
+// into a fresh Codegen: no parsing, no optimization, no machine code --
+// for a tree of Nodes and for the same program as a FlatAST (--ast=flat),
+// each dispatched with a switch per node, as Codegen does. Most of that is
+// LLVM building IR, so the same walks are also timed with a visitor that
+// only touches what Codegen reads from each node (its children and names)
+// -- the traversal's own cost.
+// Time per source line should stay flat as the program grows; a
+// traversal that copies what it visits (a child list, a name) shows up
+// as a higher constant, one that does something per node that depends on
+// the program's size as a rising one.
+//
+// Build (off by default -- see CMakeLists.txt):
+//   cmake -S . -B build -G Ninja -DPUDL_ENABLE_BENCHMARKS=ON
+//   cmake --build build --target pudl_bench_codegen
+//   ./build/pudl_bench_codegen [functions...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "Parser/Codegen.h"
+#include "Parser/Parser.h"
+#include "SourceGenerator.h"
+
+// Visits everything Codegen would, reading what it reads, and nothing else.
+// The visit()s that walk children stay out of line (see StaticVisitor.h).
+class Walker : public StaticVisitor<Walker> {
+public:
+    std::size_t nodes = 0;
+    std::size_t nameBytes = 0;
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(VectorNode &aNode) {
+        nodes++;
+        for (Node *node: aNode.getNodes()) {
+            dispatch(node);
+        }
+    }
+
+    void visit(DummyNode &aNode) { nodes++; }
+
+    void visit(VarNode &aNode) {
+        nodes++;
+        nameBytes += aNode.getName().size();
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(FuncallNode &aNode) {
+        nodes++;
+        nameBytes += aNode.getName().size();
+        for (ExpressionNode *arg: aNode.getArgs()) {
+            dispatch(arg);
+        }
+    }
+
+    void visit(BooleanNode &aNode) { nodes++; }
+
+    void visit(IntegerNode &aNode) { nodes++; }
+
+    void visit(FloatNode &aNode) { nodes++; }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(BinaryNode &aNode) {
+        nodes++;
+        dispatch(aNode.getLHS());
+        dispatch(aNode.getRHS());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(UnaryNode &aNode) {
+        nodes++;
+        dispatch(aNode.getSubexpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(AssignmentNode &aNode) {
+        nodes++;
+        nameBytes += aNode.getLHS()->getName().size();
+        dispatch(aNode.getRHS());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(FunctionDefNode &aNode) {
+        nodes++;
+        nameBytes += aNode.getName().size();
+        for (VarNode *arg: aNode.getArgs()) {
+            dispatch(arg);
+        }
+        dispatch(aNode.getBody());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(BlockStatementNode &aNode) {
+        nodes++;
+        for (StatementNode *statement: aNode.getStatements()) {
+            dispatch(statement);
+        }
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(IfStatementNode &aNode) {
+        nodes++;
+        dispatch(aNode.getCond());
+        dispatch(aNode.getTrueBranch());
+        if (aNode.getFalseBranch() != nullptr) {
+            dispatch(aNode.getFalseBranch());
+        }
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(WhileStatementNode &aNode) {
+        nodes++;
+        dispatch(aNode.getCond());
+        dispatch(aNode.getBody());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(DoWhileStatementNode &aNode) {
+        nodes++;
+        dispatch(aNode.getBody());
+        dispatch(aNode.getCond());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(ExpressionWrapperNode &aNode) {
+        nodes++;
+        dispatch(aNode.getExpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(IoPrintNode &aNode) {
+        nodes++;
+        dispatch(aNode.getSubexpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(ReturnNode &aNode) {
+        nodes++;
+        dispatch(aNode.getSubexpr());
+    }
+
+    // The same walk over a FlatAST, the way Codegen::generate(FlatNode)
+    // makes it.
+    void walk(FlatNode aNode) {
+        nodes++;
+        switch (aNode->getKind()) {
+            case NodeKind::Vector:
+                for (FlatNode node: aNode->getNodes()) {
+                    walk(node);
+                }
+                break;
+            case NodeKind::Var:
+                nameBytes += aNode->getName().size();
+                break;
+            case NodeKind::Funcall:
+                nameBytes += aNode->getName().size();
+                for (FlatNode arg: aNode->getArgs()) {
+                    walk(arg);
+                }
+                break;
+            case NodeKind::Binary:
+                walk(aNode->getLHS());
+                walk(aNode->getRHS());
+                break;
+            case NodeKind::Unary:
+            case NodeKind::IoPrint:
+            case NodeKind::Return:
+                walk(aNode->getSubexpr());
+                break;
+            case NodeKind::ExpressionWrapper:
+                walk(aNode->getExpr());
+                break;
+            case NodeKind::Assignment:
+                nameBytes += aNode->getLHS()->getName().size();
+                walk(aNode->getRHS());
+                break;
+            case NodeKind::FunctionDef:
+                nameBytes += aNode->getName().size();
+                for (FlatNode arg: aNode->getArgs()) {
+                    walk(arg);
+                }
+                walk(aNode->getBody());
+                break;
+            case NodeKind::BlockStatement:
+                for (FlatNode statement: aNode->getStatements()) {
+                    walk(statement);
+                }
+                break;
+            case NodeKind::IfStatement:
+                walk(aNode->getCond());
+                walk(aNode->getTrueBranch());
+                if (aNode->getFalseBranch() != nullptr) {
+                    walk(aNode->getFalseBranch());
+                }
+                break;
+            case NodeKind::WhileStatement:
+                walk(aNode->getCond());
+                walk(aNode->getBody());
+                break;
+            case NodeKind::DoWhileStatement:
+                walk(aNode->getBody());
+                walk(aNode->getCond());
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// Best of three runs of aRun (a walk with a Visitor), in seconds. Each run
+// gets a fresh Visitor, constructed, handed to aAfter and destroyed
+// outside the timing.
+template<typename Visitor, typename Run, typename After>
+static double best(Run aRun, After aAfter) {
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        auto visitor = std::make_unique<Visitor>();
+        auto start = std::chrono::steady_clock::now();
+        aRun(*visitor);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? seconds : std::min(best, seconds);
+        aAfter(*visitor);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = {1000, 4000, 16000, 64000};
+    }
+
+    for (std::size_t functions: sizes) {
+        std::string source = GenerateSource(functions);
+        std::size_t lines = std::count(source.begin(), source.end(), '\n');
+
+        Parser parser;
+        Node *root = parser.parse(llvm::MemoryBuffer::getMemBuffer(source));
+        FlatParser flatParser;
+        FlatNode flatRoot = flatParser.parse(llvm::MemoryBuffer::getMemBuffer(source));
+        if (root == nullptr || parser.isFailed() || flatRoot == nullptr || flatParser.isFailed()) {
+            std::fprintf(stderr, "generated source failed to parse\n");
+            return 1;
+        }
+
+        bool failed = false;
+        auto checkCodegen = [&](Codegen &aCodegen) { failed = failed || aCodegen.isFailed(); };
+        double codegenSeconds = best<Codegen>([&](Codegen &aCodegen) { aCodegen.generate(root); }, checkCodegen);
+        double flatCodegenSeconds = best<Codegen>([&](Codegen &aCodegen) { aCodegen.generate(flatRoot); },
+                                                  checkCodegen);
+        if (failed) {
+            std::fprintf(stderr, "generated source failed codegen\n");
+            return 1;
+        }
+        std::size_t nodes = 0;
+        auto countNodes = [&](Walker &aWalker) { nodes = aWalker.nodes; };
+        double walkSeconds = best<Walker>([&](Walker &aWalker) { aWalker.dispatch(root); }, countNodes);
+        double flatWalkSeconds = best<Walker>([&](Walker &aWalker) { aWalker.walk(flatRoot); }, countNodes);
+
+        std::printf("%6zu functions, %8zu lines, %8zu nodes:\n"
+                    "  tree: codegen %7.1f ms (%6.1f ns per line), walk %6.2f ms (%5.2f ns per node)\n"
+                    "  flat: codegen %7.1f ms (%6.1f ns per line), walk %6.2f ms (%5.2f ns per node)\n",
+                    functions, lines, nodes,
+                    codegenSeconds * 1e3, codegenSeconds * 1e9 / lines,
+                    walkSeconds * 1e3, walkSeconds * 1e9 / nodes,
+                    flatCodegenSeconds * 1e3, flatCodegenSeconds * 1e9 / lines,
+                    flatWalkSeconds * 1e3, flatWalkSeconds * 1e9 / nodes);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Expression-chain stress benchmark: parse, print (as -d does) and
+// generate IR for a single expression of many terms (default 100000):
+// `1 + 2 - 3 * 4 + ...`, then `True && False && ...` and the same with
+// `||` (see SourceGenerator.h).
+//
+// Binary operators used to be parsed by one right-recursive function per
+// precedence level, one C++ call per operator in the chain, and codegen
+// and printing then recursed once per operator again -- chains this long
+// overflowed the stack. All of it now runs in bounded stack space; this
+// reports how long each takes, so a regression there shows up as a crash
+// or a blow-up in time rather than only on someone's generated code.
+//
+// Build (off by default -- see CMakeLists.txt):
+//   cmake -S . -B build -G Ninja -DPUDL_ENABLE_BENCHMARKS=ON
+//   cmake --build build --target pudl_bench_expression
+//   ./build/pudl_bench_expression [terms]   # default 100000
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "Parser/Codegen.h"
+#include "Parser/Parser.h"
+#include "Parser/Printer.h"
+#include "SourceGenerator.h"
+
+// Parses, prints and generates aSource, reporting each step's time.
+static int report(const char *aName, const std::string &aSource, std::size_t aTerms) {
+    Parser parser;
+    auto start = std::chrono::steady_clock::now();
+    Node *root = parser.parse(llvm::MemoryBuffer::getMemBuffer(aSource));
+    double parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (root == nullptr || parser.isFailed()) {
+        std::fprintf(stderr, "generated source failed to parse\n");
+        return 1;
+    }
+
+    // Into a string rather than the terminal: the time is the walk's, not
+    // the terminal's.
+    std::ostringstream printed;
+    std::streambuf *stdoutBuffer = std::cout.rdbuf(printed.rdbuf());
+    Printer printer;
+    start = std::chrono::steady_clock::now();
+    printer.print(root);
+    double printSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout.rdbuf(stdoutBuffer);
+
+    Codegen codegen;
+    start = std::chrono::steady_clock::now();
+    codegen.generate(root);
+    double codegenSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (codegen.isFailed()) {
+        std::fprintf(stderr, "generated source failed codegen\n");
+        return 1;
+    }
+
+    std::printf("%s: %zu terms, %.1f MB\n", aName, aTerms, aSource.size() / 1e6);
+    std::printf("  parse:   %.1f ms, %.1f ns per term\n", parseSeconds * 1e3, parseSeconds * 1e9 / aTerms);
+    std::printf("  print:   %.1f ms, %.1f ns per term (-d)\n", printSeconds * 1e3, printSeconds * 1e9 / aTerms);
+    std::printf("  codegen: %.1f ms, %.1f ns per term (unoptimized IR)\n",
+                codegenSeconds * 1e3, codegenSeconds * 1e9 / aTerms);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t terms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    if (report("+ - *", GenerateExpressionChain(terms), terms) != 0) {
+        return 1;
+    }
+    if (report("&&", GenerateLogicalChain(terms, " && "), terms) != 0) {
+        return 1;
+    }
+    return report("||", GenerateLogicalChain(terms, " || "), terms);
+}
@@ -0,0 +1,109 @@
+// Lexer/parser microbenchmark: lexing throughput and heap allocations
+// per token, on a large generated program (see SourceGenerator.h).
+//
+// Throughput is the best of several runs lexing the whole program to EOF,
+// in MB of source per second -- the number to watch for anything on the
+// lexer's hot path (keyword recognition, whitespace/comment skipping). It
+// is measured twice: on the ordinary program, and on the same program
+// buried in comments and indentation ("sparse"), which is what whitespace
+// and comment skipping is measured by.
+//
+// Allocations are every operator new while (a) lexing to EOF and (b)
+// parsing into an AST, each reported per token. Lexing should never
+// allocate per token: token text is a slice of the source buffer, and
+// only each *distinct* identifier allocates once, when it's interned.
+// Whatever parsing allocates beyond that is the AST itself.
+//
+// Build (off by default -- see CMakeLists.txt):
+//   cmake -S . -B build -G Ninja -DPUDL_ENABLE_BENCHMARKS=ON
+//   cmake --build build --target pudl_bench_lexer
+//   ./build/pudl_bench_lexer [functions]   # default 20000 (~7 MB)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "Lexer/Lexer.h"
+#include "Parser/Parser.h"
+#include "SourceGenerator.h"
+
+static std::size_t allocations = 0;
+
+// Best of five, in seconds, lexing all of aSource to EOF.
+static double timeLexing(const std::string &aSource) {
+    double bestSeconds = 1e9;
+    for (int run = 0; run < 5; run++) {
+        Interner interner;
+        Lexer lexer(llvm::MemoryBuffer::getMemBuffer(aSource), interner);
+        auto start = std::chrono::steady_clock::now();
+        while (lexer.lex().getType() != EOF_TOKEN) {}
+        bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    return bestSeconds;
+}
+
+void *operator new(std::size_t aSize) {
+    allocations++;
+    if (void *p = std::malloc(aSize ? aSize : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t aSize) {
+    return operator new(aSize);
+}
+
+void operator delete(void *aPtr) noexcept { std::free(aPtr); }
+
+void operator delete[](void *aPtr) noexcept { std::free(aPtr); }
+
+void operator delete(void *aPtr, std::size_t) noexcept { std::free(aPtr); }
+
+void operator delete[](void *aPtr, std::size_t) noexcept { std::free(aPtr); }
+
+int main(int argc, char *argv[]) {
+    std::size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::string source = GenerateSource(functions);
+
+    std::size_t tokens = 0;
+    std::size_t lexAllocations;
+    {
+        Interner interner;
+        Lexer lexer(llvm::MemoryBuffer::getMemBuffer(source), interner);
+        std::size_t before = allocations;
+        while (lexer.lex().getType() != EOF_TOKEN) {
+            tokens++;
+        }
+        lexAllocations = allocations - before;
+    }
+
+    double bestSeconds = timeLexing(source);
+    std::string sparse = GenerateSource(functions, true);
+    double sparseSeconds = timeLexing(sparse);
+
+    std::size_t parseAllocations;
+    {
+        Parser parser;
+        auto buffer = llvm::MemoryBuffer::getMemBuffer(source);
+        std::size_t before = allocations;
+        Node *root = parser.parse(std::move(buffer));
+        parseAllocations = allocations - before;
+        if (root == nullptr || parser.isFailed()) {
+            std::fprintf(stderr, "generated source failed to parse\n");
+            return 1;
+        }
+    }
+
+    std::printf("source: %.1f MB, %zu tokens\n", source.size() / 1e6, tokens);
+    std::printf("lex:    %.1f MB/s, %.1f ns per token (best of 5)\n",
+                source.size() / 1e6 / bestSeconds, bestSeconds * 1e9 / tokens);
+    std::printf("lex:    %.1f MB/s on %.1f MB sparse source (best of 5)\n",
+                sparse.size() / 1e6 / sparseSeconds, sparse.size() / 1e6);
+    std::printf("lex:    %zu allocations, %.3f per token\n", lexAllocations, double(lexAllocations) / tokens);
+    std::printf("parse:  %zu allocations, %.3f per token\n", parseAllocations, double(parseAllocations) / tokens);
+    return 0;
+}
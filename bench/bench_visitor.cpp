@@ -0,0 +1,203 @@
+// Visitor dispatch benchmark: walks a parsed AST of about a million nodes
+// (the program GenerateSource() builds from 20000 functions by default,
+// see SourceGenerator.h, or from the number given on the command line)
+// with the same visitor dispatched two ways:
+//   - virtual: ASTVisitor, i.e. Node::accept() then visit(), two virtual
+//     calls per node;
+//   - static:  StaticVisitor, one switch over Node::getKind() at each
+//     child, with the leaves' visit() bodies inlined into it.
+// Each visit() does what a small analysis pass would -- counts the node,
+// adds up its literals and the length of its names -- so the walk is
+// mostly dispatch. Best of five runs each.
+//
+// Build (off by default -- see CMakeLists.txt):
+//   cmake -S . -B build -G Ninja -DPUDL_ENABLE_BENCHMARKS=ON
+//   cmake --build build --target pudl_bench_visitor
+//   ./build/pudl_bench_visitor [functions]   # default 20000
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+#include "Parser/AST/StaticVisitor.h"
+#include "Parser/Parser.h"
+#include "SourceGenerator.h"
+
+// The visitor itself, written once: Base is ASTVisitor (visit() then
+// overrides its virtual functions) or StaticVisitor<Derived>. The visit()s
+// that walk children are kept out of line, as StaticVisitor.h asks --
+// which changes nothing for the virtual ones, never inlined anyway.
+template<typename Base>
+class Summer : public Base {
+public:
+    std::size_t nodes = 0;
+    std::size_t sum = 0;
+
+    void walk(Node *aNode) {
+        if constexpr (std::is_same_v<Base, ASTVisitor>) {
+            aNode->accept(*this);
+        } else {
+            this->dispatch(aNode);
+        }
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(VectorNode &aNode) {
+        nodes++;
+        for (Node *node: aNode.getNodes()) {
+            walk(node);
+        }
+    }
+
+    void visit(DummyNode &aNode) { nodes++; }
+
+    void visit(VarNode &aNode) {
+        nodes++;
+        sum += aNode.getName().size();
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(FuncallNode &aNode) {
+        nodes++;
+        sum += aNode.getName().size();
+        for (ExpressionNode *arg: aNode.getArgs()) {
+            walk(arg);
+        }
+    }
+
+    void visit(BooleanNode &aNode) {
+        nodes++;
+        sum += aNode.getValue();
+    }
+
+    void visit(IntegerNode &aNode) {
+        nodes++;
+        sum += aNode.getValue();
+    }
+
+    void visit(FloatNode &aNode) {
+        nodes++;
+        sum += static_cast<std::size_t>(aNode.getValue());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(BinaryNode &aNode) {
+        nodes++;
+        walk(aNode.getLHS());
+        walk(aNode.getRHS());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(UnaryNode &aNode) {
+        nodes++;
+        walk(aNode.getSubexpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(AssignmentNode &aNode) {
+        nodes++;
+        walk(aNode.getLHS());
+        walk(aNode.getRHS());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(FunctionDefNode &aNode) {
+        nodes++;
+        sum += aNode.getName().size();
+        for (VarNode *arg: aNode.getArgs()) {
+            walk(arg);
+        }
+        walk(aNode.getBody());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(BlockStatementNode &aNode) {
+        nodes++;
+        for (StatementNode *statement: aNode.getStatements()) {
+            walk(statement);
+        }
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(IfStatementNode &aNode) {
+        nodes++;
+        walk(aNode.getCond());
+        walk(aNode.getTrueBranch());
+        if (aNode.getFalseBranch() != nullptr) {
+            walk(aNode.getFalseBranch());
+        }
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(WhileStatementNode &aNode) {
+        nodes++;
+        walk(aNode.getCond());
+        walk(aNode.getBody());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(DoWhileStatementNode &aNode) {
+        nodes++;
+        walk(aNode.getBody());
+        walk(aNode.getCond());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(ExpressionWrapperNode &aNode) {
+        nodes++;
+        walk(aNode.getExpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(IoPrintNode &aNode) {
+        nodes++;
+        walk(aNode.getSubexpr());
+    }
+
+    LLVM_ATTRIBUTE_NOINLINE void visit(ReturnNode &aNode) {
+        nodes++;
+        walk(aNode.getSubexpr());
+    }
+};
+
+class VirtualSummer final : public Summer<ASTVisitor> {};
+
+class StaticSummer final : public Summer<StaticVisitor<StaticSummer>> {};
+
+// Best of five walks of aRoot with a fresh Visitor, in seconds; aNodes
+// and aSum get what the last one counted.
+template<typename Visitor>
+static double best(Node *aRoot, std::size_t &aNodes, std::size_t &aSum) {
+    double best = 0;
+    for (int run = 0; run < 5; run++) {
+        Visitor visitor;
+        auto start = std::chrono::steady_clock::now();
+        visitor.walk(aRoot);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? seconds : std::min(best, seconds);
+        aNodes = visitor.nodes;
+        aSum = visitor.sum;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t functions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::string source = GenerateSource(functions);
+
+    Parser parser;
+    Node *root = parser.parse(llvm::MemoryBuffer::getMemBuffer(source));
+    if (root == nullptr || parser.isFailed()) {
+        std::fprintf(stderr, "generated source failed to parse\n");
+        return 1;
+    }
+
+    std::size_t nodes = 0;
+    std::size_t sum = 0;
+    std::size_t staticNodes = 0;
+    std::size_t staticSum = 0;
+    double virtualSeconds = best<VirtualSummer>(root, nodes, sum);
+    double staticSeconds = best<StaticSummer>(root, staticNodes, staticSum);
+    if (nodes != staticNodes || sum != staticSum) {
+        std::fprintf(stderr, "the two walks disagree: %zu/%zu nodes, sums %zu/%zu\n",
+                     nodes, staticNodes, sum, staticSum);
+        return 1;
+    }
+
+    std::printf("%zu functions, %zu nodes (sum %zu)\n", functions, nodes, sum);
+    std::printf("  virtual (ASTVisitor):    %6.2f ms, %5.2f ns per node\n",
+                virtualSeconds * 1e3, virtualSeconds * 1e9 / nodes);
+    std::printf("  static  (StaticVisitor): %6.2f ms, %5.2f ns per node (%.2fx)\n",
+                staticSeconds * 1e3, staticSeconds * 1e9 / nodes, virtualSeconds / staticSeconds);
+    return 0;
+}
@@ -1,8 +1,9 @@
 // libFuzzer harness for the lexer -> parser -> AST -> codegen pipeline.
 //
-// Deliberately stops short of linking/running: those steps shell out to an
-// external linker/lli, which is slow, environment-dependent, and not code
-// this harness is trying to stress -- everything interesting for a
+// Deliberately stops short of linking/running: linking shells out to an
+// external linker, running JIT-compiles and executes whatever the fuzzer
+// produced -- slow, environment-dependent, and not code this harness is
+// trying to stress -- everything interesting for a
 // fuzzer to find (crashes in the hand-written lexer/parser, or in
 // Codegen's IR construction) happens before that point.
 //
@@ -35,8 +36,8 @@
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t *aData, size_t aSize) {
     // fmemopen wraps the fuzzer-owned buffer as a FILE* with no disk I/O --
-    // Parser::parse() takes ownership of it via its Lexer member and
-    // fclose()s it when the Parser (a local here) is destroyed.
+    // Parser::parse() takes ownership of it: its Lexer copies the contents
+    // into its own buffer and fclose()s it straight away.
     FILE *file = fmemopen(const_cast<uint8_t *>(aData), aSize, "r");
     if (file == nullptr) {
         return 0;
@@ -50,7 +51,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *aData, size_t aSize) {
     }
 
     Codegen codegen;
-    root->accept(codegen);
+    codegen.generate(root);
 
     return 0;
 }
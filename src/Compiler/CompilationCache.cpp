@@ -0,0 +1,207 @@
+#include "CompilationCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+
+using namespace llvm;
+
+namespace {
+    // An entry: Magic, the object count (uint32), each object's size
+    // (uint64), then the objects back to back. Native byte order -- the
+    // target triple is part of every key, so an entry is never read on a
+    // machine unlike the one that wrote it. Bump the version in Magic if
+    // the layout ever changes.
+    constexpr char Magic[8] = {'P', 'U', 'D', 'L', 'O', 'B', 'J', '1'};
+
+    // pruneCache() only ever deletes files named llvmcache-*, so a
+    // mistyped --cache-dir can't cost anyone their files.
+    constexpr const char *EntryPrefix = "llvmcache-pudl-";
+
+    void hashField(SHA256 &aHash, StringRef aField) {
+        std::uint64_t size = aField.size();
+        aHash.update(ArrayRef<std::uint8_t>(reinterpret_cast<const std::uint8_t *>(&size), sizeof(size)));
+        aHash.update(aField);
+    }
+
+    std::string describeSize(std::uint64_t aBytes) {
+        return aBytes < 1024 * 1024
+               ? std::to_string(aBytes / 1024) + " KB"
+               : std::to_string(aBytes / (1024 * 1024)) + " MB";
+    }
+}
+
+CompilationCache::CompilationCache(std::string aDirectory, std::uint64_t aMaxBytes, bool aDebug)
+        : directory(std::move(aDirectory)), maxBytes(aMaxBytes), isDebugMode(aDebug) {
+    if (!isEnabled()) {
+        return;
+    }
+    if (std::error_code ec = sys::fs::create_directories(directory)) {
+        std::cerr << "ERROR@CACHE: Can't create cache directory " << directory << ": " << ec.message()
+                  << "; not caching" << std::endl;
+        directory.clear();
+    }
+}
+
+std::string CompilationCache::Key(StringRef aSource, const std::vector<std::string> &aOptions) {
+    SHA256 hash;
+    // Every field is length-prefixed, so no two different lists of fields
+    // hash the same bytes.
+    hashField(hash, LLVM_VERSION_STRING);
+    hashField(hash, sys::getDefaultTargetTriple());
+    for (const std::string &option: aOptions) {
+        hashField(hash, option);
+    }
+    hashField(hash, aSource);
+    return toHex(hash.final(), /*LowerCase=*/true);
+}
+
+std::string CompilationCache::entryPath(const std::string &aKey) const {
+    SmallString<256> path(directory);
+    sys::path::append(path, EntryPrefix + aKey);
+    return std::string(path);
+}
+
+void CompilationCache::infoln(const std::string &aMsg) const {
+    if (isDebugMode) {
+        std::cout << "Cache: " << aMsg << std::endl;
+    }
+}
+
+std::optional<CompilationCache::Entry> CompilationCache::lookup(const std::string &aKey) {
+    if (!isEnabled()) {
+        return std::nullopt;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string path = entryPath(aKey);
+
+    auto buffer = MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer) {
+        infoln("miss " + aKey.substr(0, 16));
+        return std::nullopt;
+    }
+
+    Entry entry;
+    entry.buffer = std::move(*buffer);
+    StringRef data = entry.buffer->getBuffer();
+
+    // Renamed into place whole, so a bad entry isn't a half-written one --
+    // but a disk can still be full or a file truncated by hand. Treat
+    // anything that doesn't add up as a miss.
+    std::uint32_t count = 0;
+    bool intact = data.size() >= sizeof(Magic) + sizeof(count) && std::memcmp(data.data(), Magic, sizeof(Magic)) == 0;
+    if (intact) {
+        std::memcpy(&count, data.data() + sizeof(Magic), sizeof(count));
+        std::uint64_t offset = sizeof(Magic) + sizeof(count) + std::uint64_t(count) * sizeof(std::uint64_t);
+        intact = count > 0 && offset <= data.size();
+        for (std::uint32_t i = 0; intact && i < count; i++) {
+            std::uint64_t size;
+            std::memcpy(&size, data.data() + sizeof(Magic) + sizeof(count) + i * sizeof(size), sizeof(size));
+            intact = size <= data.size() - offset;
+            if (intact) {
+                entry.objects.push_back(data.substr(offset, size));
+                offset += size;
+            }
+        }
+    }
+    if (!intact) {
+        infoln("miss " + aKey.substr(0, 16) + " (entry is damaged)");
+        return std::nullopt;
+    }
+
+    // pruneCache() evicts by last access time, and plenty of filesystems
+    // (relatime, noatime) don't update that on every read -- set it, so
+    // what's evicted really is what was least recently used.
+    int fd;
+    if (!sys::fs::openFileForReadWrite(path, fd, sys::fs::CD_OpenExisting, sys::fs::OF_None)) {
+        (void) sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+        sys::Process::SafelyCloseFileDescriptor(fd);
+    }
+
+    infoln("hit " + aKey.substr(0, 16) + " (" + std::to_string(count) + " object"
+           + (count == 1 ? "" : "s") + ", " + describeSize(data.size()) + ") in "
+           + std::to_string(std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start).count()) + " ms");
+    return entry;
+}
+
+void CompilationCache::store(const std::string &aKey, ArrayRef<StringRef> aObjects) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    // Named so pruneCache() leaves it alone while it's being written, and
+    // removed if this process dies first.
+    SmallString<256> model(directory);
+    sys::path::append(model, "pudl-%%%%%%%%%%%%.tmp");
+    auto temp = sys::fs::TempFile::create(model);
+    if (!temp) {
+        std::cerr << "ERROR@CACHE: Can't create a cache entry: " << toString(temp.takeError()) << std::endl;
+        return;
+    }
+
+    std::uint64_t total = 0;
+    {
+        raw_fd_ostream out(temp->FD, /*shouldClose=*/false);
+        auto count = static_cast<std::uint32_t>(aObjects.size());
+        out.write(Magic, sizeof(Magic));
+        out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        for (StringRef object: aObjects) {
+            std::uint64_t size = object.size();
+            out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        }
+        for (StringRef object: aObjects) {
+            out.write(object.data(), object.size());
+        }
+        out.flush();
+        total = out.tell();
+        if (out.has_error()) {
+            std::cerr << "ERROR@CACHE: Can't write a cache entry: " << out.error().message() << std::endl;
+            out.clear_error();
+            consumeError(temp->discard());
+            return;
+        }
+    }
+
+    // Another process may be renaming the very same entry into place, or
+    // (on Windows) reading it; either way there's an entry, so losing the
+    // race costs nothing.
+    if (Error err = temp->keep(entryPath(aKey))) {
+        infoln("not stored: " + toString(std::move(err)));
+        consumeError(temp->discard());
+        return;
+    }
+    infoln("stored " + aKey.substr(0, 16) + " (" + describeSize(total) + ")");
+
+    CachePruningPolicy policy;
+    policy.Interval = std::chrono::seconds(0);
+    // Size is the only limit; an entry is evicted for not being used
+    // recently enough only once the cache is full.
+    policy.Expiration = std::chrono::seconds(0);
+    policy.MaxSizeBytes = maxBytes;
+    pruneCache(directory, policy);
+
+    if (isDebugMode) {
+        std::uint64_t entries = 0, bytes = 0;
+        std::error_code ec;
+        for (sys::fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+            sys::fs::file_status status;
+            if (sys::path::filename(it->path()).starts_with(EntryPrefix) && !sys::fs::status(it->path(), status)) {
+                entries++;
+                bytes += status.getSize();
+            }
+        }
+        infoln(directory + " holds " + std::to_string(entries) + " entries, " + describeSize(bytes)
+               + " of " + describeSize(maxBytes));
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+/**
+ * Content-addressed on-disk cache of compiled programs (main.cpp's
+ * --cache-dir=/PUDL_CACHE_DIR), so compiling a file that has been
+ * compiled before -- the same bytes, with the same options, by the same
+ * pudl -- skips lexing, parsing, codegen, optimization and machine-code
+ * generation entirely, and goes straight to writing, linking or running
+ * the object file(s) from last time.
+ *
+ * An entry's key is a SHA-256 of everything the object depends on: the
+ * source bytes, the options that change what gets generated (see Key()),
+ * the target triple, and the Pudl and LLVM versions. Nothing is ever
+ * invalidated in place; anything that would change the output changes
+ * the key instead.
+ *
+ * Several pudl processes can share one directory. Entries are written to
+ * a temporary file and renamed into place, so a reader sees either a
+ * whole entry or none; two processes storing the same key store the same
+ * bytes, so whichever rename lands last is as good as the other. The
+ * directory is kept under a size limit by evicting the least recently
+ * used entries (LLVM's pruneCache(), as ThinLTO's cache does), after each
+ * store; a hit counts as a use.
+ */
+class CompilationCache {
+public:
+    static constexpr std::uint64_t DefaultMaxBytes = 512ull * 1024 * 1024;
+
+    /// A cache hit: the object files the program was compiled to (more
+    /// than one if it was compiled with -j N, see Codegen::emitObjects()).
+    struct Entry {
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+        // Point into `buffer`.
+        std::vector<llvm::StringRef> objects;
+    };
+
+private:
+    // Empty if the cache is off.
+    std::string directory;
+    std::uint64_t maxBytes;
+    bool isDebugMode;
+
+    std::string entryPath(const std::string &aKey) const;
+
+    void infoln(const std::string &aMsg) const;
+
+public:
+    /**
+     * @param aDirectory Where entries live, created if need be; empty to
+     *                   turn the cache off
+     * @param aMaxBytes  Size the directory is pruned back to
+     * @param aDebug     Report hits, misses and the directory's size
+     */
+    CompilationCache(std::string aDirectory, std::uint64_t aMaxBytes, bool aDebug = false);
+
+    bool isEnabled() const { return !directory.empty(); }
+
+    /**
+     * @param aSource  The program's source
+     * @param aOptions Everything else the output depends on that the cache
+     *                 can't know by itself: the Pudl version, -O<N> or
+     *                 --passes=, -march/-mcpu/-mattr, -j. (The target triple
+     *                 and LLVM version are added here.)
+     * @return the key, as hex
+     */
+    static std::string Key(llvm::StringRef aSource, const std::vector<std::string> &aOptions);
+
+    /// The entry stored under aKey, if there is one (and it's intact).
+    std::optional<Entry> lookup(const std::string &aKey);
+
+    /**
+     * Stores aObjects under aKey, then prunes the directory back under
+     * its size limit. Failing to store is reported but otherwise
+     * harmless: the program has already been compiled.
+     */
+    void store(const std::string &aKey, llvm::ArrayRef<llvm::StringRef> aObjects);
+};
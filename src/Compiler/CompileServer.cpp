@@ -0,0 +1,650 @@
+#include "CompileServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "CLIManager.h"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // A request: Magic and the payload's size (uint32), sent along with
+    // the client's stdin/stdout/stderr (SCM_RIGHTS); then the payload --
+    // the client's working directory, then its argv, each a uint32 length
+    // and that many bytes. The response: the exit code, an int32. Native
+    // byte order: both ends are on the same machine.
+    constexpr char Magic[8] = {'P', 'U', 'D', 'L', 'S', 'R', 'V', '1'};
+    constexpr std::uint32_t MaxPayload = 1 << 20;
+    constexpr int PassedFds = 3;
+
+    struct Request {
+        int fds[PassedFds] = {-1, -1, -1};
+        std::string cwd;
+        std::vector<std::string> args;
+
+        ~Request() {
+            for (int fd: fds) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+        }
+    };
+
+    bool writeAll(int aFd, const void *aData, std::size_t aSize) {
+        const char *data = static_cast<const char *>(aData);
+        while (aSize > 0) {
+            ssize_t written = write(aFd, data, aSize);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            aSize -= written;
+        }
+        return true;
+    }
+
+    bool readAll(int aFd, void *aData, std::size_t aSize) {
+        char *data = static_cast<char *>(aData);
+        while (aSize > 0) {
+            ssize_t got = read(aFd, data, aSize);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return false;
+            }
+            data += got;
+            aSize -= got;
+        }
+        return true;
+    }
+
+    void appendString(std::string &aPayload, const std::string &aString) {
+        auto size = static_cast<std::uint32_t>(aString.size());
+        aPayload.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        aPayload += aString;
+    }
+
+    bool takeString(const std::string &aPayload, std::size_t &aOffset, std::string &aString) {
+        std::uint32_t size;
+        if (aPayload.size() - aOffset < sizeof(size)) {
+            return false;
+        }
+        std::memcpy(&size, aPayload.data() + aOffset, sizeof(size));
+        aOffset += sizeof(size);
+        if (aPayload.size() - aOffset < size) {
+            return false;
+        }
+        aString = aPayload.substr(aOffset, size);
+        aOffset += size;
+        return true;
+    }
+
+    void setCloseOnExec(int aFd) {
+        fcntl(aFd, F_SETFD, fcntl(aFd, F_GETFD) | FD_CLOEXEC);
+    }
+
+    bool isSameUser(int aConn) {
+#ifdef __linux__
+        struct ucred credentials{};
+        socklen_t size = sizeof(credentials);
+        return getsockopt(aConn, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0
+               && credentials.uid == getuid();
+#else
+        uid_t uid;
+        gid_t gid;
+        return getpeereid(aConn, &uid, &gid) == 0 && uid == getuid();
+#endif
+    }
+
+    bool receive(int aConn, Request &aRequest) {
+        char header[sizeof(Magic) + sizeof(std::uint32_t)];
+        iovec iov{header, sizeof(header)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * PassedFds)];
+        msghdr message{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+        flags |= MSG_CMSG_CLOEXEC;
+#endif
+        ssize_t got;
+        do {
+            got = recvmsg(aConn, &message, flags);
+        } while (got < 0 && errno == EINTR);
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+                && cmsg->cmsg_len == CMSG_LEN(sizeof(int) * PassedFds)) {
+                std::memcpy(aRequest.fds, CMSG_DATA(cmsg), sizeof(int) * PassedFds);
+                for (int fd: aRequest.fds) {
+                    setCloseOnExec(fd);
+                }
+            }
+        }
+
+        // The rest of the header, if it came apart from the descriptors.
+        if (got <= 0 || !readAll(aConn, header + got, sizeof(header) - got)) {
+            return false;
+        }
+        if (aRequest.fds[0] < 0 || std::memcmp(header, Magic, sizeof(Magic)) != 0) {
+            return false;
+        }
+
+        std::uint32_t size;
+        std::memcpy(&size, header + sizeof(Magic), sizeof(size));
+        if (size > MaxPayload) {
+            return false;
+        }
+        std::string payload(size, '\0');
+        if (!readAll(aConn, payload.data(), size)) {
+            return false;
+        }
+
+        std::size_t offset = 0;
+        if (!takeString(payload, offset, aRequest.cwd)) {
+            return false;
+        }
+        while (offset < payload.size()) {
+            std::string arg;
+            if (!takeString(payload, offset, arg)) {
+                return false;
+            }
+            aRequest.args.push_back(std::move(arg));
+        }
+        return !aRequest.args.empty();
+    }
+
+    /// In a request's child, everything but 0/1/2 and aKeep: the server's
+    /// socket, and other requests' descriptors in particular, which would
+    /// keep their clients' pipes open until this request was done too.
+    void closeInheritedFds(int aKeep) {
+        std::vector<int> inherited;
+        DIR *dir = opendir("/proc/self/fd");
+        if (dir == nullptr) {
+            dir = opendir("/dev/fd");
+        }
+        if (dir != nullptr) {
+            while (dirent *entry = readdir(dir)) {
+                int fd = std::atoi(entry->d_name);
+                if (fd > STDERR_FILENO && fd != aKeep && fd != dirfd(dir)) {
+                    inherited.push_back(fd);
+                }
+            }
+            closedir(dir);
+        } else {
+            for (long fd = STDERR_FILENO + 1; fd < std::min(sysconf(_SC_OPEN_MAX), 65536L); fd++) {
+                if (fd != aKeep) {
+                    inherited.push_back(static_cast<int>(fd));
+                }
+            }
+        }
+        for (int fd: inherited) {
+            close(fd);
+        }
+    }
+
+    /**
+     * In the forked child: becomes the client's `pudl` run. Never returns.
+     * SIGINT and SIGTERM are already back to their defaults (see handle()).
+     * @param aExited Kept open (close-on-exec, so not by anything this
+     *                spawns) until the child exits, for waitForRequest()
+     */
+    [[noreturn]] void runRequest(Request &aRequest, const CompileServer::Entry &aRun, int aExited) {
+        for (int i = 0; i < PassedFds; i++) {
+            dup2(aRequest.fds[i], i);
+        }
+        closeInheritedFds(aExited);
+        // What the server set up for itself, undone for the request -- a
+        // program writing to a closed pipe should die of it as usual.
+        std::signal(SIGPIPE, SIG_DFL);
+        // stdout's buffering was decided by where the server's own stdout
+        // went; decide it again, as a fresh process would.
+        std::setvbuf(stdout, nullptr, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, BUFSIZ);
+
+        if (chdir(aRequest.cwd.c_str()) != 0) {
+            std::cerr << "ERROR@SERVER: Can't change to " << aRequest.cwd << ": " << std::strerror(errno)
+                      << std::endl;
+            _exit(1);
+        }
+
+        std::vector<char *> argv;
+        for (std::string &arg: aRequest.args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+
+        int code = aRun(static_cast<int>(aRequest.args.size()), argv.data());
+
+        // _exit() rather than exit(): the server's static state is the
+        // server's to tear down, not each request's. Only stdio needs it.
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        _exit(code);
+    }
+
+    /**
+     * Waits for aChild, killing it if the client hangs up first.
+     * @param aExited Read end of a pipe only aChild holds the write end of:
+     *                it reads end-of-file once aChild has exited
+     */
+    int waitForRequest(pid_t aChild, int aConn, int aExited) {
+        // The client never sends anything after its request, so the
+        // connection turning readable means it's gone.
+        pollfd watched[2] = {{aExited, POLLIN, 0}, {aConn, POLLIN, 0}};
+        nfds_t count = 2;
+        while (watched[0].revents == 0) {
+            if (poll(watched, count, -1) < 0 && errno != EINTR) {
+                break;
+            }
+            char byte;
+            if (count == 2 && watched[1].revents != 0 && recv(aConn, &byte, 1, MSG_PEEK) <= 0) {
+                kill(aChild, SIGKILL);
+                count = 1;
+            }
+        }
+
+        int status;
+        while (waitpid(aChild, &status, 0) < 0) {
+            if (errno != EINTR) {
+                return 1;
+            }
+        }
+        // As a shell reports it.
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+
+    void handle(int aConn, const CompileServer::Entry &aRun, bool aDebug) {
+        Request request;
+        if (!isSameUser(aConn)) {
+            std::cerr << "ERROR@SERVER: Refused a connection from another user" << std::endl;
+            return;
+        }
+        if (!receive(aConn, request)) {
+            std::cerr << "ERROR@SERVER: Ignored a malformed request" << std::endl;
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        int exited[2] = {-1, -1};
+        pid_t child = -1;
+        if (pipe(exited) == 0) {
+            setCloseOnExec(exited[0]);
+            setCloseOnExec(exited[1]);
+
+            // Held off across fork() until the child has put SIGINT and
+            // SIGTERM back to their defaults: the child starts out with the
+            // server's stopServing() as their handler, and taking one then
+            // would unlink the socket the server is still serving on. One
+            // that arrives meanwhile is delivered once they're unblocked --
+            // in the server, to stopServing(), or in the child, killing it.
+            sigset_t stopSignals;
+            sigset_t previous;
+            sigemptyset(&stopSignals);
+            sigaddset(&stopSignals, SIGINT);
+            sigaddset(&stopSignals, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+            child = fork();
+            if (child == 0) {
+                std::signal(SIGINT, SIG_DFL);
+                std::signal(SIGTERM, SIG_DFL);
+                pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+                runRequest(request, aRun, exited[1]);
+            }
+            pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+            close(exited[1]);
+        }
+
+        std::int32_t code = 1;
+        if (child < 0) {
+            std::string error = std::string("ERROR@SERVER: Can't start the request: ") + std::strerror(errno) + "\n";
+            writeAll(request.fds[2], error.data(), error.size());
+        } else {
+            code = waitForRequest(child, aConn, exited[0]);
+        }
+        if (exited[0] >= 0) {
+            close(exited[0]);
+        }
+        writeAll(aConn, &code, sizeof(code));
+
+        if (aDebug) {
+            std::string command;
+            for (const std::string &arg: request.args) {
+                command += (command.empty() ? "" : " ") + arg;
+            }
+            std::cerr << "Server: `" << command << "` in " << request.cwd << ": exit code " << code << ", "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms" << std::endl;
+        }
+    }
+
+    // For the signal handler, which can't touch a std::string.
+    char servedPath[sizeof(sockaddr_un::sun_path)];
+
+    void stopServing(int aSignal) {
+        unlink(servedPath);
+        std::signal(aSignal, SIG_DFL);
+        std::raise(aSignal);
+    }
+
+    bool toAddress(const std::string &aPath, sockaddr_un &aAddress) {
+        aAddress = {};
+        aAddress.sun_family = AF_UNIX;
+        if (aPath.empty() || aPath.size() >= sizeof(aAddress.sun_path)) {
+            return false;
+        }
+        std::memcpy(aAddress.sun_path, aPath.c_str(), aPath.size() + 1);
+        return true;
+    }
+
+    int listenOn(const std::string &aPath) {
+        sockaddr_un address;
+        if (!toAddress(aPath, address)) {
+            std::cerr << "ERROR@SERVER: Socket path '" << aPath << "' is empty or too long" << std::endl;
+            return -1;
+        }
+
+        struct stat existing{};
+        if (lstat(aPath.c_str(), &existing) == 0) {
+            // Not even probed: whoever created it could be squatting on
+            // the name, waiting for a client's descriptors.
+            if (existing.st_uid != getuid()) {
+                std::cerr << "ERROR@SERVER: " << aPath << " belongs to another user; not serving on it" << std::endl;
+                return -1;
+            }
+            if (!S_ISSOCK(existing.st_mode)) {
+                std::cerr << "ERROR@SERVER: " << aPath << " exists and isn't a socket" << std::endl;
+                return -1;
+            }
+            // Left behind by a server that's gone (killed, crashed) if
+            // nothing accepts on it any more.
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+            if (probe >= 0) {
+                close(probe);
+            }
+            if (live) {
+                std::cerr << "ERROR@SERVER: A server is already listening on " << aPath << std::endl;
+                return -1;
+            }
+            unlink(aPath.c_str());
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) {
+            std::cerr << "ERROR@SERVER: Can't create a socket: " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+        setCloseOnExec(listener);
+
+        // Owner only, from the moment it exists.
+        mode_t mask = umask(0077);
+        int bound = bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        umask(mask);
+        if (bound != 0 || listen(listener, SOMAXCONN) != 0) {
+            std::cerr << "ERROR@SERVER: Can't listen on " << aPath << ": " << std::strerror(errno) << std::endl;
+            close(listener);
+            return -1;
+        }
+        return listener;
+    }
+
+    // Where the default socket goes without XDG_RUNTIME_DIR. Anyone can
+    // create a name in /tmp, so the socket goes in a directory of the
+    // user's own rather than straight in there.
+    std::string fallbackSocketDirectory() {
+        return "/tmp/pudl-" + std::to_string(getuid());
+    }
+
+    // Creates aDir owner-only if it isn't there yet, and refuses it if it
+    // is there but isn't this user's alone -- created by someone else first.
+    bool makePrivateDirectory(const std::string &aDir) {
+        if (mkdir(aDir.c_str(), 0700) != 0 && errno != EEXIST) {
+            std::cerr << "ERROR@SERVER: Can't create " << aDir << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        struct stat info{};
+        if (lstat(aDir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()
+            || (info.st_mode & 0077) != 0) {
+            std::cerr << "ERROR@SERVER: " << aDir << " isn't a directory only this user can use; not serving in it"
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+std::string CompileServer::DefaultSocketPath() {
+    if (const char *runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir != nullptr && *runtimeDir != '\0') {
+        return std::string(runtimeDir) + "/pudl.sock";
+    }
+    return fallbackSocketDirectory() + "/pudl.sock";
+}
+
+int CompileServer::Serve(int argc, char *argv[], const std::function<void()> &aWarmUp, const Entry &aRun) {
+    CLIManager cli(argc, argv);
+    cli.warnUnknownOptions({"--serve", "--socket", "--workers", "-d", "--debug"});
+
+    std::string path = cli.getOptionValue("--socket", DefaultSocketPath());
+    bool debug = cli.hasOption("-d") || cli.hasOption("--debug");
+
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    if (cli.hasOption("--workers")) {
+        std::string value = cli.getOptionValue("--workers");
+        char *end = nullptr;
+        unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed == 0 || parsed > 1024) {
+            std::cerr << "Invalid worker count '" << value << "' (expected 1 to 1024)" << std::endl;
+            return 1;
+        }
+        workers = static_cast<unsigned>(parsed);
+    }
+
+    if (path == fallbackSocketDirectory() + "/pudl.sock" && !makePrivateDirectory(fallbackSocketDirectory())) {
+        return 1;
+    }
+    int listener = listenOn(path);
+    if (listener < 0) {
+        return 1;
+    }
+    std::memcpy(servedPath, path.c_str(), path.size() + 1);
+    std::signal(SIGINT, stopServing);
+    std::signal(SIGTERM, stopServing);
+    // A client that hangs up before its exit code is sent mustn't take
+    // the server with it.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Before any worker exists: whatever the warm-up locks (LLVM's
+    // registries, the linker probe's spawns), no other thread can be
+    // holding when a request forks.
+    aWarmUp();
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> connections;
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < workers; i++) {
+        pool.emplace_back([&]() {
+            for (;;) {
+                int conn;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&]() { return !connections.empty(); });
+                    conn = connections.front();
+                    connections.pop_front();
+                }
+                handle(conn, aRun, debug);
+                close(conn);
+            }
+        });
+    }
+
+    // Flushed now: a request's child inherits this process's stdout
+    // buffer, and must not print anything of the server's.
+    std::cout << "Serving on " << path << " with " << workers << " worker(s)" << std::endl;
+
+    for (;;) {
+        int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "ERROR@SERVER: accept() failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        setCloseOnExec(conn);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections.push_back(conn);
+        }
+        ready.notify_one();
+    }
+
+    unlink(path.c_str());
+    // The workers wait forever; nothing's left for them to do.
+    std::_Exit(1);
+}
+
+int CompileServer::Forward(int argc, char *argv[]) {
+    std::string path = DefaultSocketPath();
+    std::vector<std::string> args = {argv[0]};
+    bool hasCacheDir = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--client") {
+            continue;
+        }
+        if (arg.rfind("--socket=", 0) == 0) {
+            path = arg.substr(std::strlen("--socket="));
+            continue;
+        }
+        if (arg == "--socket" && i + 1 < argc) {
+            path = argv[++i];
+            continue;
+        }
+        hasCacheDir = hasCacheDir || arg.rfind("--cache-dir", 0) == 0;
+        args.push_back(arg);
+    }
+    if (const char *cacheDir = std::getenv("PUDL_CACHE_DIR"); cacheDir != nullptr && !hasCacheDir) {
+        args.push_back(std::string("--cache-dir=") + cacheDir);
+    }
+
+    std::vector<char> cwd(4096);
+    while (getcwd(cwd.data(), cwd.size()) == nullptr) {
+        if (errno != ERANGE) {
+            std::cerr << "ERROR@CLIENT: Can't get the working directory: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        cwd.resize(cwd.size() * 2);
+    }
+
+    sockaddr_un address;
+    int conn = toAddress(path, address) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+    if (conn < 0 || connect(conn, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        std::cerr << "ERROR@CLIENT: No pudl server at " << path << " (" << std::strerror(errno)
+                  << "); start one with `pudl --serve`" << std::endl;
+        if (conn >= 0) {
+            close(conn);
+        }
+        return 1;
+    }
+    // Checked before anything is sent: the request hands over this
+    // terminal (stdin/stdout/stderr), and a server of someone else's is
+    // the one thing that mustn't get it.
+    if (!isSameUser(conn)) {
+        std::cerr << "ERROR@CLIENT: The server at " << path << " is run by another user; not sending it the request"
+                  << std::endl;
+        close(conn);
+        return 1;
+    }
+
+    std::string payload;
+    appendString(payload, cwd.data());
+    for (const std::string &arg: args) {
+        appendString(payload, arg);
+    }
+    char header[sizeof(Magic) + sizeof(std::uint32_t)];
+    auto size = static_cast<std::uint32_t>(payload.size());
+    std::memcpy(header, Magic, sizeof(Magic));
+    std::memcpy(header + sizeof(Magic), &size, sizeof(size));
+
+    iovec iov{header, sizeof(header)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * PassedFds)] = {};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * PassedFds);
+    int fds[PassedFds] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(conn, &message, 0);
+    } while (sent < 0 && errno == EINTR);
+
+    std::int32_t code;
+    if (sent < 0 || !writeAll(conn, header + sent, sizeof(header) - sent)
+        || !writeAll(conn, payload.data(), payload.size()) || !readAll(conn, &code, sizeof(code))) {
+        std::cerr << "ERROR@CLIENT: The server at " << path << " hung up without finishing the request" << std::endl;
+        close(conn);
+        return 1;
+    }
+    close(conn);
+    return code;
+}
+
+#else
+
+std::string CompileServer::DefaultSocketPath() {
+    return "";
+}
+
+int CompileServer::Serve(int argc, char *argv[], const std::function<void()> &aWarmUp, const Entry &aRun) {
+    std::cerr << "ERROR@SERVER: --serve isn't supported on Windows" << std::endl;
+    return 1;
+}
+
+int CompileServer::Forward(int argc, char *argv[]) {
+    std::cerr << "ERROR@CLIENT: --client isn't supported on Windows" << std::endl;
+    return 1;
+}
+
+#endif
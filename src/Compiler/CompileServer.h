@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+/**
+ * `pudl --serve` and `pudl --client`: a compile server on a Unix domain
+ * socket, and the thin client that forwards a command line to it.
+ *
+ * Every plain `pudl` invocation starts from nothing: loading LLVM,
+ * initializing the native target, probing for a C compiler driver to link
+ * with (Process::Detect() spawns each candidate), detecting the host CPU's
+ * features. A server does those once, up front (the warm-up main.cpp
+ * passes in) -- each is kept for the rest of the process -- and runs one
+ * throwaway Codegen through optimize() so the code a compile runs is
+ * paged in before the first request. What isn't kept: each request still
+ * builds its own TargetMachine, PassBuilder and analysis managers
+ * (Codegen's constructor), since they depend on the request's -march/-O
+ * options and hold per-module state. It then serves requests from a pool
+ * of worker threads, each request being the same argv `pudl` would have
+ * been run with directly -- -c, -o, running, any options -- interpreted
+ * relative to the client's working directory.
+ *
+ * Each request is handled in a child process forked from the warmed-up
+ * server, which starts out with all of the above already done. The
+ * child does the work with the client's own stdin/stdout/stderr, passed
+ * over the socket, as its 0/1/2 -- so output streams straight to the
+ * client's terminal or pipes, in the order a direct run would print it --
+ * and its exit code is sent back for the client to exit with. A child
+ * rather than a thread: stdout and stderr are per process, a running
+ * program's printf() included, and a program that crashes or hangs takes
+ * down its own request only. A client that goes away (Ctrl-C) gets its
+ * request killed.
+ *
+ * Requests run in the server's environment, so a PUDL_CACHE_DIR set for
+ * the server gives every request the same compilation cache; a client's
+ * own PUDL_CACHE_DIR is forwarded as --cache-dir= and wins.
+ *
+ * Local only, and only for the user who started the server: the socket is
+ * created accessible to its owner alone, and a connection from any other
+ * user is refused -- a request can run arbitrary code. The client checks
+ * the other way round, before handing over its stdin/stdout/stderr: it
+ * refuses a server run by another user, one who got to the socket path
+ * first. For the same reason, --serve refuses a socket path someone else
+ * owns.
+ *
+ * Not available on Windows, which has no fork().
+ */
+class CompileServer {
+public:
+    /// What a request runs: main.cpp's pipeline, given a full argv.
+    using Entry = std::function<int(int, char **)>;
+
+    /// $XDG_RUNTIME_DIR/pudl.sock, or /tmp/pudl-<uid>/pudl.sock without it
+    /// (a directory --serve creates owner-only).
+    static std::string DefaultSocketPath();
+
+    /**
+     * `pudl --serve [--socket=<path>] [--workers=<N>] [-d]`: warms up,
+     * then serves until killed.
+     * @param aWarmUp Does, once, what every request would otherwise
+     *                start by doing
+     * @param aRun    Handles one request, in the request's own process
+     * @return != 0 if the server couldn't start
+     */
+    static int Serve(int argc, char *argv[], const std::function<void()> &aWarmUp, const Entry &aRun);
+
+    /**
+     * `pudl --client [--socket=<path>] <file> [options]`: has the server
+     * run `pudl <file> [options]` here.
+     * @return the request's exit code, or 1 if there's no server
+     */
+    static int Forward(int argc, char *argv[]);
+};
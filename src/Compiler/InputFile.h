@@ -0,0 +1,32 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/BinaryFormat/Magic.h>
+
+/**
+ * What kind of file `pudl <file>` was given, judged from its first few
+ * bytes alone.
+ *
+ * main() used to read the whole file with getc() looking for a byte above
+ * 127 (anything that wasn't pure ASCII counted as an object file), then
+ * rewind it so the lexer could read it all again. Object files are
+ * recognized by their header now, so a multi-megabyte source file's bytes
+ * are only read once: by the lexer, out of the same buffer. It also means
+ * a UTF-8 comment no longer turns a source file into an "object file".
+ */
+class InputFile {
+public:
+    /// True for a relocatable object in one of the formats the platform
+    /// linkers take (ELF, COFF, Mach-O). Anything else is Pudl source.
+    static bool IsObject(llvm::StringRef aContents) {
+        switch (llvm::identify_magic(aContents)) {
+            case llvm::file_magic::elf_relocatable:
+            case llvm::file_magic::coff_object:
+            case llvm::file_magic::coff_cl_gl_object:
+            case llvm::file_magic::macho_object:
+                return true;
+            default:
+                return false;
+        }
+    }
+};
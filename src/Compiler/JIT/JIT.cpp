@@ -0,0 +1,234 @@
+#include "JIT.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/Target/TargetMachine.h>
+
+using namespace llvm;
+
+static void reportError(Error aError) {
+    std::cerr << "ERROR@JIT: " << toString(std::move(aError)) << std::endl;
+}
+
+namespace {
+    /**
+     * ORC's SimpleCompiler, with the object cache consulted before the
+     * optimizer runs rather than after: SimpleCompiler would look the
+     * module up (and key it) only once it was already optimized, which
+     * is most of the work a hit is meant to save.
+     */
+    class CachingCompiler : public orc::IRCompileLayer::IRCompiler {
+        std::unique_ptr<TargetMachine> target;
+        ObjectCache *cache;
+        std::function<int(Module &)> optimizer;
+
+    public:
+        CachingCompiler(std::unique_ptr<TargetMachine> aTarget, ObjectCache *aCache,
+                        std::function<int(Module &)> aOptimizer)
+                : IRCompiler(orc::irManglingOptionsFromTargetOptions(aTarget->Options)),
+                  target(std::move(aTarget)), cache(aCache), optimizer(std::move(aOptimizer)) {}
+
+        Expected<std::unique_ptr<MemoryBuffer>> operator()(Module &aModule) override {
+            if (cache != nullptr) {
+                if (std::unique_ptr<MemoryBuffer> cached = cache->getObject(&aModule)) {
+                    return cached;
+                }
+            }
+            if (optimizer && optimizer(aModule) != 0) {
+                return make_error<StringError>("optimizing " + aModule.getModuleIdentifier() + " failed",
+                                               inconvertibleErrorCode());
+            }
+            auto object = orc::SimpleCompiler(*target)(aModule);
+            if (object && cache != nullptr) {
+                cache->notifyObjectCompiled(&aModule, (*object)->getMemBufferRef());
+            }
+            return object;
+        }
+    };
+}
+
+JIT::JIT(const TargetMachine &aTarget, Mode aMode) : mode(aMode), target(aTarget) {}
+
+JIT::~JIT() = default;
+
+bool JIT::setUp() {
+    // LLJIT builds its own TargetMachine(s) from a description rather than
+    // taking one -- describe the one it was given. (No target registry
+    // initialization needed either: that TargetMachine couldn't exist
+    // without it.)
+    // The relocation and code models too, so the code is exactly what
+    // Codegen::emitObject() would produce -- an object the cache stores
+    // from here may be linked into an executable by a later `-o`.
+    orc::JITTargetMachineBuilder targetBuilder(target.getTargetTriple());
+    targetBuilder.setCPU(target.getTargetCPU().str())
+            .setOptions(target.Options)
+            .setRelocationModel(target.getRelocationModel())
+            .setCodeModel(target.getCodeModel())
+            .setCodeGenOptLevel(target.getOptLevel());
+    targetBuilder.getFeatures() = SubtargetFeatures(target.getTargetFeatureString());
+
+    // Only replaced when there's something to add: otherwise ORC's own
+    // default (the same SimpleCompiler, minus the cache) stays in place.
+    orc::LLJITBuilder::CompileFunctionCreator compilerCreator;
+    if (objectCache != nullptr || optimizer) {
+        compilerCreator = [this](orc::JITTargetMachineBuilder aBuilder)
+                -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+            auto machine = aBuilder.createTargetMachine();
+            if (!machine) {
+                return machine.takeError();
+            }
+            return std::make_unique<CachingCompiler>(std::move(*machine), objectCache, optimizer);
+        };
+    }
+
+    if (mode == Mode::Lazy) {
+        auto created = orc::LLLazyJITBuilder()
+                .setJITTargetMachineBuilder(std::move(targetBuilder))
+                .setCompileFunctionCreator(std::move(compilerCreator))
+                .create();
+        if (!created) {
+            reportError(created.takeError());
+            return false;
+        }
+        lazyJIT = created->get();
+        // The default partitioning compiles the whole module the first
+        // time anything in it is called, which for a single-module Pudl
+        // program is no lazier than Mode::Eager. Only ever compile the
+        // function that was actually called.
+        lazyJIT->setPartitionFunction(orc::CompileOnDemandLayer::compileRequested);
+        lljit = std::move(*created);
+    } else {
+        auto created = orc::LLJITBuilder()
+                .setJITTargetMachineBuilder(std::move(targetBuilder))
+                .setCompileFunctionCreator(std::move(compilerCreator))
+                .create();
+        if (!created) {
+            reportError(created.takeError());
+            return false;
+        }
+        lljit = std::move(*created);
+    }
+
+    // Every module -- the whole program in Mode::Eager, one partition per
+    // called function in Mode::Lazy -- passes through the IR transform
+    // layer on its way to codegen, so this is where the stat is counted.
+    lljit->getIRTransformLayer().setTransform(
+            [this](orc::ThreadSafeModule aModule, orc::MaterializationResponsibility &)
+                    -> Expected<orc::ThreadSafeModule> {
+                aModule.withModuleDo([this](Module &aM) {
+                    for (Function &func: aM) {
+                        if (!func.isDeclaration() && definedFunctions.count(func.getName().str())) {
+                            compiledFunctions++;
+                        }
+                    }
+                });
+                return aModule;
+            }
+    );
+
+    orc::JITDylib &main = lljit->getMainJITDylib();
+
+    // Anything a Pudl program calls that it doesn't define itself is
+    // libc -- resolve it against what this process already has loaded,
+    // the same way the lli subprocess used to.
+    auto processSymbols = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            lljit->getDataLayout().getGlobalPrefix()
+    );
+    if (!processSymbols) {
+        reportError(processSymbols.takeError());
+        return false;
+    }
+    main.addGenerator(std::move(*processSymbols));
+
+    // printf (what `print` compiles to) is pinned to this binary's own
+    // copy explicitly rather than left to the search above: the
+    // Windows UCRT defines printf inline in <stdio.h> and never exports
+    // it from a DLL, so there is nothing there for a search to find.
+    orc::MangleAndInterner mangle(lljit->getExecutionSession(), lljit->getDataLayout());
+    orc::SymbolMap runtime;
+    runtime[mangle("printf")] = {
+            orc::ExecutorAddr::fromPtr(&std::printf), JITSymbolFlags::Exported
+    };
+    if (Error err = main.define(orc::absoluteSymbols(std::move(runtime)))) {
+        reportError(std::move(err));
+        return false;
+    }
+
+    return true;
+}
+
+JIT::EntryPoint JIT::compile(orc::ThreadSafeModule aModule, const std::string &aEntry) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (!lljit && !setUp()) {
+        return nullptr;
+    }
+
+    aModule.withModuleDo([this](Module &aM) {
+        for (Function &func: aM) {
+            if (!func.isDeclaration()) {
+                definedFunctions.insert(func.getName().str());
+            }
+        }
+    });
+
+    Error added = lazyJIT != nullptr
+                  ? lazyJIT->addLazyIRModule(std::move(aModule))
+                  : lljit->addIRModule(std::move(aModule));
+    if (added) {
+        reportError(std::move(added));
+        return nullptr;
+    }
+
+    // In Mode::Lazy this resolves to a stub: nothing has been compiled yet,
+    // mast() included, until the stub is first called.
+    auto symbol = lljit->lookup(aEntry);
+    if (!symbol) {
+        reportError(symbol.takeError());
+        return nullptr;
+    }
+    EntryPoint entry = symbol->toPtr<EntryPoint>();
+
+    compileMillis += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start
+    ).count();
+
+    return entry;
+}
+
+JIT::EntryPoint JIT::load(ArrayRef<StringRef> aObjects, const std::string &aEntry) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (!lljit && !setUp()) {
+        return nullptr;
+    }
+
+    for (StringRef object: aObjects) {
+        if (Error err = lljit->addObjectFile(MemoryBuffer::getMemBufferCopy(object, "pudl.o"))) {
+            reportError(std::move(err));
+            return nullptr;
+        }
+    }
+
+    // Linking happens here, on the first lookup.
+    auto symbol = lljit->lookup(aEntry);
+    if (!symbol) {
+        reportError(symbol.takeError());
+        return nullptr;
+    }
+    EntryPoint entry = symbol->toPtr<EntryPoint>();
+
+    compileMillis += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start
+    ).count();
+
+    return entry;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+
+namespace llvm {
+    class Module;
+
+    class ObjectCache;
+
+    class TargetMachine;
+}
+
+namespace llvm::orc {
+    class LLJIT;
+
+    class LLLazyJIT;
+}
+
+/**
+ * In-process execution engine for the default `pudl file.pudl` (run, don't
+ * compile) path, built on LLVM's ORC LLJIT.
+ *
+ * This replaces printing the whole module to a temp .ll file and spawning
+ * `lli` on it: that cost a Process::Detect() probe spawn (or several) to
+ * find an lli binary at all, the lli spawn itself, and lli re-parsing and
+ * re-optimizing IR Codegen already had sitting in memory as a Module. Here
+ * the Module goes straight to ORC and mast() is called as a plain function
+ * pointer in this process.
+ *
+ * In Mode::Lazy (`--jit=lazy`) the module goes through ORC's
+ * CompileOnDemandLayer instead: every function is replaced by a stub, and
+ * only the functions a run actually calls are ever compiled to machine
+ * code -- on first call, one function per partition. Programs with many
+ * helpers that a given run never reaches stop paying to compile them all
+ * up front. getCompiledFunctions() reports how many actually were.
+ *
+ * Code is generated for the same triple, CPU, features, relocation model
+ * and codegen optimization level as the TargetMachine the JIT is
+ * constructed with (Codegen's, which the optimization pipeline and
+ * emitObject() also use) -- not whatever ORC would detect on its own.
+ *
+ * With setObjectCache(), every module is looked up in the cache before
+ * it's compiled, and stored in it after (see JITObjectCache.h); with
+ * setOptimizer() too, it's optimized only if that lookup misses.
+ *
+ * All ORC/target headers live in JIT.cpp -- Codegen.h only needs
+ * ThreadSafeModule to hand a module over.
+ */
+class JIT {
+public:
+    enum class Mode {
+        Eager,
+        Lazy
+    };
+
+    using EntryPoint = int (*)();
+
+private:
+    Mode mode;
+    const llvm::TargetMachine &target;
+    std::unique_ptr<llvm::orc::LLJIT> lljit;
+    // Same object as `lljit` when mode == Mode::Lazy (LLLazyJIT is-an
+    // LLJIT), kept separately only for addLazyIRModule().
+    llvm::orc::LLLazyJIT *lazyJIT = nullptr;
+    llvm::ObjectCache *objectCache = nullptr;
+    std::function<int(llvm::Module &)> optimizer;
+    double compileMillis = 0;
+
+    // Names of the functions compile() was handed a body for, and how many
+    // of them have been through codegen so far. Counted by name rather
+    // than by every function body ORC materializes so that anything ORC
+    // adds of its own (platform support, lazy-call-through plumbing) never
+    // shows up in the stat.
+    std::set<std::string> definedFunctions;
+    std::atomic<size_t> compiledFunctions{0};
+
+    bool setUp();
+
+public:
+    explicit JIT(const llvm::TargetMachine &aTarget, Mode aMode = Mode::Eager);
+
+    JIT(const JIT &) = delete;
+
+    JIT &operator=(const JIT &) = delete;
+
+    ~JIT();
+
+    /// Reuse machine code from aCache, and add to it. Before compile().
+    void setObjectCache(llvm::ObjectCache *aCache) { objectCache = aCache; }
+
+    /**
+     * Hand compile() modules before optimization, and have aOptimizer
+     * (returning 0 if successful) run on each just before it would be
+     * compiled to machine code -- not at all when it comes from the
+     * object cache instead. Before compile().
+     */
+    void setOptimizer(std::function<int(llvm::Module &)> aOptimizer) { optimizer = std::move(aOptimizer); }
+
+    /**
+     * Adds aModule to the JIT and resolves aEntry in it, which is what
+     * actually triggers compiling it to machine code.
+     * @param aModule Module to take ownership of
+     * @param aEntry Unmangled name of an `int()` function defined in it
+     * @return the entry point, or nullptr if anything failed (the reason is
+     *         already printed to stderr)
+     */
+    EntryPoint compile(llvm::orc::ThreadSafeModule aModule, const std::string &aEntry);
+
+    /**
+     * compile(), for code that's already been compiled to object files
+     * (CompilationCache): they're only linked into this process. Always
+     * up front, whatever the Mode -- there's nothing left to defer.
+     * @param aObjects Copied; need not outlive the call
+     * @param aEntry Unmangled name of an `int()` function defined in them
+     * @return the entry point, or nullptr if anything failed
+     */
+    EntryPoint load(llvm::ArrayRef<llvm::StringRef> aObjects, const std::string &aEntry);
+
+    /// Wall-clock time spent inside compile() and load() so far. In
+    /// Mode::Lazy that is only the up-front part -- compiling each function
+    /// on its first call happens while the program runs.
+    double getCompileMillis() const { return compileMillis; }
+
+    Mode getMode() const { return mode; }
+
+    /// Functions with a body in modules passed to compile().
+    size_t getDefinedFunctions() const { return definedFunctions.size(); }
+
+    /// How many of getDefinedFunctions() have been compiled to machine code
+    /// so far -- all of them once compile() returns in Mode::Eager, only
+    /// the ones called so far in Mode::Lazy.
+    size_t getCompiledFunctions() const { return compiledFunctions; }
+};
@@ -0,0 +1,54 @@
+#include "JITObjectCache.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "../CompilationCache.h"
+
+using namespace llvm;
+
+JITObjectCache::JITObjectCache(CompilationCache &aCache, std::vector<std::string> aOptions)
+        : cache(aCache), options(std::move(aOptions)) {
+    // Never the same key as a CompilationCache entry for a source file
+    // whose text happens to be some module's bitcode.
+    options.insert(options.begin(), "jit-object");
+}
+
+void JITObjectCache::storeProgram(StringRef aObject) {
+    if (!programKey.empty()) {
+        cache.store(programKey, {aObject});
+    }
+}
+
+std::unique_ptr<MemoryBuffer> JITObjectCache::getObject(const Module *aModule) {
+    SmallVector<char, 0> bitcode;
+    raw_svector_ostream out(bitcode);
+    WriteBitcodeToFile(*aModule, out);
+    std::string key = CompilationCache::Key(StringRef(bitcode.data(), bitcode.size()), options);
+
+    auto entry = cache.lookup(key);
+    std::lock_guard<std::mutex> lock(mutex);
+    // One module, one object: anything else isn't an entry this wrote.
+    if (!entry || entry->objects.size() != 1) {
+        misses++;
+        pendingKeys[aModule] = key;
+        return nullptr;
+    }
+    hits++;
+    storeProgram(entry->objects[0]);
+    return MemoryBuffer::getMemBufferCopy(entry->objects[0], aModule->getModuleIdentifier());
+}
+
+void JITObjectCache::notifyObjectCompiled(const Module *aModule, MemoryBufferRef aObject) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto pending = pendingKeys.find(aModule);
+    if (pending == pendingKeys.end()) {
+        return;
+    }
+    cache.store(pending->second, {aObject.getBuffer()});
+    storeProgram(aObject.getBuffer());
+    pendingKeys.erase(pending);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+
+class CompilationCache;
+
+/**
+ * The JIT's machine code, kept across runs (main.cpp's --cache-dir=, for
+ * the run-without-compiling path): LLVM's ObjectCache interface, which
+ * JIT consults for every module it's about to compile -- the whole
+ * program in JIT::Mode::Eager, each function's partition in
+ * JIT::Mode::Lazy -- stored in a CompilationCache's directory.
+ *
+ * Where CompilationCache's own entries are keyed by source, these are
+ * keyed by a SHA-256 of the module's IR (as bitcode) plus the options
+ * codegen depends on. In Mode::Eager the JIT is handed the module before
+ * optimization and only optimizes it on a miss (see JIT::setOptimizer()),
+ * so a hit skips optimization and codegen both -- and so does a source
+ * edit that changes nothing the IR depends on, e.g. a comment.
+ *
+ * ORC asks for an object by the Module it's compiling, then, on a miss,
+ * hands the compiled object back with the same Module -- which by then
+ * may have been optimized into different IR. The key is computed once,
+ * on the way in, and remembered until then.
+ */
+class JITObjectCache : public llvm::ObjectCache {
+    CompilationCache &cache;
+    std::vector<std::string> options;
+    std::string programKey;
+
+    std::mutex mutex;
+    std::map<const llvm::Module *, std::string> pendingKeys;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+
+    void storeProgram(llvm::StringRef aObject);
+
+public:
+    /**
+     * @param aCache   Where entries are kept; must be enabled
+     * @param aOptions Everything codegen (and, in Mode::Eager, the
+     *                 optimizer) depends on besides the IR -- as for
+     *                 CompilationCache::Key()
+     */
+    JITObjectCache(CompilationCache &aCache, std::vector<std::string> aOptions);
+
+    /**
+     * Also store the object for the whole program under aKey, a
+     * CompilationCache key for its source, so the next run of it needn't
+     * even be parsed. Only for Mode::Eager, where the one module the JIT
+     * compiles is the whole program; the JIT must be generating code the
+     * way Codegen::emitObject() would (it does, see JIT::setUp()), since
+     * -c/-o use the same entry.
+     */
+    void setProgramKey(std::string aKey) { programKey = std::move(aKey); }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *aModule) override;
+
+    void notifyObjectCompiled(const llvm::Module *aModule, llvm::MemoryBufferRef aObject) override;
+
+    /// Modules whose object came from the cache, and that had to be compiled.
+    std::size_t getHits() const { return hits; }
+
+    std::size_t getMisses() const { return misses; }
+};
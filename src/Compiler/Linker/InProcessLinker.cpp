@@ -0,0 +1,270 @@
+#include "InProcessLinker.h"
+
+#include <llvm/Support/raw_ostream.h>
+
+#ifdef PUDL_HAVE_LLD
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <lld/Common/Driver.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+
+LLD_HAS_DRIVER(elf)
+
+namespace {
+
+    /**
+     * Where the pieces a C driver would add to the link line live: the
+     * C runtime's startup objects (Scrt1.o/crti.o/crtn.o, plus GCC's
+     * crtbeginS.o/crtendS.o if present), the directory libc is linked from,
+     * and the dynamic loader path baked into the executable.
+     */
+    struct GnuRuntime {
+        std::string dynamicLinker;
+        std::string libDir;
+        std::string scrt1;
+        std::string crti;
+        std::string crtn;
+        // Optional -- nothing a Pudl program does needs them, but they are
+        // what a driver would link, so use them when they're there.
+        std::string crtbegin;
+        std::string crtend;
+    };
+
+    bool exists(const std::string &aPath) {
+        return llvm::sys::fs::exists(aPath);
+    }
+
+    // GCC installs crtbeginS.o/crtendS.o under /usr/lib/gcc/<triple>/<version>/;
+    // any version works, so take the newest (by name) one that has them.
+    void findGccCrtFiles(const std::string &aArchName, GnuRuntime &aRuntime) {
+        std::vector<std::string> candidates;
+        std::error_code ec;
+        for (llvm::sys::fs::directory_iterator triple("/usr/lib/gcc", ec), end; !ec && triple != end;
+             triple.increment(ec)) {
+            if (llvm::sys::path::filename(triple->path()).find(aArchName) != 0) {
+                continue;
+            }
+            std::error_code versionEc;
+            for (llvm::sys::fs::directory_iterator version(triple->path(), versionEc);
+                 !versionEc && version != end; version.increment(versionEc)) {
+                if (exists(version->path() + "/crtbeginS.o") && exists(version->path() + "/crtendS.o")) {
+                    candidates.push_back(version->path());
+                }
+            }
+        }
+        if (candidates.empty()) {
+            return;
+        }
+        std::sort(candidates.begin(), candidates.end());
+        aRuntime.crtbegin = candidates.back() + "/crtbeginS.o";
+        aRuntime.crtend = candidates.back() + "/crtendS.o";
+    }
+
+    bool probeGnuRuntime(GnuRuntime &aRuntime, std::string &aReason) {
+        llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+        if (!triple.isOSLinux() || !triple.isGNUEnvironment()) {
+            aReason = "in-process linking only knows GNU/Linux's C runtime layout, not " + triple.str();
+            return false;
+        }
+
+        std::string multiarch;
+        if (triple.getArch() == llvm::Triple::x86_64) {
+            aRuntime.dynamicLinker = "/lib64/ld-linux-x86-64.so.2";
+            multiarch = "x86_64-linux-gnu";
+        } else if (triple.getArch() == llvm::Triple::aarch64) {
+            aRuntime.dynamicLinker = "/lib/ld-linux-aarch64.so.1";
+            multiarch = "aarch64-linux-gnu";
+        } else {
+            aReason = "in-process linking doesn't know where " + triple.str() + "'s dynamic loader lives";
+            return false;
+        }
+        if (!exists(aRuntime.dynamicLinker)) {
+            aReason = "dynamic loader " + aRuntime.dynamicLinker + " not found";
+            return false;
+        }
+
+        // Debian/Ubuntu's multiarch layout first, then Fedora/Arch's.
+        for (const std::string &dir: std::vector<std::string>{"/usr/lib/" + multiarch, "/usr/lib64", "/usr/lib"}) {
+            if (exists(dir + "/Scrt1.o") && exists(dir + "/crti.o") && exists(dir + "/crtn.o")) {
+                aRuntime.libDir = dir;
+                aRuntime.scrt1 = dir + "/Scrt1.o";
+                aRuntime.crti = dir + "/crti.o";
+                aRuntime.crtn = dir + "/crtn.o";
+                break;
+            }
+        }
+        if (aRuntime.libDir.empty()) {
+            aReason = "C runtime startup files (Scrt1.o, crti.o, crtn.o) not found";
+            return false;
+        }
+
+        findGccCrtFiles(llvm::Triple::getArchTypeName(triple.getArch()).str(), aRuntime);
+        return true;
+    }
+
+    // Probed once per process: the answer can't change while it runs.
+    const GnuRuntime *getGnuRuntime(std::string &aReason) {
+        static std::string reason;
+        static GnuRuntime runtime;
+        static bool found = probeGnuRuntime(runtime, reason);
+        aReason = reason;
+        return found ? &runtime : nullptr;
+    }
+
+}
+
+#endif
+
+bool InProcessLinker::isAvailable(std::string &aReason) {
+#ifdef PUDL_HAVE_LLD
+    return getGnuRuntime(aReason) != nullptr;
+#else
+    aReason = "this pudl was built without lld, see -DPUDL_ENABLE_LLD";
+    return false;
+#endif
+}
+
+#ifdef PUDL_HAVE_LLD
+namespace {
+
+    // lld isn't fully reentrant after a failed link (Result::canRunAgain),
+    // but pudl links at most once per process, so nothing needs to check.
+    int runLld(const std::vector<const char *> &aArgs) {
+        lld::Result result = lld::lldMain(aArgs, llvm::outs(), llvm::errs(), {{lld::Gnu, &lld::elf::link}});
+        llvm::outs().flush();
+        llvm::errs().flush();
+        return result.retCode;
+    }
+
+    /**
+     * Hands each of aObjects to aLink as a path: lld only takes inputs by
+     * path, and a memfd is an anonymous file that lives purely in memory
+     * but still has one, /proc/self/fd/<fd>. MFD_CLOEXEC: lld never
+     * spawns anything, but nothing else should inherit them either.
+     */
+    template<typename F>
+    int withMemoryFiles(llvm::ArrayRef<llvm::StringRef> aObjects, F aLink) {
+        std::vector<int> fds;
+        std::vector<std::string> paths;
+        int result = 0;
+        for (llvm::StringRef object: aObjects) {
+            int fd = memfd_create("pudl.o", MFD_CLOEXEC);
+            if (fd < 0) {
+                llvm::errs() << "ERROR@LINK: memfd_create failed: " << std::strerror(errno) << "\n";
+                result = 1;
+                break;
+            }
+            fds.push_back(fd);
+            paths.push_back("/proc/self/fd/" + std::to_string(fd));
+
+            const char *data = object.data();
+            size_t remaining = object.size();
+            while (remaining > 0) {
+                ssize_t written = write(fd, data, remaining);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    llvm::errs() << "ERROR@LINK: writing the object to memory failed: " << std::strerror(errno) << "\n";
+                    result = 1;
+                    break;
+                }
+                data += written;
+                remaining -= static_cast<size_t>(written);
+            }
+            if (result != 0) {
+                break;
+            }
+        }
+
+        if (result == 0) {
+            result = aLink(paths);
+        }
+        for (int fd: fds) {
+            close(fd);
+        }
+        return result;
+    }
+
+}
+#endif
+
+int InProcessLinker::Link(const std::vector<std::string> &inPaths, const char *outPath) {
+#ifdef PUDL_HAVE_LLD
+    std::string reason;
+    const GnuRuntime *runtime = getGnuRuntime(reason);
+    if (runtime == nullptr) {
+        llvm::errs() << "ERROR@LINK: " << reason << "\n";
+        return 1;
+    }
+
+    // The same link line `cc -o out in.o` would produce for a PIE (the
+    // object is always PIC -- see TargetSpec::createTargetMachine()).
+    std::string libDirArg = "-L" + runtime->libDir;
+    std::vector<const char *> args = {
+            "ld.lld", "-pie", "--eh-frame-hdr", "--hash-style=gnu", "-z", "relro",
+            "-dynamic-linker", runtime->dynamicLinker.c_str(),
+            "-o", outPath,
+            runtime->scrt1.c_str(), runtime->crti.c_str()
+    };
+    if (!runtime->crtbegin.empty()) {
+        args.push_back(runtime->crtbegin.c_str());
+    }
+    for (const std::string &inPath: inPaths) {
+        args.push_back(inPath.c_str());
+    }
+    args.push_back(libDirArg.c_str());
+    args.push_back("-lc");
+    if (!runtime->crtend.empty()) {
+        args.push_back(runtime->crtend.c_str());
+    }
+    args.push_back(runtime->crtn.c_str());
+
+    return runLld(args);
+#else
+    (void) inPaths;
+    (void) outPath;
+    llvm::errs() << "ERROR@LINK: this pudl was built without lld\n";
+    return 1;
+#endif
+}
+
+int InProcessLinker::Link(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath) {
+#ifdef PUDL_HAVE_LLD
+    return withMemoryFiles(aObjects, [&](const std::vector<std::string> &aPaths) {
+        return Link(aPaths, outPath);
+    });
+#else
+    (void) aObjects;
+    (void) outPath;
+    llvm::errs() << "ERROR@LINK: this pudl was built without lld\n";
+    return 1;
+#endif
+}
+
+int InProcessLinker::LinkRelocatable(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath) {
+#ifdef PUDL_HAVE_LLD
+    return withMemoryFiles(aObjects, [&](const std::vector<std::string> &aPaths) {
+        std::vector<const char *> args = {"ld.lld", "-r", "-o", outPath};
+        for (const std::string &path: aPaths) {
+            args.push_back(path.c_str());
+        }
+        return runLld(args);
+    });
+#else
+    (void) aObjects;
+    (void) outPath;
+    llvm::errs() << "ERROR@LINK: this pudl was built without lld\n";
+    return 1;
+#endif
+}
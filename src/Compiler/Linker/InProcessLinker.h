@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+/**
+ * Links an executable inside this process with lld's ELF port, linked in
+ * as a library, instead of spawning a compiler driver that in turn spawns
+ * `ld` -- two process spawns (plus the driver's own startup and
+ * toolchain probing) per link, which dominates per-file build time once
+ * everything else is in-process.
+ *
+ * Only compiled in when CMake is configured with -DPUDL_ENABLE_LLD=ON
+ * (needs LLD's CMake package, e.g. Debian/Ubuntu's liblld-18-dev), and
+ * only usable on GNU/Linux: a compiler driver's real job here is knowing
+ * where the C runtime's startup objects, libc and the dynamic loader live,
+ * and that is only probed for on the standard glibc layouts. Everywhere
+ * else isAvailable() says why not and Linker falls back to the external
+ * driver.
+ */
+class InProcessLinker {
+public:
+    /// What `-l` takes (and Linker::DetectDefault() returns) to mean "link
+    /// in-process".
+    inline static const std::string Name = "lld";
+
+    /**
+     * @param aReason Set to why not, if unavailable
+     * @return whether Link() can be used at all in this build on this machine
+     */
+    static bool isAvailable(std::string &aReason);
+
+    /**
+     * Links the object files at inPaths into an executable at outPath.
+     * Only valid if isAvailable().
+     * @return 0 if successful, != 0 if failed (lld's diagnostics are
+     *         already printed to stderr)
+     */
+    static int Link(const std::vector<std::string> &inPaths, const char *outPath);
+
+    /**
+     * Link(), for object files that only exist in memory -- each is handed
+     * to lld as an anonymous in-memory file (memfd_create()), so nothing
+     * but the executable itself is ever written to disk.
+     */
+    static int Link(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath);
+
+    /**
+     * Combines in-memory object files into one relocatable object at
+     * outPath (`ld.lld -r`) -- see Linker::LinkRelocatable().
+     */
+    static int LinkRelocatable(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath);
+};
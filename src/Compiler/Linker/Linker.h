@@ -1,52 +1,61 @@
 #pragma once
 
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <string>
 #include <iostream>
 #include <vector>
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
 #include "../Process.h"
+#include "InProcessLinker.h"
 
 class Linker {
-private:
-    inline static const std::string program = R"(
-    #include <iostream>
-
-    extern "C" {
-        int mast();
-    }
-
-    int main() {
-        std::cout << mast() << std::endl;
-    }
-    )";
-
 public:
     /**
-     * Best-effort detection of an available C++ compiler/linker driver on
-     * PATH. This used to be a hardcoded "clang++-13", which broke the
+     * Best-effort detection of an available compiler driver on PATH to
+     * link with. This used to be a hardcoded "clang++-13", which broke the
      * moment the installed LLVM's version number didn't match.
      *
-     * On Windows, MSVC's own cl.exe is preferred over clang++: the
-     * clang++ that ships alongside a given LLVM release is frequently
-     * *older* than the installed MSVC STL headers will accept (current
-     * MSVC headers hard-error with "STL1000: Unexpected compiler version,
-     * expected Clang 20 or newer"), so a clang++ found on PATH there
-     * cannot reliably compile the #include <iostream> wrapper below.
+     * The object already contains `main` (Codegen::emitEntryPoint()) and
+     * only needs libc, so a plain C driver is preferred -- a C++ one works
+     * too, it just links the C++ runtime for nothing.
+     *
+     * On Windows, MSVC's own cl.exe is preferred over clang: it is what
+     * knows where the MSVC/UCRT libraries an executable links against
+     * actually live.
+     *
+     * If this pudl was built with lld and can link in-process on this
+     * machine (InProcessLinker), that beats any driver: no PATH probing
+     * and no process spawns at all.
      */
     static std::string DetectDefault() {
+        std::string reason;
+        if (InProcessLinker::isAvailable(reason)) {
+            return InProcessLinker::Name;
+        }
+        return DetectExternal();
+    }
+
+    /// DetectDefault(), minus the in-process option. Probed once per
+    /// process -- each probe spawns a candidate, and a `pudl --serve`
+    /// (CompileServer.h) probes before serving anything.
+    static std::string DetectExternal() {
 #ifdef _WIN32
-        return Process::Detect({
-                "cl", "clang++", "clang++-20", "clang++-19", "clang++-18"
+        static const std::string detected = Process::Detect({
+                "cl", "clang", "clang-20", "clang-19", "clang-18"
         }, "/?");
 #else
-        return Process::Detect({
-                "clang++", "clang++-18", "clang++-19", "clang++-20",
-                "clang++-17", "c++", "g++"
+        static const std::string detected = Process::Detect({
+                "cc", "clang", "gcc", "clang-18", "clang-19", "clang-20",
+                "clang++", "c++", "g++"
         });
 #endif
+        return detected;
     }
 
     /// True if `linker` is MSVC's cl.exe, which takes /Fe: rather than -o
@@ -60,34 +69,129 @@ public:
     }
 
     static int Link(const char *inPath, const char *outPath, const char *linker) {
-        // Unique per call so two concurrent `pudl` invocations in the same
-        // directory don't clobber each other's throwaway linker source.
-        std::string linkerProgram = Process::UniqueTempPath("TempLinker", ".cpp");
+        return Link(std::vector<std::string>{inPath}, outPath, linker);
+    }
 
-        // save raw program to file for linking
-        std::ofstream out(linkerProgram);
-        out << program;
-        out.close();
+    /// Link(), for several object files linked into one executable.
+    static int Link(const std::vector<std::string> &inPaths, const char *outPath, const char *linker) {
+        std::string external = linker;
+        if (external == InProcessLinker::Name) {
+            std::string reason;
+            if (InProcessLinker::isAvailable(reason)) {
+                return report(InProcessLinker::Link(inPaths, outPath));
+            }
+            external = DetectExternal();
+            std::cout << "Can't link in-process: " << reason << ". Using linker: " << external << std::endl;
+        }
 
-        std::vector<std::string> args;
-        if (isMsvcCl(linker)) {
+        std::vector<std::string> args = {external};
+        args.insert(args.end(), inPaths.begin(), inPaths.end());
+        if (isMsvcCl(external)) {
             std::string outArg = std::string("/Fe:") + outPath;
-            args = {linker, linkerProgram, inPath, "/EHsc", "/nologo", outArg};
+            // The UCRT defines printf inline in <stdio.h> rather than
+            // exporting it; an object that calls it without having been
+            // compiled against those headers needs this shim library.
+            args.insert(args.end(), {"legacy_stdio_definitions.lib", "/nologo", outArg});
         } else {
-            args = {linker, linkerProgram, inPath, "-o", outPath};
+            args.insert(args.end(), {"-o", outPath});
         }
 
-        int result = Process::Run(args);
+        return report(Process::Run(args));
+    }
+
+    /**
+     * Links object files that only exist in memory (Codegen::linkSource();
+     * more than one with -j N, see Codegen::emitObjects()). The in-process
+     * linker takes them as they are; an external driver is another process
+     * and can only be handed paths, so for one each object is written to a
+     * scratch file for the duration of the link.
+     */
+    static int Link(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath, const char *linker) {
+        std::string reason;
+        if (linker == InProcessLinker::Name && InProcessLinker::isAvailable(reason)) {
+            return report(InProcessLinker::Link(aObjects, outPath));
+        }
 
+        std::vector<std::string> inPaths;
+        int result = writeTemps(aObjects, inPaths);
         if (result == 0) {
-            std::cout << "Linking successful" << std::endl;
-        } else {
-            std::cout << "Linking failed" << std::endl;
+            result = Link(inPaths, outPath, linker);
+        }
+        removeTemps(inPaths);
+        return result;
+    }
+
+    /**
+     * Whether LinkRelocatable() can combine objects with `linker` (empty
+     * for DetectDefault()'s) -- not with MSVC's cl.exe, whose link.exe has
+     * no partial linking.
+     */
+    static bool CanLinkRelocatable(const std::string &linker) {
+        return !isMsvcCl(linker.empty() || linker == InProcessLinker::Name ? DetectDefault() : linker);
+    }
+
+    /**
+     * Combines object files into one relocatable object (`ld -r`) rather
+     * than an executable: how `-c` with -j N still writes the single
+     * object file it was asked for, out of the several compiled in
+     * parallel. No C runtime or libc goes in; the result links later
+     * exactly as a single-threaded -c's object would.
+     */
+    static int LinkRelocatable(llvm::ArrayRef<llvm::StringRef> aObjects, const char *outPath, const char *linker) {
+        std::string external = linker;
+        if (external == InProcessLinker::Name) {
+            std::string reason;
+            if (InProcessLinker::isAvailable(reason)) {
+                return InProcessLinker::LinkRelocatable(aObjects, outPath);
+            }
+            external = DetectExternal();
+        }
+        if (isMsvcCl(external)) {
+            std::cerr << "ERROR@LINK: " << external << " can't combine object files into one" << std::endl;
             return 1;
         }
 
-        if (remove(linkerProgram.c_str()) != 0) {
-            std::cout << "Failed to remove temp linker file" << std::endl;
+        std::vector<std::string> inPaths;
+        int result = writeTemps(aObjects, inPaths);
+        if (result == 0) {
+            std::vector<std::string> args = {external, "-r", "-nostdlib"};
+            args.insert(args.end(), inPaths.begin(), inPaths.end());
+            args.insert(args.end(), {"-o", outPath});
+            result = Process::Run(args) == 0 ? 0 : 1;
+        }
+        removeTemps(inPaths);
+        return result;
+    }
+
+private:
+    // Unique per object so two concurrent `pudl` invocations in the same
+    // directory don't clobber (or race-delete) each other's objects.
+    static int writeTemps(llvm::ArrayRef<llvm::StringRef> aObjects, std::vector<std::string> &aPaths) {
+        for (llvm::StringRef object: aObjects) {
+            aPaths.push_back(Process::UniqueTempPath("temp", ".o"));
+            std::ofstream file(aPaths.back(), std::ios::binary);
+            file.write(object.data(), static_cast<std::streamsize>(object.size()));
+            if (!file) {
+                std::cerr << "ERROR@LINK: Could not write temp object file " << aPaths.back() << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    static void removeTemps(const std::vector<std::string> &aPaths) {
+        for (const std::string &path: aPaths) {
+            if (std::remove(path.c_str()) != 0) {
+                std::cerr << "ERROR@LINK: Deletion of temp compile file failed" << std::endl;
+            }
+        }
+    }
+
+    static int report(int result) {
+        if (result == 0) {
+            std::cout << "Linking successful" << std::endl;
+        } else {
+            std::cout << "Linking failed" << std::endl;
             return 1;
         }
 
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+
+/**
+ * Which CPU, and which of its optional instruction-set features, Pudl
+ * generates code for -- main.cpp's -march=/-mcpu=/-mattr=.
+ *
+ * Codegen::compile() used to hard-code CPU "generic" with no features,
+ * i.e. baseline x86-64 (SSE2 and nothing newer) no matter what machine it
+ * ran on. The default is now -march=native: the host's own CPU name and
+ * every feature it reports, since the overwhelmingly common case is
+ * running or compiling a program on the machine it will run on. Pass
+ * -march=generic (or an explicit -mcpu=) when building an object or
+ * executable meant to run somewhere else.
+ *
+ * One TargetMachine is created from this per Codegen and then shared by
+ * everything that needs one -- the optimization pipeline (so TTI-driven
+ * cost models for vectorization/unrolling see the real hardware), the
+ * JIT, and object-file emission.
+ */
+struct TargetSpec {
+    std::string cpu = "generic";
+    // Comma-separated "+feature"/"-feature" list, LLVM's -mattr= syntax.
+    std::string features;
+
+    /// -march=native. Detected once per process.
+    static TargetSpec Host() {
+        static const TargetSpec host = DetectHost();
+        return host;
+    }
+
+    /**
+     * Resolves the command-line options (each empty if not given) into a
+     * spec. -mcpu= wins over -march= when both are given; -march= accepts
+     * "native" or any CPU name -mcpu= does. -mattr= is appended to
+     * whatever features the CPU choice implies, so "-mattr=-avx512f" on
+     * top of the native default turns just that one feature off.
+     */
+    static TargetSpec Resolve(const std::string &aMarch, const std::string &aMcpu, const std::string &aMattr) {
+        TargetSpec spec;
+        std::string cpu = !aMcpu.empty() ? aMcpu : !aMarch.empty() ? aMarch : "native";
+
+        if (cpu == "native") {
+            spec = Host();
+        } else {
+            spec.cpu = cpu;
+        }
+
+        if (!aMattr.empty()) {
+            spec.features = spec.features.empty() ? aMattr : spec.features + "," + aMattr;
+        }
+
+        return spec;
+    }
+
+    /**
+     * @param aError Set to why, if no TargetMachine could be created
+     * @return a TargetMachine for the host triple with this CPU/features,
+     *         or nullptr
+     */
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine(std::string &aError) const {
+        // Pudl only ever emits code for the host machine's architecture
+        // (there is no cross-compilation flag anywhere in the CLI/AST), so
+        // only the native target needs to be initialized.
+        // InitializeAllTargets() et al. require *every* target library
+        // LLVM's headers declare to be linkable, which is fragile across
+        // LLVM distributions that ship different subsets of (particularly
+        // experimental) targets -- e.g. the official LLVM Windows release
+        // omits M68k, which some distro packages include.
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::InitializeNativeTargetAsmPrinter();
+
+        std::string triple = llvm::sys::getDefaultTargetTriple();
+        const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, aError);
+        if (!target) {
+            return nullptr;
+        }
+
+        llvm::TargetOptions options;
+        // Leaving this as std::nullopt lets the TargetMachine pick its own
+        // default, which is not necessarily position-independent -- linking
+        // a non-PIC object with a modern PIE-by-default linker driver (e.g.
+        // current clang++/ld defaults on most Linux distros) fails with
+        // "relocation R_X86_64_32 against .rodata can not be used when
+        // making a PIE object". Pudl always emits a full standalone
+        // executable's worth of code (no shared-library use case), so PIC
+        // is simply the safe, always-linkable choice.
+        auto relocModel = std::optional<llvm::Reloc::Model>(llvm::Reloc::PIC_);
+
+        std::unique_ptr<llvm::TargetMachine> machine(
+                target->createTargetMachine(triple, cpu, features, options, relocModel)
+        );
+        if (!machine) {
+            aError = "can't create a target machine for " + triple + " (CPU " + cpu + ")";
+            return nullptr;
+        }
+
+        // An unknown CPU name is only a warning to LLVM, which then falls
+        // back to a CPU with no features at all -- on x86-64 not even
+        // 64-bit support, so the first thing compiled would be a fatal
+        // "64-bit code requested on a subtarget that doesn't support it".
+        if (!machine->getMCSubtargetInfo()->isCPUStringValid(cpu)) {
+            aError = "unknown CPU '" + cpu + "' for " + triple;
+            return nullptr;
+        }
+
+        return machine;
+    }
+
+private:
+    static TargetSpec DetectHost() {
+        TargetSpec spec;
+        spec.cpu = llvm::sys::getHostCPUName().str();
+
+        llvm::StringMap<bool> hostFeatures;
+        if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+            // StringMap iterates in hash order -- sort so the same machine
+            // always produces the same feature string.
+            std::vector<std::string> list;
+            for (const auto &feature: hostFeatures) {
+                list.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+            }
+            std::sort(list.begin(), list.end());
+            spec.features = join(list);
+        }
+
+        return spec;
+    }
+
+    static std::string join(const std::vector<std::string> &aList) {
+        std::string joined;
+        for (const std::string &item: aList) {
+            if (!joined.empty()) {
+                joined += ",";
+            }
+            joined += item;
+        }
+        return joined;
+    }
+};
@@ -1,4 +1,6 @@
-enum class TType {
+#include <cstdint>
+
+enum class TType : std::uint8_t {
     UNDEFINED,
     BOOL,
     INTEGER,
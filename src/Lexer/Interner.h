@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+/// Stable integer name for an identifier; see Interner.
+using SymbolId = std::uint32_t;
+
+/// The SymbolId of a token that isn't an identifier.
+constexpr SymbolId NoSymbol = ~SymbolId(0);
+
+/**
+ * Gives each distinct identifier spelling a small, dense, stable ID, so
+ * symbol tables can key on an integer instead of hashing and copying
+ * strings. IDs count up from 0 in first-seen order and stay valid for the
+ * Interner's lifetime, as do the names getName() returns (StringMap owns
+ * one copy of each distinct spelling -- one allocation per symbol, not per
+ * occurrence).
+ */
+class Interner {
+private:
+    llvm::StringMap<SymbolId> ids;
+    std::vector<llvm::StringRef> names;
+
+public:
+    SymbolId intern(std::string_view aName) {
+        auto inserted = ids.try_emplace(llvm::StringRef(aName.data(), aName.size()), SymbolId(names.size()));
+        if (inserted.second) {
+            names.push_back(inserted.first->getKey());
+        }
+        return inserted.first->getValue();
+    }
+
+    std::string_view getName(SymbolId aId) const {
+        return std::string_view(names[aId].data(), names[aId].size());
+    }
+
+    std::size_t size() const { return names.size(); }
+};
@@ -1,245 +1,226 @@
 #include "Lexer.h"
 
-Lexer::~Lexer() {
-    fclose(file);
-}
+#include <cctype>
+#include <cstring>
+
+#include "Whitespace.h"
 
-void Lexer::whitespace(char aCh) {
-    if (aCh == '\n') {
-        col = 1;
-        line++;
-    } else {
-        col++;
+namespace {
+
+    std::unique_ptr<llvm::MemoryBuffer> readAll(FILE *aFile) {
+        std::string contents;
+        char chunk[64 * 1024];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), aFile)) > 0) {
+            contents.append(chunk, read);
+        }
+        fclose(aFile);
+        return llvm::MemoryBuffer::getMemBufferCopy(contents);
+    }
+
+    // <cctype> takes an int that must be representable as unsigned char --
+    // a plain (signed) char >= 0x80 passed straight through is UB.
+    bool isAlpha(char aCh) { return std::isalpha(static_cast<unsigned char>(aCh)); }
+
+    bool isDigit(char aCh) { return std::isdigit(static_cast<unsigned char>(aCh)); }
+
+    bool isAlnum(char aCh) { return std::isalnum(static_cast<unsigned char>(aCh)); }
+
+    // Keyword recognition in O(1): switching on length, then on the first
+    // character, leaves at most one candidate to compare against. It used
+    // to be twelve std::string comparisons against every identifier, in
+    // sequence, without stopping at a match.
+    constexpr TokenType keywordType(std::string_view aLexeme) {
+        switch (aLexeme.size()) {
+            case 2:
+                if (aLexeme[0] == 'i') { return aLexeme == "if" ? IF : SYMBOL; }
+                if (aLexeme[0] == 'd') { return aLexeme == "do" ? DO : SYMBOL; }
+                break;
+            case 3:
+                if (aLexeme[0] == 'i') { return aLexeme == "int" ? TYPE : SYMBOL; }
+                break;
+            case 4:
+                switch (aLexeme[0]) {
+                    case 'f':
+                        return aLexeme == "func" ? FUNC : SYMBOL;
+                    case 'e':
+                        return aLexeme == "else" ? ELSE : SYMBOL;
+                    case 'b':
+                        return aLexeme == "bool" ? TYPE : SYMBOL;
+                    case 'T':
+                        return aLexeme == "True" ? BOOL : SYMBOL;
+                    default:
+                        break;
+                }
+                break;
+            case 5:
+                switch (aLexeme[0]) {
+                    case 'w':
+                        return aLexeme == "while" ? WHILE : SYMBOL;
+                    case 'f':
+                        return aLexeme == "float" ? TYPE : SYMBOL;
+                    case 'F':
+                        return aLexeme == "False" ? BOOL : SYMBOL;
+                    case 'p':
+                        return aLexeme == "print" ? IO_PRINT : SYMBOL;
+                    default:
+                        break;
+                }
+                break;
+            case 6:
+                if (aLexeme[0] == 'r') { return aLexeme == "return" ? RETURN : SYMBOL; }
+                break;
+            default:
+                break;
+        }
+        return SYMBOL;
     }
+
+    static_assert(keywordType("func") == FUNC && keywordType("if") == IF && keywordType("else") == ELSE
+                  && keywordType("do") == DO && keywordType("while") == WHILE
+                  && keywordType("return") == RETURN && keywordType("int") == TYPE
+                  && keywordType("float") == TYPE && keywordType("bool") == TYPE
+                  && keywordType("False") == BOOL && keywordType("True") == BOOL
+                  && keywordType("print") == IO_PRINT,
+                  "every keyword must be recognized");
+    static_assert(keywordType("iff") == SYMBOL && keywordType("fun") == SYMBOL && keywordType("true") == SYMBOL
+                  && keywordType("floats") == SYMBOL && keywordType("d") == SYMBOL,
+                  "near-misses must stay identifiers");
+
 }
 
-void Lexer::skipComment() {
-    char ch = fgetc(file);
-    do {
-        ch = fgetc(file);
-    } while (ch != '\n' && ch != EOF);
-    col = 1;
-    line++;
+Lexer::Lexer(std::unique_ptr<llvm::MemoryBuffer> aBuffer, Interner &aInterner)
+        : buffer(std::move(aBuffer)), interner(aInterner), sourceManager(buffer->getBuffer()), saved(EOF_TOKEN) {
+    begin = buffer->getBufferStart();
+    cur = begin;
+    end = buffer->getBufferEnd();
+}
+
+Lexer::Lexer(FILE *aFile, Interner &aInterner) : Lexer(readAll(aFile), aInterner) {}
+
+void Lexer::skipWhitespaceAndComments() {
+    while (true) {
+        cur = Whitespace::Skip(cur, end);
+        if (cur == end || *cur != '#') {
+            return;
+        }
+        skipComment();
+    }
 }
 
-Token Lexer::identifierOrKeyword(char aBegin) {
-    std::string lexeme = identifier(aBegin);
-    TokenType type = SYMBOL;
-
-    if (lexeme == "func") type = FUNC;
-    if (lexeme == "if") type = IF;
-    if (lexeme == "else") type = ELSE;
-    if (lexeme == "do") type = DO;
-    if (lexeme == "while") type = WHILE;
-    if (lexeme == "return") type = RETURN;
-    if (lexeme == "int") type = TYPE;
-    if (lexeme == "float") type = TYPE;
-    if (lexeme == "bool") type = TYPE;
-    if (lexeme == "False") type = BOOL;
-    if (lexeme == "True") type = BOOL;
-    if (lexeme == "print") type = IO_PRINT;
-
-    return Token(type, lexeme, line, col - lexeme.size());
+// Skips from `#` up to and including the end of the line. (The FILE*
+// version unconditionally consumed the character after `#` before looking
+// for the newline, so an empty `#` comment swallowed the whole next line.)
+// memchr() rather than a loop: libc's is vectorized, and comments are
+// most of some generated sources.
+void Lexer::skipComment() {
+    auto newline = static_cast<const char *>(std::memchr(cur, '\n', end - cur));
+    cur = newline != nullptr ? newline + 1 : end;
 }
 
-std::string Lexer::identifier(char aBegin) {
-    std::string buffer("");
-    buffer += aBegin;
-    col++;
+Token Lexer::identifierOrKeyword() {
+    std::uint32_t offset = offsetOf(cur);
+    std::string_view lexeme = identifier();
+    TokenType type = keywordType(lexeme);
 
-    char ch = fgetc(file);
-    while (isalnum(ch)) {
-        buffer += ch;
-        col++;
-        ch = fgetc(file);
+    auto length = static_cast<std::uint32_t>(lexeme.size());
+    if (type == SYMBOL) {
+        return Token(type, offset, length, interner.intern(lexeme));
     }
-    // Return last character to stream
-    ungetc(ch, file);
-    return buffer;
+    return Token(type, offset, length);
 }
 
-Token Lexer::number(char aBegin) {
-    std::string buffer("");
-    buffer += aBegin;
-    col++;
+std::string_view Lexer::identifier() {
+    const char *start = cur;
+    do {
+        ++cur;
+    } while (cur != end && isAlnum(*cur));
+    return std::string_view(start, cur - start);
+}
+
+Token Lexer::number() {
+    const char *start = cur;
 
     TokenType type = INTEGER;
-    char ch = fgetc(file);
-    while (1) {
-        if (isdigit(ch)) {
-            buffer += ch;
-        } else if (ch == '.') {
-            buffer += ch;
+    do {
+        if (*cur == '.') {
             type = FLOAT;
-        } else {
-            break;
         }
-        col++;
-        ch = fgetc(file);
-    }
-    ungetc(ch, file);
-    return Token(type, buffer, line, col - buffer.size());
+        ++cur;
+    } while (cur != end && (isDigit(*cur) || *cur == '.'));
+
+    return Token(type, offsetOf(start), static_cast<std::uint32_t>(cur - start));
+}
+
+Token Lexer::take(TokenType aType, int aLength) {
+    Token token(aType, offsetOf(cur), static_cast<std::uint32_t>(aLength));
+    cur += aLength;
+    return token;
 }
 
 Token Lexer::lex() {
     if (saved.getType() != EOF_TOKEN) {
         Token t = saved;
-        saved = Token(EOF_TOKEN, 0, 0);
+        saved = Token(EOF_TOKEN);
         return t;
     }
 
-    char ch = fgetc(file);
-
-    // Whitespaces
-    while (isspace(ch)) {
-        whitespace(ch);
-        ch = fgetc(file);
-    }
-    // Comments
-    while (ch == '#') {
-        // std::cout << "lex: comment at ("
-        //   << line << ":" << col << ")"  << std::endl;
-        skipComment();
-        ch = fgetc(file);
-        // Whitespaces after comment
-        while (isspace(ch)) {
-            whitespace(ch);
-            ch = fgetc(file);
-        }
-    }
-
-    // EOF after comment
-    if (ch == EOF) { return Token(EOF_TOKEN, line, col); }
-
-    // std::cout << "lex?: " << ch << " at ("
-    //   << line << ":" << col << ")"  << std::endl;
-    if (isalpha(ch)) { return identifierOrKeyword(ch); }
-    if (isdigit(ch)) { return number(ch); }
-
-    // Parentheses and Braces
-    if (ch == '(') {
-        col++;
-        return Token(PL, "(", line, col - 1);
-    }
-    if (ch == ')') {
-        col++;
-        return Token(PR, ")", line, col - 1);
-    }
-    if (ch == '{') {
-        col++;
-        return Token(BL, "{", line, col - 1);
-    }
-    if (ch == '}') {
-        col++;
-        return Token(BR, "}", line, col - 1);
-    }
-
-    // Punctuation
-    if (ch == ',') {
-        col++;
-        return Token(COMMA, ",", line, col - 1);
-    }
-    if (ch == ';') {
-        col++;
-        return Token(SEMICOLON, ";", line, col - 1);
-    }
-    if (ch == ':') {
-        col++;
-        return Token(COLON, ":", line, col - 1);
-    }
-
-    // Arithmeric operators
-    if (ch == '+') {
-        col++;
-        return Token(ADD, "+", line, col - 1);
-    }
-    if (ch == '-') {
-        col++;
-        return Token(ADD, "-", line, col - 1);
-    }
-    if (ch == '*') {
-        col++;
-        return Token(MUL, "*", line, col - 1);
-    }
-    if (ch == '/') {
-        col++;
-        return Token(MUL, "/", line, col - 1);
-    }
-
-    // Comparison operators
-    if (ch == '=') {
-        char next = fgetc(file);
-        if (next == '=') {
-            col += 2;
-            return Token(CMP_EQ, "==", line, col - 2);
-        } else {
-            ungetc(next, file);
-        }
-    }
-    if (ch == '!') {
-        char next = fgetc(file);
-        if (next == '=') {
-            col += 2;
-            return Token(CMP_EQ, "!=", line, col - 2);
-        } else {
-            ungetc(next, file);
-            col++;
-            return Token(NOT, "!", line, col - 1);
-        }
-    }
-    if (ch == '>') {
-        char next = fgetc(file);
-        if (next == '=') {
-            col += 2;
-            return Token(CMP, ">=", line, col - 2);
-        } else {
-            ungetc(next, file);
-            col++;
-            return Token(CMP, ">", line, col - 1);
-        }
-    }
-    if (ch == '<') {
-        char next = fgetc(file);
-        if (next == '=') {
-            col += 2;
-            return Token(CMP, "<=", line, col - 2);
-        } else {
-            ungetc(next, file);
-            col++;
-            return Token(CMP, "<", line, col - 1);
-        }
-    }
-    if (ch == '&') {
-        char next = fgetc(file);
-        if (next == '&') {
-            col += 2;
-            return Token(LAND, "&&", line, col - 2);
-        } else {
-            col++;
-            ungetc(next, file);
-        }
-    }
-    if (ch == '|') {
-        char next = fgetc(file);
-        if (next == '|') {
-            col += 2;
-            return Token(LOR, "||", line, col - 2);
-        } else {
-            col++;
-            ungetc(next, file);
-        }
-    }
+    skipWhitespaceAndComments();
 
-    // Assignment
-    if (ch == '=') {
-        col++;
-        return Token(ASSIGN, "=", line, col - 1);
+    // EOF
+    if (cur == end) { return Token(EOF_TOKEN, offsetOf(cur), 0); }
+
+    char ch = *cur;
+    if (isAlpha(ch)) { return identifierOrKeyword(); }
+    if (isDigit(ch)) { return number(); }
+
+    switch (ch) {
+        // Parentheses and Braces
+        case '(':
+            return take(PL, 1);
+        case ')':
+            return take(PR, 1);
+        case '{':
+            return take(BL, 1);
+        case '}':
+            return take(BR, 1);
+
+        // Punctuation
+        case ',':
+            return take(COMMA, 1);
+        case ';':
+            return take(SEMICOLON, 1);
+        case ':':
+            return take(COLON, 1);
+
+        // Arithmeric operators
+        case '+':
+        case '-':
+            return take(ADD, 1);
+        case '*':
+        case '/':
+            return take(MUL, 1);
+
+        // Comparison operators and assignment
+        case '=':
+            return peek(1) == '=' ? take(CMP_EQ, 2) : take(ASSIGN, 1);
+        case '!':
+            return peek(1) == '=' ? take(CMP_EQ, 2) : take(NOT, 1);
+        case '>':
+        case '<':
+            return peek(1) == '=' ? take(CMP, 2) : take(CMP, 1);
+        case '&':
+            if (peek(1) == '&') { return take(LAND, 2); }
+            break;
+        case '|':
+            if (peek(1) == '|') { return take(LOR, 2); }
+            break;
+        default:
+            break;
     }
 
-    // EOF
-    if (ch == EOF) { return Token(EOF_TOKEN, line, col); }
-    std::string str("Undefined symbol: ");
-    return Token(ERROR_TOKEN, str.append(1, ch), line, col++);
+    // Undefined symbol
+    return take(ERROR_TOKEN, 1);
 }
 
 void Lexer::unlex(Token aToken) {
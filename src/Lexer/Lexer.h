@@ -1,36 +1,93 @@
 #pragma once
 
-#include <iostream>
-#include <string>
-#include <fstream>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+
+#include <llvm/Support/MemoryBuffer.h>
+
+#include "Interner.h"
+#include "SourceManager.h"
 #include "Token.h"
 
+/**
+ * Turns Pudl source text into Tokens.
+ *
+ * Works over the whole source as one contiguous buffer (an mmap'd file or
+ * any other llvm::MemoryBuffer), scanning it by bumping a pointer. It used
+ * to read a FILE* through fgetc()/ungetc(), which cost one libc call per
+ * character plus a std::string append per character of every identifier
+ * and number. On multi-megabyte generated sources that was visible in
+ * profiles.
+ *
+ * Tokens only record where their text is in that buffer; getLexeme()
+ * gives it back as a string_view, valid for as long as the Lexer is.
+ * Identifiers are also interned as they're lexed (see Interner), so the
+ * parser's symbol tables never need the text at all. Nor does it track
+ * lines: getLocation() works a token's line:column out from its offset
+ * when a diagnostic needs it (see SourceManager).
+ */
 class Lexer {
 private:
-    FILE *file;
-    int line, col;
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    Interner &interner;
+    const char *begin;
+    const char *cur;
+    const char *end;
+    SourceManager sourceManager;
     Token saved;
 
-    void whitespace(char aCh);
+    void skipWhitespaceAndComments();
 
     void skipComment();
 
-    Token identifierOrKeyword(char aBegin);
+    Token identifierOrKeyword();
+
+    std::string_view identifier();
 
-    std::string identifier(char aBegin);
+    std::uint32_t offsetOf(const char *aPos) const {
+        return static_cast<std::uint32_t>(aPos - begin);
+    }
 
-    Token number(char aBegin);
+    Token number();
 
-public:
-    explicit Lexer(FILE *file) : saved(EOF_TOKEN, 0, 0) {
-        this->file = file;
-        line = 1;
-        col = 1;
+    // The next aLength characters as one token of type aType.
+    Token take(TokenType aType, int aLength);
+
+    // The character aOffset past the current one, or '\0' past the end.
+    char peek(int aOffset) const {
+        return end - cur > aOffset ? cur[aOffset] : '\0';
     }
 
-    ~Lexer();
+public:
+    /**
+     * @param aBuffer The source to lex. Its size must fit a Token's
+     *                32-bit offsets, i.e. be under 4 GiB.
+     * @param aInterner Where identifiers get their SymbolIds; must outlive
+     *                  this Lexer
+     */
+    Lexer(std::unique_ptr<llvm::MemoryBuffer> aBuffer, Interner &aInterner);
+
+    /**
+     * For callers that only have a FILE* (e.g. fuzz/fuzz_pipeline.cpp's
+     * fmemopen()): reads all of it into memory up front, then fclose()s
+     * it -- the Lexer takes ownership, as it always has.
+     */
+    Lexer(FILE *aFile, Interner &aInterner);
 
     Token lex();
 
+    /// The token's text: a slice of the source buffer (empty for EOF; the
+    /// offending character itself for an ERROR_TOKEN).
+    std::string_view getLexeme(const Token &aToken) const {
+        return std::string_view(begin + aToken.getOffset(), aToken.getLength());
+    }
+
     void unlex(Token aToken);
+
+    /// Where the token starts, as line:column. Cheap after the first call,
+    /// which scans the whole buffer once.
+    SourceLocation getLocation(const Token &aToken) const {
+        return sourceManager.getLocation(aToken.getOffset());
+    }
 };
\ No newline at end of file
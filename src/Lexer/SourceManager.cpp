@@ -0,0 +1,30 @@
+#include "SourceManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+void SourceManager::buildLineTable() const {
+    lineStarts.push_back(0);
+    const char *begin = source.data();
+    const char *end = begin + source.size();
+    for (const char *cur = begin; cur != end;) {
+        auto newline = static_cast<const char *>(std::memchr(cur, '\n', end - cur));
+        if (newline == nullptr) {
+            break;
+        }
+        cur = newline + 1;
+        lineStarts.push_back(static_cast<std::uint32_t>(cur - begin));
+    }
+}
+
+SourceLocation SourceManager::getLocation(std::uint32_t aOffset) const {
+    if (lineStarts.empty()) {
+        buildLineTable();
+    }
+
+    // The last line starting at or before aOffset.
+    auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), aOffset);
+    auto line = static_cast<int>(next - lineStarts.begin());
+    auto column = static_cast<int>(aOffset - *(next - 1)) + 1;
+    return SourceLocation{line, column};
+}
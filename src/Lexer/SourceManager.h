@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+/// A 1-based line and column, for diagnostics.
+struct SourceLocation {
+    int line;
+    int column;
+};
+
+/**
+ * Maps byte offsets in a source buffer back to line/column -- the only
+ * place Pudl works out where a line starts.
+ *
+ * Tokens (and anything built from them) only carry a byte offset. The
+ * lexer used to count lines and columns as it went, updating them per
+ * character, including every character of every comment, even though a
+ * location is only ever looked at when something is reported: a parse
+ * error, a type error, or a --debug trace. Here the offset of every line
+ * start is found with one memchr() pass over the buffer the first time a
+ * location is asked for, and each lookup after that is a binary search.
+ * A program that compiles cleanly never builds the table at all.
+ */
+class SourceManager {
+private:
+    llvm::StringRef source;
+    // Offset of the first byte of each line; lineStarts[0] == 0. Empty
+    // until the first getLocation().
+    mutable std::vector<std::uint32_t> lineStarts;
+
+    void buildLineTable() const;
+
+public:
+    /// @param aSource Must outlive this SourceManager
+    explicit SourceManager(llvm::StringRef aSource) : source(aSource) {}
+
+    /**
+     * @param aOffset A byte offset into the source, up to and including
+     *                its size (the end-of-file position)
+     */
+    SourceLocation getLocation(std::uint32_t aOffset) const;
+};
@@ -1,26 +1,26 @@
 #include "Token.h"
 
-Token::Token(TokenType type, const std::string& lexeme, int line, int col) {
+Token::Token(TokenType type, std::uint32_t offset, std::uint32_t length, SymbolId symbol) {
     this->type = type;
-    this->lexeme = lexeme;
-    this->line = line;
-    this->col = col;
+    this->offset = offset;
+    this->length = length;
+    this->symbol = symbol;
 }
 
-Token::Token(TokenType type, int line, int col) {
+Token::Token(TokenType type) {
     this->type = type;
-    this->lexeme = "";
-    this->line = line;
-    this->col = col;
+    this->offset = 0;
+    this->length = 0;
+    this->symbol = NoSymbol;
 }
 
-TokenType Token::getType() { return type; }
+TokenType Token::getType() const { return type; }
 
-std::string Token::getLexeme() { return lexeme; }
+std::uint32_t Token::getOffset() const { return offset; }
 
-int Token::getLine() const { return line; }
+std::uint32_t Token::getLength() const { return length; }
 
-int Token::getColumn() const { return col; }
+SymbolId Token::getSymbol() const { return symbol; }
 
 std::string Token::showType(TokenType aType) {
     switch (aType) {
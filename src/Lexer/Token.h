@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <type_traits>
+
+#include "Interner.h"
 
 enum TokenType {
     EOF_TOKEN,
@@ -26,24 +30,39 @@ enum TokenType {
     TYPE
 };
 
+/**
+ * One lexed token: its kind and where its text is in the source buffer
+ * (Lexer::getLexeme() turns that back into text), plus the interned ID of
+ * a SYMBOL's name.
+ *
+ * Trivially copyable and 16 bytes, with no heap storage of its own -- the
+ * parser copies tokens all the time (`Token t = current`), and each copy
+ * used to carry a std::string lexeme along with it. There's no line or
+ * column either: the offset is the location, and Lexer::getLocation()
+ * turns it into line:column on the rare occasions one is printed.
+ */
 class Token {
 private:
     TokenType type;
-    std::string lexeme;
-    int line, col;
+    std::uint32_t offset, length;
+    SymbolId symbol;
 
 public:
-    Token(TokenType aType, const std::string &aLexeme, int line, int col);
+    Token(TokenType aType, std::uint32_t aOffset, std::uint32_t aLength, SymbolId aSymbol = NoSymbol);
 
-    Token(TokenType aType, int line, int col);
+    explicit Token(TokenType aType);
 
-    TokenType getType();
+    TokenType getType() const;
 
-    std::string getLexeme();
+    /// Byte offset of the token's text in the source buffer.
+    std::uint32_t getOffset() const;
 
-    static std::string showType(TokenType aType);
+    std::uint32_t getLength() const;
+
+    /// The interned name of a SYMBOL token; NoSymbol for anything else.
+    SymbolId getSymbol() const;
 
-    int getLine() const;
+    static std::string showType(TokenType aType);
+};
 
-    int getColumn() const;
-};
\ No newline at end of file
+static_assert(std::is_trivially_copyable_v<Token>, "Tokens are copied freely -- keep them cheap to copy");
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "Whitespace.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PUDL_WHITESPACE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 isn't part of the x86-64 baseline the project is compiled for, so
+// it's compiled per function (target attribute) and only called after
+// checking the CPU at runtime -- which needs GCC/Clang builtins.
+#if defined(PUDL_WHITESPACE_SSE2) && (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define PUDL_WHITESPACE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+#ifdef PUDL_WHITESPACE_SSE2
+
+    int countTrailingZeros(std::uint32_t aMask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, aMask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(aMask);
+#endif
+    }
+
+#endif
+
+    const char *skipScalar(const char *aCur, const char *aEnd) {
+        while (aCur != aEnd && Whitespace::IsSpace(*aCur)) {
+            ++aCur;
+        }
+        return aCur;
+    }
+
+#ifdef PUDL_WHITESPACE_SSE2
+
+    const char *skipSse2(const char *aBegin, const char *aEnd) {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i controlRange = _mm_set1_epi8('\r' - '\t');
+
+        const char *cur = aBegin;
+        for (; aEnd - cur >= 16; cur += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur));
+            // \t..\r is one contiguous range: (byte - '\t') <= 4, unsigned.
+            __m128i offset = _mm_sub_epi8(bytes, tab);
+            __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(offset, controlRange), offset);
+            __m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(bytes, space), isControl);
+
+            auto stop = ~static_cast<std::uint32_t>(_mm_movemask_epi8(isSpace)) & 0xFFFF;
+            if (stop != 0) {
+                return cur + countTrailingZeros(stop);
+            }
+        }
+
+        return skipScalar(cur, aEnd);
+    }
+
+#endif
+
+#ifdef PUDL_WHITESPACE_AVX2
+
+    __attribute__((target("avx2")))
+    const char *skipAvx2(const char *aBegin, const char *aEnd) {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i controlRange = _mm256_set1_epi8('\r' - '\t');
+
+        const char *cur = aBegin;
+        for (; aEnd - cur >= 32; cur += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur));
+            __m256i offset = _mm256_sub_epi8(bytes, tab);
+            __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, controlRange), offset);
+            __m256i isSpace = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), isControl);
+
+            auto stop = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(isSpace));
+            if (stop != 0) {
+                return cur + countTrailingZeros(stop);
+            }
+        }
+
+        // The last < 32 bytes: SSE2 for what fits in 16, then scalar.
+        return skipSse2(cur, aEnd);
+    }
+
+    using SkipFunction = const char *(*)(const char *, const char *);
+
+    SkipFunction selectSkip() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? skipAvx2 : skipSse2;
+    }
+
+#endif
+
+}
+
+const char *Whitespace::Skip(const char *aBegin, const char *aEnd) {
+    // Most runs between tokens are zero or one character long: don't pay
+    // for a vector load (or the dispatch) to find that out.
+    if (aBegin == aEnd || !IsSpace(*aBegin)) {
+        return aBegin;
+    }
+    if (aEnd - aBegin == 1 || !IsSpace(aBegin[1])) {
+        return aBegin + 1;
+    }
+
+#if defined(PUDL_WHITESPACE_AVX2)
+    static const SkipFunction skip = selectSkip();
+    return skip(aBegin, aEnd);
+#elif defined(PUDL_WHITESPACE_SSE2)
+    return skipSse2(aBegin, aEnd);
+#else
+    return skipScalar(aBegin, aEnd);
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+/**
+ * Skips runs of whitespace (C-locale isspace(): space, \t, \n, \v, \f, \r)
+ * 16 or 32 bytes at a time instead of one character at a time: SSE2 on
+ * every x86-64 CPU, AVX2 where the CPU has it (picked once at startup,
+ * GCC/Clang only), and a plain scalar loop everywhere else and for the
+ * last few bytes of the buffer.
+ *
+ * Generated Pudl sources are mostly indentation and comments, so this is
+ * the lexer's hottest loop. It used to advance (and update line/column
+ * counters) per character; the vector versions find the first
+ * non-whitespace byte straight from the comparison mask. Line numbers
+ * aren't tracked here at all -- see SourceManager.
+ */
+class Whitespace {
+public:
+    /// @return the first non-whitespace byte in [aBegin, aEnd), or aEnd
+    static const char *Skip(const char *aBegin, const char *aEnd);
+
+    static bool IsSpace(char aCh) {
+        return aCh == ' ' || (aCh >= '\t' && aCh <= '\r');
+    }
+};
@@ -1,6 +1,6 @@
 #include "ASTVisitor.h"
 
-OperatorKind binaryOperatorFromLexeme(const std::string &aLexeme) {
+OperatorKind binaryOperatorFromLexeme(std::string_view aLexeme) {
     if (aLexeme == "+") return OperatorKind::Add;
     if (aLexeme == "-") return OperatorKind::Sub;
     if (aLexeme == "*") return OperatorKind::Mul;
@@ -16,7 +16,7 @@ OperatorKind binaryOperatorFromLexeme(const std::string &aLexeme) {
     return OperatorKind::Add;
 }
 
-OperatorKind unaryOperatorFromLexeme(const std::string &aLexeme) {
+OperatorKind unaryOperatorFromLexeme(std::string_view aLexeme) {
     if (aLexeme == "-") return OperatorKind::Neg;
     if (aLexeme == "+") return OperatorKind::Pos;
     if (aLexeme == "!") return OperatorKind::Not;
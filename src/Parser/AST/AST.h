@@ -1,33 +1,57 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <vector>
+#include <string_view>
+
+#include <llvm/ADT/ArrayRef.h>
+
 #include "../../Compiler/Type.h"
+#include "../../Lexer/Interner.h"
 
 class ASTVisitor;
 
+class BinaryNode;
+
+// One per concrete Node class, named after it. Every Node carries its
+// own (Node::getKind()); a FlatAST (FlatAST.h) stores each of its nodes'
+// kind as one of these in place of a class.
+enum class NodeKind : std::uint8_t {
+    Vector, Dummy, Var, Funcall, Boolean, Integer, Float, Binary, Unary,
+    Assignment, FunctionDef, BlockStatement, IfStatement, WhileStatement,
+    DoWhileStatement, ExpressionWrapper, IoPrint, Return
+};
+
+// Every node is allocated in the Parser's Arena, and so must be
+// trivially destructible (see Arena.h): child lists are arena-allocated
+// arrays (llvm::ArrayRef), names are views of the Interner's copy.
+// Accessors hand out those same views -- a visitor iterating a node's
+// children (`for (Node *child: aNode.getNodes())`) or reading its name
+// never copies either.
 class Node {
 protected:
     TType type;
+    NodeKind kind;
 public:
     virtual void accept(ASTVisitor &aVisitor) = 0;
 
     TType getType() { return type; }
+
+    // Which concrete class this node is: what StaticVisitor.h's one switch
+    // dispatches on, in place of accept()'s virtual call.
+    NodeKind getKind() const { return kind; }
 };
 
 class VectorNode : public Node {
 private:
-    std::vector<Node *> nodes;
+    llvm::ArrayRef<Node *> nodes;
 public:
-    VectorNode(std::vector<Node *> aNodes) : nodes(aNodes) {
+    VectorNode(llvm::ArrayRef<Node *> aNodes) : nodes(aNodes) {
+        kind = NodeKind::Vector;
         type = TType::UNDEFINED;
     }
 
-    void insert(Node *aNode) {
-        nodes.push_back(aNode);
-    }
-
-    std::vector<Node *> getNodes() { return nodes; }
+    llvm::ArrayRef<Node *> getNodes() const { return nodes; }
 
     void accept(ASTVisitor &aVisitor);
 };
@@ -35,6 +59,7 @@ public:
 class DummyNode : public Node {
 public:
     DummyNode() {
+        kind = NodeKind::Dummy;
         type = TType::INTEGER;
     }
 
@@ -44,6 +69,11 @@ public:
 class ExpressionNode : public Node {
 public:
     virtual void accept(ASTVisitor &aVisitor) = 0;
+
+    // Lets a visitor walk a chain of binary operations in a loop instead
+    // of recursing through accept() once per operator (see
+    // Codegen::visit(BinaryNode &)).
+    virtual BinaryNode *asBinary() { return nullptr; }
 };
 
 // Binary/unary operators, previously stored on BinaryNode/UnaryNode as raw
@@ -51,7 +81,7 @@ public:
 // Codegen.h -- slower, and a typo here silently produces a no-op/NULL
 // instead of a compile error. Pos/Neg/Not are the unary forms (`+x`, `-x`,
 // `!x`); Add/Sub double as the binary forms of the same `+`/`-` lexemes.
-enum class OperatorKind {
+enum class OperatorKind : std::uint8_t {
     Add, Sub, Mul, Div,
     Eq, Ne, Gt, Lt, Ge, Le,
     And, Or,
@@ -61,41 +91,53 @@ enum class OperatorKind {
 // aLexeme must be a lexeme the lexer/parser actually recognize for the
 // requested context (binary vs. unary) -- these are total only over that
 // domain, matching every call site's precondition of having already parsed
-// a valid operator token.
-OperatorKind binaryOperatorFromLexeme(const std::string &aLexeme);
+// a valid operator token. A view, so the token's lexeme is read in place.
+OperatorKind binaryOperatorFromLexeme(std::string_view aLexeme);
 
-OperatorKind unaryOperatorFromLexeme(const std::string &aLexeme);
+OperatorKind unaryOperatorFromLexeme(std::string_view aLexeme);
 
 // Inverse of the two functions above -- e.g. for debug printing.
 std::string showOperator(OperatorKind aOp);
 
+// VarNode, FuncallNode and FunctionDefNode keep the name's interned
+// SymbolId next to its text: symbol tables (SymbolTable.h) key on the ID,
+// the text is for messages and for naming things in the IR. The text is
+// the Interner's own copy (Interner::getName()), which outlives the AST.
 class VarNode : public ExpressionNode {
 private:
-    std::string name;
+    std::string_view name;
+    SymbolId symbol;
 public:
-    VarNode(std::string aName, TType aType) : name(aName) {
+    VarNode(std::string_view aName, SymbolId aSymbol, TType aType) : name(aName), symbol(aSymbol) {
+        kind = NodeKind::Var;
         type = aType;
     }
 
-    std::string getName() { return name; }
+    std::string_view getName() const { return name; }
+
+    SymbolId getSymbol() { return symbol; }
 
     void accept(ASTVisitor &aVisitor);
 };
 
 class FuncallNode : public ExpressionNode {
 private:
-    std::string name;
-    std::vector<ExpressionNode *> args;
+    std::string_view name;
+    SymbolId symbol;
+    llvm::ArrayRef<ExpressionNode *> args;
 public:
     FuncallNode(
-            std::string aName, std::vector<ExpressionNode *> aArgs, TType aType
-    ) : name(aName), args(aArgs) {
+            std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<ExpressionNode *> aArgs, TType aType
+    ) : name(aName), symbol(aSymbol), args(aArgs) {
+        kind = NodeKind::Funcall;
         type = aType;
     }
 
-    std::string getName() { return name; }
+    std::string_view getName() const { return name; }
 
-    std::vector<ExpressionNode *> getArgs() { return args; }
+    SymbolId getSymbol() { return symbol; }
+
+    llvm::ArrayRef<ExpressionNode *> getArgs() const { return args; }
 
     void accept(ASTVisitor &aVisitor);
 };
@@ -105,6 +147,7 @@ private:
     bool value;
 public:
     BooleanNode(bool aValue) : value(aValue) {
+        kind = NodeKind::Boolean;
         type = TType::BOOL;
     }
 
@@ -118,6 +161,7 @@ private:
     int value;
 public:
     IntegerNode(int aValue) : value(aValue) {
+        kind = NodeKind::Integer;
         type = TType::INTEGER;
     }
 
@@ -131,6 +175,7 @@ private:
     float value;
 public:
     FloatNode(float aValue) : value(aValue) {
+        kind = NodeKind::Float;
         type = TType::FLOAT;
     }
 
@@ -148,6 +193,7 @@ public:
     BinaryNode(
             TType aType, OperatorKind aOp, ExpressionNode *aLHS, ExpressionNode *aRHS
     ) : op(aOp), lhs(aLHS), rhs(aRHS) {
+        kind = NodeKind::Binary;
         type = aType;
     }
 
@@ -157,6 +203,8 @@ public:
 
     ExpressionNode *getRHS() { return rhs; }
 
+    BinaryNode *asBinary() override { return this; }
+
     void accept(ASTVisitor &aVisitor);
 };
 
@@ -168,6 +216,7 @@ public:
     UnaryNode(
             OperatorKind aOp, ExpressionNode *aSubexpr
     ) : op(aOp), subexpr(aSubexpr) {
+        kind = NodeKind::Unary;
         type = aSubexpr->getType();
     }
 
@@ -189,6 +238,7 @@ private:
 public:
     IoPrintNode(ExpressionNode *aSubexpr)
             : subexpr(aSubexpr) {
+        kind = NodeKind::IoPrint;
         type = TType::UNDEFINED;
     }
 
@@ -203,6 +253,7 @@ private:
 public:
     ReturnNode(ExpressionNode *aSubexpr)
             : subexpr(aSubexpr) {
+        kind = NodeKind::Return;
         type = aSubexpr->getType();
     }
 
@@ -217,6 +268,7 @@ private:
 public:
     ExpressionWrapperNode(ExpressionNode *aExpr)
             : expression(aExpr) {
+        kind = NodeKind::ExpressionWrapper;
         type = aExpr->getType();
     }
 
@@ -232,6 +284,7 @@ private:
 public:
     AssignmentNode(VarNode *aVariable, ExpressionNode *aRHS)
             : lhs(aVariable), rhs(aRHS) {
+        kind = NodeKind::Assignment;
         type = lhs->getType();
     }
 
@@ -244,19 +297,16 @@ public:
 
 class BlockStatementNode : public StatementNode {
 private:
-    std::vector<StatementNode *> statements;
+    llvm::ArrayRef<StatementNode *> statements;
 public:
     BlockStatementNode(
-            std::vector<StatementNode *> aStatements
+            llvm::ArrayRef<StatementNode *> aStatements
     ) : statements(aStatements) {
+        kind = NodeKind::BlockStatement;
         type = TType::UNDEFINED; // type = type-of-last-statement
     }
 
-    std::vector<StatementNode *> getStatements() { return statements; }
-
-    void insert(StatementNode *aNode) {
-        statements.push_back(aNode);
-    }
+    llvm::ArrayRef<StatementNode *> getStatements() const { return statements; }
 
     void accept(ASTVisitor &aVisitor);
 };
@@ -270,6 +320,7 @@ public:
     IfStatementNode(
             ExpressionNode *aCond, StatementNode *aTrueBranch, StatementNode *aFalseBranch = NULL
     ) : cond(aCond), trueBranch(aTrueBranch), falseBranch(aFalseBranch) {
+        kind = NodeKind::IfStatement;
         type = TType::UNDEFINED;
     }
 
@@ -289,6 +340,7 @@ private:
 public:
     WhileStatementNode(ExpressionNode *aCond, StatementNode *aBody)
             : cond(aCond), body(aBody) {
+        kind = NodeKind::WhileStatement;
         type = TType::UNDEFINED;
     }
 
@@ -306,6 +358,7 @@ private:
 public:
     DoWhileStatementNode(ExpressionNode *aCond, StatementNode *aBody)
             : cond(aCond), body(aBody) {
+        kind = NodeKind::DoWhileStatement;
         type = TType::UNDEFINED;
     }
 
@@ -318,20 +371,24 @@ public:
 
 class FunctionDefNode : public Node {
 private:
-    std::string name;
-    std::vector<VarNode *> args;
+    std::string_view name;
+    SymbolId symbol;
+    llvm::ArrayRef<VarNode *> args;
     StatementNode *body;
 public:
     FunctionDefNode(
-            std::string aName, std::vector<VarNode *> aArgs,
+            std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<VarNode *> aArgs,
             StatementNode *aBody, TType aType
-    ) : name(aName), args(aArgs), body(aBody) {
+    ) : name(aName), symbol(aSymbol), args(aArgs), body(aBody) {
+        kind = NodeKind::FunctionDef;
         type = aType;
     }
 
-    std::string getName() { return name; }
+    std::string_view getName() const { return name; }
+
+    SymbolId getSymbol() { return symbol; }
 
-    std::vector<VarNode *> getArgs() { return args; }
+    llvm::ArrayRef<VarNode *> getArgs() const { return args; }
 
     StatementNode *getBody() { return body; }
 
@@ -2,11 +2,15 @@
 
 #include "AST.h"
 
+// Dispatched through two virtual calls per node: Node::accept(), then
+// visit(). Codegen, Printer and the other visitors in this tree use
+// StaticVisitor.h's switch instead; this interface is kept for visitors
+// that are picked at run time, or written outside this tree.
 class ASTVisitor {
 public:
     // Nodes are taken by reference, not by value: they're arena-owned (see
     // Arena.h) and live for the whole compilation, so a visitor is free to
-    // keep a pointer into one (e.g. Codegen.h's currentFunc) past the end
+    // keep a pointer into one (e.g. Codegen.h's astFuncs) past the end
     // of a single visit() call -- taking nodes by value would silently
     // hand out a pointer to a stack-local copy instead.
     virtual void visit(VectorNode &aNode) = 0;
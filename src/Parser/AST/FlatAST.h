@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include "AST.h"
+
+/// A FlatAST node: its position in the FlatAST's arrays.
+using NodeIndex = std::uint32_t;
+
+/// The NodeIndex of a node that isn't there (an `if` without an `else`).
+constexpr NodeIndex NoNode = ~NodeIndex(0);
+
+/**
+ * The AST as parallel arrays (struct-of-arrays) instead of a graph of
+ * Node objects -- the representation FlatParser (Parser.h) builds, and
+ * Codegen/Printer walk with one switch over each node's kind rather than
+ * a virtual accept()/visit() pair per node (main.cpp's --ast=flat).
+ *
+ * Node i is kinds[i], types[i], ops[i], first[i] and second[i]: 11 bytes,
+ * against 16 to 64 for a Node (vtable pointer included), with children
+ * named by 32-bit index instead of 64-bit pointer. Nodes are appended as
+ * the parser finishes them -- children before their parents, except that
+ * a function comes before its body (see Parser::functionDef()) -- so a
+ * walk mostly reads each array front to back. What first and second hold
+ * depends on the kind:
+ *
+ *   Vector                      list of functions
+ *   Var                         SymbolId
+ *   Funcall                     SymbolId            list of arguments
+ *   Boolean, Integer            value
+ *   Float                       value's bits
+ *   Binary                      lhs                 rhs
+ *   Unary, IoPrint, Return,     subexpression
+ *     ExpressionWrapper
+ *   Assignment                  variable            rhs
+ *   BlockStatement              list of statements
+ *   IfStatement                 condition           slots: then, else (or NoNode)
+ *   WhileStatement,             condition           body
+ *     DoWhileStatement
+ *   FunctionDef                 SymbolId            slots: body, then list of arguments
+ *
+ * A list is an offset into `lists` where its length is stored, followed
+ * by its items; a slot is a single entry there. Binary and Unary keep
+ * their operator in ops. A name is looked up by SymbolId in `names`, a
+ * view of the parser's Interner's copy. As in a Node tree, a variable's
+ * declaration and every use of it are one and the same Var node.
+ *
+ * The layout itself is FlatBuilder's (ASTBuilder.h) to write and
+ * FlatNode's (below) to read; this class only stores it. ASTFile
+ * (ASTFile.h) saves and loads the arrays as they are.
+ */
+class FlatAST {
+private:
+    friend class ASTFile;
+
+    std::vector<NodeKind> kinds;
+    std::vector<TType> types;
+    std::vector<OperatorKind> ops;
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> second;
+
+    std::vector<NodeIndex> lists;
+    std::vector<std::string_view> names;
+
+public:
+    NodeIndex add(NodeKind aKind, TType aType, std::uint32_t aFirst, std::uint32_t aSecond = 0,
+                  OperatorKind aOp = OperatorKind::Add) {
+        kinds.push_back(aKind);
+        types.push_back(aType);
+        ops.push_back(aOp);
+        first.push_back(aFirst);
+        second.push_back(aSecond);
+        return static_cast<NodeIndex>(kinds.size() - 1);
+    }
+
+    /// Appends aSlots to `lists` as they are; returns where they start.
+    std::uint32_t addSlots(llvm::ArrayRef<NodeIndex> aSlots) {
+        auto offset = static_cast<std::uint32_t>(lists.size());
+        lists.insert(lists.end(), aSlots.begin(), aSlots.end());
+        return offset;
+    }
+
+    /// Appends aItems' length, then aItems; returns where the list starts.
+    std::uint32_t addList(llvm::ArrayRef<NodeIndex> aItems) {
+        std::uint32_t offset = addSlots(static_cast<NodeIndex>(aItems.size()));
+        addSlots(aItems);
+        return offset;
+    }
+
+    void setSlot(std::uint32_t aOffset, NodeIndex aNode) { lists[aOffset] = aNode; }
+
+    void setName(SymbolId aSymbol, std::string_view aName) {
+        if (aSymbol >= names.size()) {
+            names.resize(aSymbol + 1);
+        }
+        names[aSymbol] = aName;
+    }
+
+    NodeKind getKind(NodeIndex aNode) const { return kinds[aNode]; }
+
+    TType getType(NodeIndex aNode) const { return types[aNode]; }
+
+    OperatorKind getOp(NodeIndex aNode) const { return ops[aNode]; }
+
+    std::uint32_t getFirst(NodeIndex aNode) const { return first[aNode]; }
+
+    std::uint32_t getSecond(NodeIndex aNode) const { return second[aNode]; }
+
+    NodeIndex getSlot(std::uint32_t aOffset) const { return lists[aOffset]; }
+
+    llvm::ArrayRef<NodeIndex> getList(std::uint32_t aOffset) const {
+        return llvm::ArrayRef<NodeIndex>(lists.data() + aOffset + 1, lists[aOffset]);
+    }
+
+    std::string_view getName(SymbolId aSymbol) const { return names[aSymbol]; }
+
+    std::size_t size() const { return kinds.size(); }
+
+    /// Bytes the arrays hold (not counting capacity they haven't used yet).
+    std::size_t getBytesUsed() const {
+        return kinds.size() * (sizeof(NodeKind) + sizeof(TType) + sizeof(OperatorKind) + 2 * sizeof(std::uint32_t))
+               + lists.size() * sizeof(NodeIndex) + names.size() * sizeof(std::string_view);
+    }
+};
+
+class FlatNodeList;
+
+/**
+ * A node of a FlatAST, used the way a Node pointer is: -> reaches
+ * accessors named like Node's subclasses' own (getLHS(), getBody(),
+ * getArgs(), ...), and it compares equal to nullptr when it's no node at
+ * all. That lets code be written once, as a template, for both
+ * representations -- see Codegen.h and Printer.h. Only the accessors of
+ * the node's own kind mean anything; a literal's value comes from
+ * getBoolValue()/getIntValue()/getFloatValue(), its kind telling which.
+ */
+class FlatNode {
+private:
+    const FlatAST *ast = nullptr;
+    NodeIndex index = NoNode;
+
+    FlatNode at(NodeIndex aIndex) const { return FlatNode(ast, aIndex); }
+
+public:
+    FlatNode() = default;
+
+    FlatNode(std::nullptr_t) {}
+
+    FlatNode(const FlatAST *aAST, NodeIndex aIndex) : ast(aAST), index(aIndex) {}
+
+    const FlatNode *operator->() const { return this; }
+
+    explicit operator bool() const { return index != NoNode; }
+
+    friend bool operator==(FlatNode aLHS, std::nullptr_t) { return aLHS.index == NoNode; }
+
+    friend bool operator!=(FlatNode aLHS, std::nullptr_t) { return aLHS.index != NoNode; }
+
+    friend bool operator==(FlatNode aLHS, FlatNode aRHS) { return aLHS.index == aRHS.index; }
+
+    friend bool operator!=(FlatNode aLHS, FlatNode aRHS) { return aLHS.index != aRHS.index; }
+
+    NodeIndex getIndex() const { return index; }
+
+    NodeKind getKind() const { return ast->getKind(index); }
+
+    TType getType() const { return ast->getType(index); }
+
+    OperatorKind getOp() const { return ast->getOp(index); }
+
+    SymbolId getSymbol() const { return ast->getFirst(index); }
+
+    std::string_view getName() const { return ast->getName(getSymbol()); }
+
+    bool getBoolValue() const { return ast->getFirst(index) != 0; }
+
+    int getIntValue() const { return static_cast<int>(ast->getFirst(index)); }
+
+    float getFloatValue() const {
+        std::uint32_t bits = ast->getFirst(index);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    FlatNode getLHS() const { return at(ast->getFirst(index)); }
+
+    FlatNode getRHS() const { return at(ast->getSecond(index)); }
+
+    FlatNode getSubexpr() const { return at(ast->getFirst(index)); }
+
+    FlatNode getExpr() const { return at(ast->getFirst(index)); }
+
+    FlatNode getCond() const { return at(ast->getFirst(index)); }
+
+    FlatNode getTrueBranch() const { return at(ast->getSlot(ast->getSecond(index))); }
+
+    FlatNode getFalseBranch() const { return at(ast->getSlot(ast->getSecond(index) + 1)); }
+
+    FlatNode getBody() const {
+        return getKind() == NodeKind::FunctionDef
+               ? at(ast->getSlot(ast->getSecond(index)))
+               : at(ast->getSecond(index));
+    }
+
+    FlatNode asBinary() const { return getKind() == NodeKind::Binary ? *this : FlatNode(); }
+
+    inline FlatNodeList getNodes() const;
+
+    inline FlatNodeList getStatements() const;
+
+    inline FlatNodeList getArgs() const;
+};
+
+/// A FlatAST list (see FlatAST) as a range of FlatNodes, like the
+/// llvm::ArrayRef a Node's own child list is.
+class FlatNodeList {
+private:
+    const FlatAST *ast;
+    llvm::ArrayRef<NodeIndex> items;
+
+public:
+    class iterator {
+    private:
+        const FlatAST *ast;
+        const NodeIndex *item;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatNode;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const FlatNode *;
+        using reference = FlatNode;
+
+        iterator(const FlatAST *aAST, const NodeIndex *aItem) : ast(aAST), item(aItem) {}
+
+        FlatNode operator*() const { return FlatNode(ast, *item); }
+
+        iterator &operator++() {
+            ++item;
+            return *this;
+        }
+
+        bool operator==(const iterator &aOther) const { return item == aOther.item; }
+
+        bool operator!=(const iterator &aOther) const { return item != aOther.item; }
+    };
+
+    FlatNodeList(const FlatAST *aAST, llvm::ArrayRef<NodeIndex> aItems) : ast(aAST), items(aItems) {}
+
+    iterator begin() const { return iterator(ast, items.begin()); }
+
+    iterator end() const { return iterator(ast, items.end()); }
+
+    std::size_t size() const { return items.size(); }
+
+    bool empty() const { return items.empty(); }
+
+    FlatNode operator[](std::size_t aIndex) const { return FlatNode(ast, items[aIndex]); }
+};
+
+FlatNodeList FlatNode::getNodes() const { return FlatNodeList(ast, ast->getList(ast->getFirst(index))); }
+
+FlatNodeList FlatNode::getStatements() const { return FlatNodeList(ast, ast->getList(ast->getFirst(index))); }
+
+FlatNodeList FlatNode::getArgs() const {
+    return getKind() == NodeKind::FunctionDef
+           ? FlatNodeList(ast, ast->getList(ast->getSecond(index) + 1))
+           : FlatNodeList(ast, ast->getList(ast->getSecond(index)));
+}
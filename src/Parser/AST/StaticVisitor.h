@@ -0,0 +1,97 @@
+#pragma once
+
+#include <llvm/Support/Compiler.h>
+
+#include "AST.h"
+
+/**
+ * A visitor whose dispatch is one switch over the node's kind
+ * (Node::getKind()) instead of ASTVisitor's two virtual calls per node --
+ * Node::accept(), then the visitor's visit(). Derived, the visitor itself
+ * (CRTP: `class Codegen : public StaticVisitor<Codegen>`), has a visit()
+ * for every concrete Node class, the same set ASTVisitor declares; they
+ * aren't virtual, so the compiler sees which one each case calls and can
+ * inline it, and the node is never asked which class it is through its
+ * vtable.
+ *
+ * A visitor walks a node's children by calling dispatch() on them where
+ * an ASTVisitor would call child->accept(*this). ASTVisitor and
+ * Node::accept() stay as they are, for visitors that need to be chosen at
+ * run time (or that live outside this tree); Codegen, Printer and the
+ * passes in this tree use this one.
+ *
+ * dispatch() is forced inline, so every place that walks a child gets its
+ * own switch (its own indirect jump, predicted on its own, as each
+ * accept() call site is), and a leaf's visit() -- a VarNode's, an
+ * IntegerNode's -- ends up inlined right there. In a visitor that does
+ * little more per node than walk on (an analysis pass), mark the visit()s
+ * that walk children LLVM_ATTRIBUTE_NOINLINE, though: inlined, the
+ * recursion folds into one large function that saves and restores every
+ * register it uses on every node, leaf or not, and the walk ends up
+ * slower than with virtual calls (bench/bench_visitor.cpp measures both
+ * ways). Codegen's and Printer's visit()s do far more than that per node,
+ * and don't bother.
+ */
+template<typename Derived>
+class StaticVisitor {
+public:
+    LLVM_ATTRIBUTE_ALWAYS_INLINE void dispatch(Node *aNode) {
+        Derived &self = static_cast<Derived &>(*this);
+        switch (aNode->getKind()) {
+            case NodeKind::Vector:
+                self.visit(static_cast<VectorNode &>(*aNode));
+                break;
+            case NodeKind::Dummy:
+                self.visit(static_cast<DummyNode &>(*aNode));
+                break;
+            case NodeKind::Var:
+                self.visit(static_cast<VarNode &>(*aNode));
+                break;
+            case NodeKind::Funcall:
+                self.visit(static_cast<FuncallNode &>(*aNode));
+                break;
+            case NodeKind::Boolean:
+                self.visit(static_cast<BooleanNode &>(*aNode));
+                break;
+            case NodeKind::Integer:
+                self.visit(static_cast<IntegerNode &>(*aNode));
+                break;
+            case NodeKind::Float:
+                self.visit(static_cast<FloatNode &>(*aNode));
+                break;
+            case NodeKind::Binary:
+                self.visit(static_cast<BinaryNode &>(*aNode));
+                break;
+            case NodeKind::Unary:
+                self.visit(static_cast<UnaryNode &>(*aNode));
+                break;
+            case NodeKind::Assignment:
+                self.visit(static_cast<AssignmentNode &>(*aNode));
+                break;
+            case NodeKind::FunctionDef:
+                self.visit(static_cast<FunctionDefNode &>(*aNode));
+                break;
+            case NodeKind::BlockStatement:
+                self.visit(static_cast<BlockStatementNode &>(*aNode));
+                break;
+            case NodeKind::IfStatement:
+                self.visit(static_cast<IfStatementNode &>(*aNode));
+                break;
+            case NodeKind::WhileStatement:
+                self.visit(static_cast<WhileStatementNode &>(*aNode));
+                break;
+            case NodeKind::DoWhileStatement:
+                self.visit(static_cast<DoWhileStatementNode &>(*aNode));
+                break;
+            case NodeKind::ExpressionWrapper:
+                self.visit(static_cast<ExpressionWrapperNode &>(*aNode));
+                break;
+            case NodeKind::IoPrint:
+                self.visit(static_cast<IoPrintNode &>(*aNode));
+                break;
+            case NodeKind::Return:
+                self.visit(static_cast<ReturnNode &>(*aNode));
+                break;
+        }
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include "AST/AST.h"
+#include "AST/Arena.h"
+#include "AST/FlatAST.h"
+
+/**
+ * What a Parser builds its AST with. Parser.cpp's grammar is written
+ * once, against this interface, and instantiated for both builders:
+ * TreeBuilder makes Node objects in an Arena (Parser), FlatBuilder a
+ * FlatAST (FlatParser). Each one has
+ *  - the handle types the parser passes nodes around as: Expr, Stmt, Var
+ *    (a variable), Func (a function definition) and Result (anything,
+ *    e.g. the whole program). A handle is null (== nullptr) for "no
+ *    node", and -> on it reaches getType();
+ *  - one method per kind of node, taking what the node's constructor in
+ *    AST.h does, child lists as an llvm::ArrayRef of handles;
+ *  - setBody(), for a function whose body is only parsed after the
+ *    function itself has been declared (see Parser::functionDef()).
+ */
+class TreeBuilder {
+private:
+    // Owns every node built -- they live as long as this builder, i.e.
+    // the Parser, does (see Arena.h).
+    Arena arena;
+
+public:
+    using Expr = ExpressionNode *;
+    using Stmt = StatementNode *;
+    using Var = VarNode *;
+    using Func = FunctionDefNode *;
+    using Result = Node *;
+
+    const Arena &getArena() const { return arena; }
+
+    Result program(llvm::ArrayRef<Result> aFunctions) {
+        return arena.construct<VectorNode>(arena.copy<Node *>(aFunctions));
+    }
+
+    Result dummy() { return arena.construct<DummyNode>(); }
+
+    Var var(std::string_view aName, SymbolId aSymbol, TType aType) {
+        return arena.construct<VarNode>(aName, aSymbol, aType);
+    }
+
+    Expr funcall(std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<Expr> aArgs, TType aType) {
+        return arena.construct<FuncallNode>(aName, aSymbol, arena.copy<ExpressionNode *>(aArgs), aType);
+    }
+
+    Expr boolean(bool aValue) { return arena.construct<BooleanNode>(aValue); }
+
+    Expr integer(int aValue) { return arena.construct<IntegerNode>(aValue); }
+
+    Expr floating(float aValue) { return arena.construct<FloatNode>(aValue); }
+
+    Expr binary(TType aType, OperatorKind aOp, Expr aLHS, Expr aRHS) {
+        return arena.construct<BinaryNode>(aType, aOp, aLHS, aRHS);
+    }
+
+    Expr unary(OperatorKind aOp, Expr aSubexpr) { return arena.construct<UnaryNode>(aOp, aSubexpr); }
+
+    Stmt ioPrint(Expr aSubexpr) { return arena.construct<IoPrintNode>(aSubexpr); }
+
+    Stmt ret(Expr aSubexpr) { return arena.construct<ReturnNode>(aSubexpr); }
+
+    Stmt expressionWrapper(Expr aExpr) { return arena.construct<ExpressionWrapperNode>(aExpr); }
+
+    Stmt assignment(Var aVariable, Expr aRHS) { return arena.construct<AssignmentNode>(aVariable, aRHS); }
+
+    Stmt block(llvm::ArrayRef<Stmt> aStatements) {
+        return arena.construct<BlockStatementNode>(arena.copy<StatementNode *>(aStatements));
+    }
+
+    Stmt ifStatement(Expr aCond, Stmt aTrueBranch, Stmt aFalseBranch = nullptr) {
+        return arena.construct<IfStatementNode>(aCond, aTrueBranch, aFalseBranch);
+    }
+
+    Stmt whileStatement(Expr aCond, Stmt aBody) { return arena.construct<WhileStatementNode>(aCond, aBody); }
+
+    Stmt doWhileStatement(Expr aCond, Stmt aBody) { return arena.construct<DoWhileStatementNode>(aCond, aBody); }
+
+    Func functionDef(std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<Var> aArgs, TType aType) {
+        return arena.construct<FunctionDefNode>(aName, aSymbol, arena.copy<VarNode *>(aArgs), nullptr, aType);
+    }
+
+    void setBody(Func aFunction, Stmt aBody) { aFunction->setBody(aBody); }
+};
+
+/// Builds a FlatAST, in the layout described there.
+class FlatBuilder {
+private:
+    // Behind a pointer so the FlatNodes handed out, which point at it,
+    // survive the builder (and the Parser around it) being moved.
+    std::unique_ptr<FlatAST> ast = std::make_unique<FlatAST>();
+
+    FlatNode node(NodeIndex aIndex) const { return FlatNode(ast.get(), aIndex); }
+
+    static std::vector<NodeIndex> indices(llvm::ArrayRef<FlatNode> aNodes) {
+        std::vector<NodeIndex> result;
+        result.reserve(aNodes.size());
+        for (FlatNode node: aNodes) {
+            result.push_back(node.getIndex());
+        }
+        return result;
+    }
+
+public:
+    using Expr = FlatNode;
+    using Stmt = FlatNode;
+    using Var = FlatNode;
+    using Func = FlatNode;
+    using Result = FlatNode;
+
+    const FlatAST &getAST() const { return *ast; }
+
+    Result program(llvm::ArrayRef<Result> aFunctions) {
+        return node(ast->add(NodeKind::Vector, TType::UNDEFINED, ast->addList(indices(aFunctions))));
+    }
+
+    Result dummy() { return node(ast->add(NodeKind::Dummy, TType::INTEGER, 0)); }
+
+    Var var(std::string_view aName, SymbolId aSymbol, TType aType) {
+        ast->setName(aSymbol, aName);
+        return node(ast->add(NodeKind::Var, aType, aSymbol));
+    }
+
+    Expr funcall(std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<Expr> aArgs, TType aType) {
+        ast->setName(aSymbol, aName);
+        return node(ast->add(NodeKind::Funcall, aType, aSymbol, ast->addList(indices(aArgs))));
+    }
+
+    Expr boolean(bool aValue) { return node(ast->add(NodeKind::Boolean, TType::BOOL, aValue)); }
+
+    Expr integer(int aValue) {
+        return node(ast->add(NodeKind::Integer, TType::INTEGER, static_cast<std::uint32_t>(aValue)));
+    }
+
+    Expr floating(float aValue) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &aValue, sizeof(bits));
+        return node(ast->add(NodeKind::Float, TType::FLOAT, bits));
+    }
+
+    Expr binary(TType aType, OperatorKind aOp, Expr aLHS, Expr aRHS) {
+        return node(ast->add(NodeKind::Binary, aType, aLHS.getIndex(), aRHS.getIndex(), aOp));
+    }
+
+    Expr unary(OperatorKind aOp, Expr aSubexpr) {
+        return node(ast->add(NodeKind::Unary, aSubexpr->getType(), aSubexpr.getIndex(), 0, aOp));
+    }
+
+    Stmt ioPrint(Expr aSubexpr) { return node(ast->add(NodeKind::IoPrint, TType::UNDEFINED, aSubexpr.getIndex())); }
+
+    Stmt ret(Expr aSubexpr) { return node(ast->add(NodeKind::Return, aSubexpr->getType(), aSubexpr.getIndex())); }
+
+    Stmt expressionWrapper(Expr aExpr) {
+        return node(ast->add(NodeKind::ExpressionWrapper, aExpr->getType(), aExpr.getIndex()));
+    }
+
+    Stmt assignment(Var aVariable, Expr aRHS) {
+        return node(ast->add(NodeKind::Assignment, aVariable->getType(), aVariable.getIndex(), aRHS.getIndex()));
+    }
+
+    Stmt block(llvm::ArrayRef<Stmt> aStatements) {
+        return node(ast->add(NodeKind::BlockStatement, TType::UNDEFINED, ast->addList(indices(aStatements))));
+    }
+
+    Stmt ifStatement(Expr aCond, Stmt aTrueBranch, Stmt aFalseBranch = nullptr) {
+        std::uint32_t branches = ast->addSlots({aTrueBranch.getIndex(), aFalseBranch.getIndex()});
+        return node(ast->add(NodeKind::IfStatement, TType::UNDEFINED, aCond.getIndex(), branches));
+    }
+
+    Stmt whileStatement(Expr aCond, Stmt aBody) {
+        return node(ast->add(NodeKind::WhileStatement, TType::UNDEFINED, aCond.getIndex(), aBody.getIndex()));
+    }
+
+    Stmt doWhileStatement(Expr aCond, Stmt aBody) {
+        return node(ast->add(NodeKind::DoWhileStatement, TType::UNDEFINED, aCond.getIndex(), aBody.getIndex()));
+    }
+
+    Func functionDef(std::string_view aName, SymbolId aSymbol, llvm::ArrayRef<Var> aArgs, TType aType) {
+        ast->setName(aSymbol, aName);
+        // The body's slot, filled in by setBody(), right in front of the
+        // argument list.
+        std::uint32_t slots = ast->addSlots(NoNode);
+        ast->addList(indices(aArgs));
+        return node(ast->add(NodeKind::FunctionDef, aType, aSymbol, slots));
+    }
+
+    void setBody(Func aFunction, Stmt aBody) {
+        ast->setSlot(ast->getSecond(aFunction.getIndex()), aBody.getIndex());
+    }
+};
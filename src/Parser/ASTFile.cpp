@@ -0,0 +1,358 @@
+#include "ASTFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+    constexpr char Magic[8] = {'P', 'U', 'D', 'L', 'A', 'S', 'T', '\0'};
+
+    // Read back as 0x04030201 on a machine of the other byte order.
+    constexpr std::uint32_t ByteOrderMark = 0x01020304;
+
+    // The first 36 bytes of the file, as laid out in ASTFile.h.
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t nodes;
+        std::uint32_t listEntries;
+        std::uint32_t names;
+        std::uint32_t stringBytes;
+        std::uint32_t root;
+    };
+    static_assert(sizeof(Header) == 36, "the header is written and read as it is in memory");
+
+    // Where each array starts, worked out from the header's counts alone.
+    // 64-bit, so no count a damaged header can hold makes these wrap.
+    struct Layout {
+        std::uint64_t kinds, types, ops, first, second, lists, nameOffsets, strings, end;
+
+        explicit Layout(const Header &aHeader) {
+            kinds = sizeof(Header);
+            types = kinds + aHeader.nodes;
+            ops = types + aHeader.nodes;
+            first = (ops + aHeader.nodes + 3) / 4 * 4;
+            second = first + std::uint64_t(aHeader.nodes) * 4;
+            lists = second + std::uint64_t(aHeader.nodes) * 4;
+            nameOffsets = lists + std::uint64_t(aHeader.listEntries) * 4;
+            strings = nameOffsets + (std::uint64_t(aHeader.names) + 1) * 4;
+            end = strings + aHeader.stringBytes;
+        }
+    };
+
+    bool isExpression(NodeKind aKind) {
+        switch (aKind) {
+            case NodeKind::Var:
+            case NodeKind::Funcall:
+            case NodeKind::Boolean:
+            case NodeKind::Integer:
+            case NodeKind::Float:
+            case NodeKind::Binary:
+            case NodeKind::Unary:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool isStatement(NodeKind aKind) {
+        switch (aKind) {
+            case NodeKind::Assignment:
+            case NodeKind::BlockStatement:
+            case NodeKind::IfStatement:
+            case NodeKind::WhileStatement:
+            case NodeKind::DoWhileStatement:
+            case NodeKind::ExpressionWrapper:
+            case NodeKind::IoPrint:
+            case NodeKind::Return:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool isVariable(NodeKind aKind) { return aKind == NodeKind::Var; }
+
+    bool isFunction(NodeKind aKind) { return aKind == NodeKind::FunctionDef; }
+
+    template<typename T>
+    void readArray(std::vector<T> &aArray, const char *aData, std::uint64_t aCount) {
+        aArray.resize(aCount);
+        std::memcpy(aArray.data(), aData, aCount * sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(raw_ostream &aOut, const std::vector<T> &aArray) {
+        aOut.write(reinterpret_cast<const char *>(aArray.data()), aArray.size() * sizeof(T));
+    }
+
+    // The tree nodes already built for aList's items.
+    template<typename T>
+    std::vector<T *> treeNodes(FlatNodeList aList, const std::vector<Node *> &aNodes) {
+        std::vector<T *> result;
+        result.reserve(aList.size());
+        for (FlatNode item: aList) {
+            result.push_back(static_cast<T *>(aNodes[item.getIndex()]));
+        }
+        return result;
+    }
+}
+
+bool ASTFile::IsASTFile(StringRef aContents) {
+    return aContents.size() >= sizeof(Magic) && std::memcmp(aContents.data(), Magic, sizeof(Magic)) == 0;
+}
+
+void ASTFile::Write(const FlatAST &aAST, NodeIndex aRoot, raw_ostream &aOut) {
+    std::vector<std::uint32_t> nameOffsets;
+    nameOffsets.reserve(aAST.names.size() + 1);
+    std::uint32_t stringBytes = 0;
+    for (std::string_view name: aAST.names) {
+        nameOffsets.push_back(stringBytes);
+        stringBytes += static_cast<std::uint32_t>(name.size());
+    }
+    nameOffsets.push_back(stringBytes);
+
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.nodes = static_cast<std::uint32_t>(aAST.size());
+    header.listEntries = static_cast<std::uint32_t>(aAST.lists.size());
+    header.names = static_cast<std::uint32_t>(aAST.names.size());
+    header.stringBytes = stringBytes;
+    header.root = aRoot;
+    Layout layout(header);
+
+    aOut.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeArray(aOut, aAST.kinds);
+    writeArray(aOut, aAST.types);
+    writeArray(aOut, aAST.ops);
+    aOut.write_zeros(layout.first - (layout.ops + header.nodes));
+    writeArray(aOut, aAST.first);
+    writeArray(aOut, aAST.second);
+    writeArray(aOut, aAST.lists);
+    writeArray(aOut, nameOffsets);
+    for (std::string_view name: aAST.names) {
+        aOut.write(name.data(), name.size());
+    }
+}
+
+int ASTFile::load(std::unique_ptr<MemoryBuffer> aBuffer) {
+    buffer = std::move(aBuffer);
+    StringRef data = buffer->getBuffer();
+    auto fail = [&](const std::string &aWhy) {
+        std::cerr << "ERROR@AST: " << buffer->getBufferIdentifier().str() << ": " << aWhy << std::endl;
+        return 1;
+    };
+
+    Header header;
+    if (!IsASTFile(data) || data.size() < sizeof(header)) {
+        return fail("not a Pudl AST file");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != Version) {
+        return fail("AST format version " + std::to_string(header.version) + ", but this pudl reads version "
+                    + std::to_string(Version) + " -- write it again with --emit-ast");
+    }
+    if (header.byteOrder != ByteOrderMark) {
+        return fail("written on a machine of the other byte order");
+    }
+    Layout layout(header);
+    if (layout.end != data.size()) {
+        return fail("damaged (" + std::to_string(data.size()) + " bytes, the header says "
+                    + std::to_string(layout.end) + ")");
+    }
+
+    const char *base = data.data();
+    readArray(ast.kinds, base + layout.kinds, header.nodes);
+    readArray(ast.types, base + layout.types, header.nodes);
+    readArray(ast.ops, base + layout.ops, header.nodes);
+    readArray(ast.first, base + layout.first, header.nodes);
+    readArray(ast.second, base + layout.second, header.nodes);
+    readArray(ast.lists, base + layout.lists, header.listEntries);
+
+    std::vector<std::uint32_t> nameOffsets;
+    readArray(nameOffsets, base + layout.nameOffsets, std::uint64_t(header.names) + 1);
+    ast.names.resize(header.names);
+    for (std::uint32_t i = 0; i < header.names; i++) {
+        if (nameOffsets[i] > nameOffsets[i + 1] || nameOffsets[i + 1] > header.stringBytes) {
+            return fail("damaged (name " + std::to_string(i) + " is outside the string table)");
+        }
+        ast.names[i] = std::string_view(base + layout.strings + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+    }
+
+    for (NodeIndex i = 0; i < header.nodes; i++) {
+        if (!isValid(i)) {
+            return fail("damaged (node " + std::to_string(i) + " isn't one the parser could have built)");
+        }
+    }
+    if (header.root >= header.nodes || ast.getKind(header.root) != NodeKind::Vector) {
+        return fail("damaged (the root isn't a program)");
+    }
+    root = header.root;
+    return 0;
+}
+
+bool ASTFile::isValid(NodeIndex aNode) const {
+    NodeKind kind = ast.getKind(aNode);
+    OperatorKind op = ast.getOp(aNode);
+    if (kind > NodeKind::Return || ast.getType(aNode) > TType::FLOAT || op > OperatorKind::Not) {
+        return false;
+    }
+
+    // A child is always built before its parent -- but for a function's
+    // body, checked on its own below -- so a walk can never come back
+    // around to a node it's already in.
+    auto isChild = [&](NodeIndex aChild, bool (*aSort)(NodeKind)) {
+        return aChild < aNode && aSort(ast.getKind(aChild));
+    };
+    auto isSlot = [&](std::uint64_t aOffset) { return aOffset < ast.lists.size(); };
+    auto isList = [&](std::uint64_t aOffset, bool (*aSort)(NodeKind)) {
+        if (!isSlot(aOffset) || ast.lists[aOffset] > ast.lists.size() - aOffset - 1) {
+            return false;
+        }
+        for (NodeIndex item: ast.getList(static_cast<std::uint32_t>(aOffset))) {
+            if (!isChild(item, aSort)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto isSymbol = [&](std::uint32_t aSymbol) { return aSymbol < ast.names.size(); };
+
+    std::uint32_t first = ast.getFirst(aNode);
+    std::uint32_t second = ast.getSecond(aNode);
+    switch (kind) {
+        case NodeKind::Vector:
+            return isList(first, isFunction);
+        case NodeKind::Dummy:
+        case NodeKind::Boolean:
+        case NodeKind::Integer:
+        case NodeKind::Float:
+            return true;
+        case NodeKind::Var:
+            return isSymbol(first);
+        case NodeKind::Funcall:
+            return isSymbol(first) && isList(second, isExpression);
+        case NodeKind::Binary:
+            return op >= OperatorKind::Add && op <= OperatorKind::Or
+                   && isChild(first, isExpression) && isChild(second, isExpression);
+        case NodeKind::Unary:
+            return op >= OperatorKind::Pos && isChild(first, isExpression);
+        case NodeKind::Assignment:
+            return isChild(first, isVariable) && isChild(second, isExpression);
+        case NodeKind::FunctionDef: {
+            // The body comes after the function (see Parser::functionDef()),
+            // and is a statement: nothing a statement holds can lead back
+            // to a function.
+            if (!isSymbol(first) || !isSlot(second)) {
+                return false;
+            }
+            NodeIndex body = ast.getSlot(second);
+            return body > aNode && body < ast.size() && isStatement(ast.getKind(body))
+                   && isList(std::uint64_t(second) + 1, isVariable);
+        }
+        case NodeKind::BlockStatement:
+            return isList(first, isStatement);
+        case NodeKind::IfStatement: {
+            if (!isChild(first, isExpression) || !isSlot(std::uint64_t(second) + 1)) {
+                return false;
+            }
+            NodeIndex falseBranch = ast.getSlot(second + 1);
+            return isChild(ast.getSlot(second), isStatement)
+                   && (falseBranch == NoNode || isChild(falseBranch, isStatement));
+        }
+        case NodeKind::WhileStatement:
+        case NodeKind::DoWhileStatement:
+            return isChild(first, isExpression) && isChild(second, isStatement);
+        case NodeKind::ExpressionWrapper:
+        case NodeKind::IoPrint:
+        case NodeKind::Return:
+            return isChild(first, isExpression);
+    }
+    return false;
+}
+
+Node *ASTFile::buildTree(TreeBuilder &aBuilder) const {
+    std::vector<Node *> nodes(ast.size());
+    std::vector<NodeIndex> functions;
+    auto expr = [&](FlatNode aNode) { return static_cast<ExpressionNode *>(nodes[aNode.getIndex()]); };
+    auto stmt = [&](FlatNode aNode) { return static_cast<StatementNode *>(nodes[aNode.getIndex()]); };
+
+    for (NodeIndex i = 0; i < ast.size(); i++) {
+        FlatNode node(&ast, i);
+        switch (node.getKind()) {
+            case NodeKind::Vector:
+                nodes[i] = aBuilder.program(treeNodes<Node>(node.getNodes(), nodes));
+                break;
+            case NodeKind::Dummy:
+                nodes[i] = aBuilder.dummy();
+                break;
+            case NodeKind::Var:
+                nodes[i] = aBuilder.var(node.getName(), node.getSymbol(), node.getType());
+                break;
+            case NodeKind::Funcall:
+                nodes[i] = aBuilder.funcall(node.getName(), node.getSymbol(),
+                                            treeNodes<ExpressionNode>(node.getArgs(), nodes), node.getType());
+                break;
+            case NodeKind::Boolean:
+                nodes[i] = aBuilder.boolean(node.getBoolValue());
+                break;
+            case NodeKind::Integer:
+                nodes[i] = aBuilder.integer(node.getIntValue());
+                break;
+            case NodeKind::Float:
+                nodes[i] = aBuilder.floating(node.getFloatValue());
+                break;
+            case NodeKind::Binary:
+                nodes[i] = aBuilder.binary(node.getType(), node.getOp(), expr(node.getLHS()), expr(node.getRHS()));
+                break;
+            case NodeKind::Unary:
+                nodes[i] = aBuilder.unary(node.getOp(), expr(node.getSubexpr()));
+                break;
+            case NodeKind::Assignment:
+                nodes[i] = aBuilder.assignment(static_cast<VarNode *>(nodes[node.getLHS().getIndex()]),
+                                               expr(node.getRHS()));
+                break;
+            case NodeKind::FunctionDef:
+                // Its body isn't built yet; see below.
+                nodes[i] = aBuilder.functionDef(node.getName(), node.getSymbol(),
+                                                treeNodes<VarNode>(node.getArgs(), nodes), node.getType());
+                functions.push_back(i);
+                break;
+            case NodeKind::BlockStatement:
+                nodes[i] = aBuilder.block(treeNodes<StatementNode>(node.getStatements(), nodes));
+                break;
+            case NodeKind::IfStatement:
+                nodes[i] = aBuilder.ifStatement(expr(node.getCond()), stmt(node.getTrueBranch()),
+                                                node.getFalseBranch() != nullptr ? stmt(node.getFalseBranch())
+                                                                                 : nullptr);
+                break;
+            case NodeKind::WhileStatement:
+                nodes[i] = aBuilder.whileStatement(expr(node.getCond()), stmt(node.getBody()));
+                break;
+            case NodeKind::DoWhileStatement:
+                nodes[i] = aBuilder.doWhileStatement(expr(node.getCond()), stmt(node.getBody()));
+                break;
+            case NodeKind::ExpressionWrapper:
+                nodes[i] = aBuilder.expressionWrapper(expr(node.getExpr()));
+                break;
+            case NodeKind::IoPrint:
+                nodes[i] = aBuilder.ioPrint(expr(node.getSubexpr()));
+                break;
+            case NodeKind::Return:
+                nodes[i] = aBuilder.ret(expr(node.getSubexpr()));
+                break;
+        }
+    }
+
+    for (NodeIndex function: functions) {
+        aBuilder.setBody(static_cast<FunctionDefNode *>(nodes[function]),
+                         stmt(FlatNode(&ast, function).getBody()));
+    }
+    return nodes[root];
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "AST/FlatAST.h"
+#include "ASTBuilder.h"
+
+/**
+ * A parsed program saved to disk (main.cpp's --emit-ast), so a large
+ * source that rarely changes -- generated code, a fuzzer's or a
+ * benchmark's input -- can be compiled again without being lexed or
+ * parsed: `pudl out.pudlast` loads it and goes straight to codegen.
+ *
+ * The file is a FlatAST (FlatAST.h) written out array by array, with
+ * every name in one string table. Nothing in it is a pointer: children
+ * are node indices and names are offsets, so it means the same wherever
+ * it's loaded. Little else is needed around the arrays:
+ *
+ *   offset  size  what
+ *   0       8     Magic, "PUDLAST" and a NUL
+ *   8       4     Version (uint32) -- a file of any other version is
+ *                 refused, not guessed at
+ *   12      4     ByteOrderMark as written, so a file from a machine of
+ *                 the other byte order is refused too
+ *   16      4     N, the number of nodes
+ *   20      4     L, the number of entries in the lists/slots array
+ *   24      4     S, the number of names (one per SymbolId)
+ *   28      4     B, the string table's size in bytes
+ *   32      4     the root node's index
+ *   36      3N    kinds, types, ops (one byte each per node), then zero
+ *                 padding up to a multiple of 4
+ *   ...     4N    first (uint32 per node)
+ *   ...     4N    second
+ *   ...     4L    lists
+ *   ...     4S+4  where each name starts in the string table, then B
+ *   ...     B     the string table
+ *
+ * Every array starts 4-byte aligned, at an offset the header alone
+ * determines, so the file could be mapped and read in place. It's copied
+ * into a FlatAST's own arrays instead (one memcpy per array), since
+ * that's what Codegen and Printer walk -- the string table is the one
+ * part that isn't copied: names point into the loaded buffer, which
+ * ASTFile keeps alive.
+ *
+ * Loading also checks, in the same pass, that the file describes a
+ * program the parser could have built: kinds, types and operators in
+ * range, every child index inside the file and naming a node of the right
+ * sort (an expression, a statement, a variable), every child but a
+ * function's body earlier than its parent, every name in the table -- so
+ * a damaged or truncated file is refused instead of walked off the end
+ * of. Types aren't re-checked: a file that passes is taken to be one
+ * --emit-ast wrote.
+ */
+class ASTFile {
+private:
+    // The loaded file; `ast`'s names point into it.
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    FlatAST ast;
+    NodeIndex root = NoNode;
+
+    bool isValid(NodeIndex aNode) const;
+
+public:
+    static constexpr std::uint32_t Version = 1;
+
+    /// True if aContents starts like an AST file (of any version).
+    static bool IsASTFile(llvm::StringRef aContents);
+
+    /// Writes aAST, whose program is rooted at aRoot, in the format above.
+    static void Write(const FlatAST &aAST, NodeIndex aRoot, llvm::raw_ostream &aOut);
+
+    /**
+     * Loads an AST file. Errors are reported to stderr, prefixed
+     * ERROR@AST. The nodes handed out afterwards (getRoot()) point at
+     * this ASTFile, so it mustn't be moved once loaded.
+     * @return 0 if successful, != 0 if the file isn't one this pudl can load
+     */
+    int load(std::unique_ptr<llvm::MemoryBuffer> aBuffer);
+
+    const FlatAST &getAST() const { return ast; }
+
+    FlatNode getRoot() const { return FlatNode(&ast, root); }
+
+    /**
+     * The loaded program as a tree of Nodes in aBuilder's Arena, built in
+     * one pass over the nodes, in file order -- the order the parser
+     * built them in. Names are views of this ASTFile's buffer, so it
+     * has to outlive the tree.
+     */
+    Node *buildTree(TreeBuilder &aBuilder) const;
+};
@@ -1,88 +1,62 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <stack>
 #include <typeinfo>
-#include <map>
+#include <vector>
 
 #include <llvm/IR/LLVMContext.h>
-// Still needed for compile()'s object-file emission: LLVM's
+// Still needed for emitObject()'s object-file emission: LLVM's
 // TargetMachine::addPassesToEmitFile() has no New-PM equivalent as of
-// LLVM 18, so that one legacy::PassManager stays legacy. The six
-// optimization passes below (opt_promote_to_reg() etc.) use the New PM.
+// LLVM 18, so that one legacy::PassManager stays legacy. The optimization
+// pipeline (optimize()) uses the New PM.
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/CodeGen/ParallelCG.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/OptimizationLevel.h>
 #include <llvm/IR/PassManager.h>
 #include <llvm/Analysis/CGSCCPassManager.h>
-#include <llvm/Transforms/Utils/Mem2Reg.h>
-#include <llvm/Transforms/InstCombine/InstCombine.h>
-#include <llvm/Transforms/Scalar/Reassociate.h>
-#include <llvm/Transforms/Scalar/DCE.h>
-#include <llvm/Transforms/Scalar/GVN.h>
-#include <llvm/Transforms/Scalar/SimplifyCFG.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
-#include <llvm/TargetParser/Host.h>
-#include <llvm/MC/TargetRegistry.h>
-#include "llvm/Support/TargetSelect.h"
 #include <llvm/Target/TargetMachine.h>
-#include <llvm/Target/TargetOptions.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 
-#include "AST/ASTVisitor.h"
+#include "AST/StaticVisitor.h"
+#include "AST/FlatAST.h"
+#include "SymbolTable.h"
 
+#include "Compiler/JIT/JIT.h"
+#include "Compiler/JIT/JITObjectCache.h"
 #include "Compiler/Linker/Linker.h"
 #include "Compiler/Process.h"
+#include "Compiler/Target.h"
 
 using namespace llvm;
 
-/**
- * A stack of name->alloca scopes, innermost last. Replaces the single flat
- * map Codegen used to keep per function (cleared once at function entry):
- * that meant a variable declared inside an if/while body was visible
- * (and could collide with) anything else in the whole function, with no
- * shadowing and no cleanup when the block exits. Codegen pushes a new
- * scope in visit(BlockStatementNode) and pops it on the way out; function
- * parameters live in the outermost (function-level) scope pushed by
- * visit(FunctionDefNode), so they're visible from nested blocks exactly
- * like any enclosing-scope local would be.
- */
-class ScopeStack {
+class Codegen : public StaticVisitor<Codegen> {
 private:
-    std::vector<std::map<std::string, Value *>> scopes;
-public:
-    void clear() { scopes.clear(); }
-
-    void push() { scopes.emplace_back(); }
-
-    void pop() { scopes.pop_back(); }
-
-    // Binds aName in the *innermost* scope. Used both for a fresh local
-    // variable declaration and for binding a function parameter's alloca.
-    void declare(const std::string &aName, Value *aAlloca) {
-        scopes.back()[aName] = aAlloca;
-    }
-
-    // Searches innermost-to-outermost; nullptr if aName isn't bound
-    // anywhere in the current scope chain.
-    Value *lookup(const std::string &aName) {
-        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-            auto found = it->find(aName);
-            if (found != it->end()) {
-                return found->second;
-            }
-        }
-        return nullptr;
-    }
-};
+    // Drives a set of Codegens (one per thread) and merges their modules
+    // into this one's; see ParallelCodegen.h.
+    friend class ParallelCodegen;
 
-class Codegen : public ASTVisitor {
-private:
     bool isSuccess;
     bool generateIR;
     bool isDebugMode;
 
+    // Owned per Codegen rather than one process-wide static context: the
+    // JIT needs the module's context wrapped in a ThreadSafeContext to take
+    // a module at all, and it shares ownership of it from then on. Declared
+    // before `builder`/`module`, which are both created against it.
+    orc::ThreadSafeContext context;
+
     Module *module;
     IRBuilder<> builder;
 
@@ -93,28 +67,90 @@ private:
     std::stack<Value *> operands;
     Value *retValue;
 
-    ScopeStack scopeStack;
-
-    std::map<std::string, Function *> funcs;
-    std::map<std::string, FunctionDefNode *> astFuncs;
-    FunctionDefNode *currentFunc;
-
-    // New-PM machinery for the six opt_*() optimization passes below. The
-    // analysis managers must outlive and be cross-registered before any
-    // pass runs; FPM itself is built up incrementally as each opt_*()
-    // method is called (mirroring the old code's "add a pass, don't run
-    // yet" shape) and actually executed once per function, at the end of
-    // visit(FunctionDefNode).
+    // name -> alloca, one scope per block, innermost last. It replaced a
+    // single flat map per function (cleared once at function entry):
+    // that meant a variable declared inside an if/while body was visible
+    // (and could collide with) anything else in the whole function, with
+    // no shadowing and no cleanup when the block exits. Codegen pushes a
+    // new scope in visit(BlockStatementNode) and pops it on the way out;
+    // function parameters live in the outermost (function-level) scope,
+    // so they're visible from nested blocks exactly like any
+    // enclosing-scope local would be.
+    SymbolTable<Value *> scopes;
+
+    SymbolTable<Function *> funcs;
+    // The definition each of funcs' Functions was declared for -- a tree's
+    // only; see visit(FunctionDefNode).
+    SymbolTable<FunctionDefNode *> astFuncs;
+
+    // The function whose body is being generated, and its return type
+    // (what a `return`'s value is cast to).
+    Function *currentFunction;
+    TType currentReturnType;
+
+    // Created once from the TargetSpec the constructor is given, and used
+    // for everything target-dependent from then on: the module's triple
+    // and data layout, the optimization pipeline's TargetIRAnalysis, the
+    // JIT, and emitObject()'s object emission. nullptr only if creating it
+    // failed, in which case isFailed() is already true and targetError
+    // says why. Declared before `passBuilder`, which is constructed with
+    // it (and after targetError, which constructing it writes to).
+    // targetSpec is kept so ParallelCodegen can build more Codegens for
+    // the same target.
+    TargetSpec targetSpec;
+    std::string targetError;
+    std::unique_ptr<TargetMachine> targetMachine;
+
+    // New-PM machinery for optimize(). The analysis managers must outlive
+    // and be cross-registered before any pass runs. What actually runs is
+    // decided by optLevel/passPipeline, set from main.cpp's -O<N> and
+    // --passes= before optimize() is called.
     llvm::PassBuilder passBuilder;
     llvm::LoopAnalysisManager LAM;
     llvm::FunctionAnalysisManager FAM;
     llvm::CGSCCAnalysisManager CGAM;
     llvm::ModuleAnalysisManager MAM;
-    llvm::FunctionPassManager FPM;
 
-    LLVMContext &getGlobalContext() {
-        static LLVMContext GlobalContext;
-        return GlobalContext;
+    OptimizationLevel optLevel = OptimizationLevel::O2;
+    std::string passPipeline;
+    // optimize() was told to leave `module` for the JIT to optimize.
+    bool isOptimizationDeferred = false;
+
+    // How many threads emitObjects() may split machine-code generation
+    // across (main.cpp's -j N).
+    unsigned jobs = 1;
+
+    LLVMContext &getContext() {
+        return *context.getContext();
+    }
+
+    /// Calls a JIT-compiled mast() -- the running part of runSource() and
+    /// runObjects().
+    int execute(JIT::EntryPoint aMast, double &aRunMillis) {
+        std::cout << "Executing -----------------------" << std::endl << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        int result = aMast();
+        // The program's printf() output now lands in this process's own
+        // stdio buffer rather than a child's (which was flushed when the
+        // child exited) -- flush it before anything else, e.g. -p's IR
+        // dump to stderr, gets written after it.
+        std::fflush(stdout);
+        aRunMillis = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start
+        ).count();
+
+        return result;
+    }
+
+    // toLLVMType()'s inverse.
+    TType toTType(Type *aType) {
+        if (aType->isIntegerTy(1)) {
+            return TType::BOOL;
+        } else if (aType->isFloatTy()) {
+            return TType::FLOAT;
+        }
+        return TType::INTEGER;
     }
 
     Type *toLLVMType(TType aType) {
@@ -135,9 +171,13 @@ private:
         isSuccess = false;
     }
 
-    void infoln(std::string aMsg = "") {
+    // The message in parts, not one std::string: most calls are in the
+    // visitors below, once per node, and concatenating a message there
+    // would allocate for every node visited, debug mode or not.
+    template<typename... Parts>
+    void infoln(const Parts &... aParts) {
         if (isDebugMode) {
-            std::cout << aMsg << std::endl;
+            (std::cout << ... << aParts) << std::endl;
         }
     }
 
@@ -169,12 +209,28 @@ private:
     }
 
 public:
-    Codegen(bool debug = false) : builder(getGlobalContext()) {
+    Codegen(bool debug = false, const TargetSpec &aTarget = TargetSpec::Host())
+            : context(std::make_unique<LLVMContext>()), builder(*context.getContext()),
+              targetSpec(aTarget), targetMachine(aTarget.createTargetMachine(targetError)),
+              passBuilder(targetMachine.get()) {
         isSuccess = true;
         generateIR = true;
         isDebugMode = debug;
 
-        module = new Module("pudl compiler", getGlobalContext());
+        module = new Module("pudl compiler", getContext());
+
+        if (targetMachine) {
+            // Set up front, not just before emitting an object: the
+            // optimization pipeline's decisions (type sizes, alignment,
+            // which intrinsics are legal) depend on the data layout too.
+            module->setTargetTriple(targetMachine->getTargetTriple().str());
+            module->setDataLayout(targetMachine->createDataLayout());
+            infoln("Target: " + targetMachine->getTargetTriple().str() + ", CPU "
+                   + targetMachine->getTargetCPU().str());
+        } else {
+            std::cout << "ERROR@TARGET: " << targetError << std::endl;
+            isSuccess = false;
+        }
 
         formati = new GlobalVariable(
                 /*Module=*/ *module,
@@ -209,7 +265,8 @@ public:
         passBuilder.registerLoopAnalyses(LAM);
         passBuilder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
-        currentFunc = nullptr;
+        currentFunction = nullptr;
+        currentReturnType = TType::UNDEFINED;
     }
 
     Module *getModule() {
@@ -221,88 +278,174 @@ public:
     // in Codegen stops generating IR into `module` just because an earlier
     // node failed (the per-visit() guards below only stop that specific
     // node's own subtree), so the module can be left structurally broken
-    // even though root->accept(codegen) itself returns normally.
+    // even though codegen.generate(root) itself returns normally.
     bool isFailed() {
         return !isSuccess;
     }
 
-    // Promote allocas to registers.
-    void opt_promote_to_reg() {
-        FPM.addPass(PromotePass());
+    // -O0/-O1/-O2/-O3/-Os/-Oz. Ignored by optimize() if setPassPipeline()
+    // was given a pipeline, but still picks how hard instruction selection
+    // and register allocation try, for the JIT and emitObject() alike.
+    void setOptimizationLevel(OptimizationLevel aLevel) {
+        optLevel = aLevel;
+
+        if (targetMachine) {
+            if (aLevel == OptimizationLevel::O0) {
+                targetMachine->setOptLevel(CodeGenOptLevel::None);
+            } else if (aLevel == OptimizationLevel::O1) {
+                targetMachine->setOptLevel(CodeGenOptLevel::Less);
+            } else if (aLevel == OptimizationLevel::O3) {
+                targetMachine->setOptLevel(CodeGenOptLevel::Aggressive);
+            } else {
+                targetMachine->setOptLevel(CodeGenOptLevel::Default);
+            }
+        }
     }
 
-    // Do simple "peephole" optimizations and bit-twiddling optzns.
-    void opt_instcombine() {
-        FPM.addPass(InstCombinePass());
+    // -j N: lets compile()/linkSource() compile the module to machine code
+    // in up to N pieces at once (see emitObjects()).
+    void setJobs(unsigned aJobs) {
+        jobs = std::max(1u, aJobs);
     }
 
-    // Reassociate expressions.
-    void opt_reassociate() {
-        FPM.addPass(ReassociatePass());
+    // --passes=: a textual New-PM pipeline, exactly as `opt -passes=`
+    // takes it (e.g. "function(mem2reg,instcombine)" or "default<O3>").
+    // Replaces the -O<N> pipeline entirely rather than adding to it.
+    void setPassPipeline(const std::string &aPipeline) {
+        passPipeline = aPipeline;
     }
 
-    // Eliminate dead code & expressions.
-    void opt_dce() {
-        FPM.addPass(DCEPass());
-    }
+    /**
+     * Runs the optimization pipeline over the whole module, once, after
+     * codegen has finished -- LLVM's standard per-module default pipeline
+     * for optLevel (the same one clang builds for -O<N>: inlining, IPSCCP,
+     * tail-call elimination, loop passes, vectorization), or passPipeline
+     * if one was set.
+     *
+     * This used to be a FunctionPassManager of up to six hand-picked
+     * passes (mem2reg, instcombine, reassociate, DCE, GVN, SimplifyCFG)
+     * run on each function as soon as its body was generated. Per-function
+     * means nothing interprocedural could ever happen: no inlining, and a
+     * recursive function like ex15's `fact` could never be turned into a
+     * loop because its callers and callees weren't visible yet.
+     * @param aDeferToJIT Only check the pipeline, and leave running it to
+     *                    runSource()'s JIT, which skips it for a module it
+     *                    finds in its object cache
+     * @return 0 if successful, != 0 if passPipeline doesn't parse
+     */
+    int optimize(bool aDeferToJIT = false) {
+        ModulePassManager MPM;
+        if (buildPipeline(MPM) != 0) {
+            return 1;
+        }
+
+        if (aDeferToJIT) {
+            isOptimizationDeferred = true;
+            return 0;
+        }
+        MPM.run(*module, MAM);
 
-    // Eliminate Common SubExpressions.
-    void opt_gvn() {
-        FPM.addPass(GVNPass());
+        return 0;
     }
 
-    // Simplify the control flow graph (deleting unreachable blocks, etc).
-    void opt_simplifyCFG() {
-        FPM.addPass(SimplifyCFGPass());
+private:
+    // What optimize() runs: -O<N>'s pipeline, or --passes='s.
+    int buildPipeline(ModulePassManager &MPM) {
+        if (!passPipeline.empty()) {
+            if (auto err = passBuilder.parsePassPipeline(MPM, passPipeline)) {
+                std::cerr << "ERROR@OPTIMIZE: " << toString(std::move(err)) << std::endl;
+                isSuccess = false;
+                return 1;
+            }
+        } else if (optLevel == OptimizationLevel::O0) {
+            // buildPerModuleDefaultPipeline() asserts on O0 -- this is its
+            // O0 counterpart (only what must run even unoptimized, e.g.
+            // always_inline).
+            MPM = passBuilder.buildO0DefaultPipeline(optLevel);
+        } else {
+            MPM = passBuilder.buildPerModuleDefaultPipeline(optLevel);
+        }
+        return 0;
     }
 
-    void runSource() {
-        // Unique per call so two concurrent `pudl` invocations in the same
-        // directory don't clobber (or race-delete) each other's scratch IR.
-        std::string irOutput = Process::UniqueTempPath("out", ".ll");
+public:
 
-        std::error_code EC;
-        raw_fd_ostream dest(irOutput, EC, sys::fs::OF_None);
+    /**
+     * JIT-compiles the module in-process and runs mast() directly (see
+     * Compiler/JIT/JIT.h for why this isn't an lli subprocess any more).
+     * @param aJitMode Compile everything before running (Eager), or each
+     *                 function on its first call (Lazy, `--jit=lazy`)
+     * @param aCache   Machine code from earlier runs to reuse, if any
+     * @return mast()'s return value, or -1 if JIT compilation failed
+     */
+    int runSource(JIT::Mode aJitMode = JIT::Mode::Eager, JITObjectCache *aCache = nullptr) {
+        JIT jit(*targetMachine, aJitMode);
+        jit.setObjectCache(aCache);
+        if (isOptimizationDeferred) {
+            jit.setOptimizer([this](Module &aModule) {
+                ModulePassManager MPM;
+                if (buildPipeline(MPM) != 0) {
+                    return 1;
+                }
+                MPM.run(aModule, MAM);
+                return 0;
+            });
+        }
 
-        if (EC) {
-            errs() << "Could not open file: " << EC.message();
-            return;
+        // The JIT takes ownership of the module it's handed (and its
+        // codegen-prepare passes rewrite it in place), but main() still
+        // prints `module` for -p/--print-ir *after* running it -- so the
+        // JIT gets its own copy, sharing this Codegen's context.
+        JIT::EntryPoint mast = jit.compile(
+                orc::ThreadSafeModule(CloneModule(*module), context), "mast"
+        );
+        if (mast == nullptr) {
+            isSuccess = false;
+            return -1;
         }
 
-        module->print(dest, nullptr);
+        double runMillis;
+        int result = execute(mast, runMillis);
+
+        infoln("JIT: compiled in " + std::to_string(jit.getCompileMillis()) + " ms, ran in "
+               + std::to_string(runMillis) + " ms"
+               + (aJitMode == JIT::Mode::Lazy ? " (including on-demand compilation)" : ""));
+        infoln("JIT: compiled " + std::to_string(jit.getCompiledFunctions()) + " of "
+               + std::to_string(jit.getDefinedFunctions()) + " functions");
+        if (aCache != nullptr) {
+            infoln("JIT: " + std::to_string(aCache->getHits()) + " module(s) from the object cache, "
+                   + std::to_string(aCache->getMisses()) + " compiled");
+        }
+
+        return result;
+    }
 
-        const std::string lliInsertionPoint = R"(
-        define i32 @main() {
-            start:
-            %0 = call i32 @mast()
-            ret i32 %0
+    /**
+     * runSource(), for a program that's already been compiled to object
+     * files (a CompilationCache hit, or a miss on its way into the cache):
+     * the JIT only has to link them into this process.
+     */
+    int runObjects(ArrayRef<StringRef> aObjects) {
+        JIT jit(*targetMachine);
+        JIT::EntryPoint mast = jit.load(aObjects, "mast");
+        if (mast == nullptr) {
+            isSuccess = false;
+            return -1;
         }
-        )";
 
-        std::ofstream file;
-        file.open(irOutput, std::ios::app);
-        file << std::endl << lliInsertionPoint << std::endl;
-        file.close();
+        double runMillis;
+        int result = execute(mast, runMillis);
 
-        std::cout << "Executing -----------------------" << std::endl << std::endl;
+        infoln("JIT: loaded in " + std::to_string(jit.getCompileMillis()) + " ms, ran in "
+               + std::to_string(runMillis) + " ms");
 
-        // Run lli output file. LLVM distributes lli under a
-        // version-suffixed name (lli-18, ...) with no reliable unversioned
-        // alias, so hardcoding "lli" breaks the moment the installed LLVM's
-        // version differs -- detect what's actually available instead.
-        static const std::string lliCmd = Process::Detect({
-                "lli", "lli-18", "lli-19", "lli-20", "lli-17"
-        });
-        Process::Run({lliCmd, irOutput});
-
-        // remove irOutput file and check for errors
-        if (remove(irOutput.c_str()) != 0) {
-            std::cerr << "Error deleting temp IR file " << irOutput << std::endl;
-        }
+        return result;
     }
 
     void runObject(const char *cInPath, const char *linker) {
-        // Unique per call -- see runSource()'s comment above.
+        // Unique per call so two concurrent `pudl` invocations in the same
+        // directory don't clobber (or race-delete) each other's scratch
+        // executable.
         std::string oOutPath = Process::UniqueTempPath("pudl_run", "");
 
         linkObject(cInPath, oOutPath.c_str(), linker);
@@ -323,25 +466,37 @@ public:
      * @param linker Linker command
      */
     void linkSource(const char *oOutPath, const char *linker) {
-        // Unique per call -- see runSource()'s comment above.
-        std::string cOutPath = Process::UniqueTempPath("temp", ".o");
+        // The objects never touch the disk unless the linker needs them to:
+        // the in-process linker reads them straight from memory, and only
+        // an external driver gets scratch files (see Linker::Link()).
+        std::vector<SmallVector<char, 0>> objects;
 
-        // Compile source to object file
-        if (compile(cOutPath.c_str()) != 0) {
+        auto start = std::chrono::steady_clock::now();
+        if (emitObjects(objects, jobs) != 0) {
             std::cerr << "ERROR@COMPILE: Compilation failed" << std::endl;
             return;
         }
+        infoln("Link: compiled in " + std::to_string(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count()) + " ms");
+
+        linkObjects(ObjectRefs(objects), oOutPath, linker);
+    }
 
-        // Link source object file with linker
-        if (Linker::Link(cOutPath.c_str(), oOutPath, linker) != 0) {
+    /**
+     * Links object files in memory -- linkSource()'s, or a
+     * CompilationCache entry's -- to an executable
+     * @param oOutPath Path to output executable object file
+     * @param linker Linker command
+     */
+    void linkObjects(ArrayRef<StringRef> aObjects, const char *oOutPath, const char *linker) {
+        auto start = std::chrono::steady_clock::now();
+        if (Linker::Link(aObjects, oOutPath, linker) != 0) {
             std::cerr << "ERROR@LINK: Linking failed" << std::endl;
             isSuccess = false;
         }
 
-        // Delete temp compile file after linking
-        if (std::remove(cOutPath.c_str()) != 0) {
-            std::cerr << "ERROR@LINK: Deletion of temp compile file failed" << std::endl;
-        }
+        infoln("Link: linked in " + std::to_string(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count()) + " ms");
     }
 
     /**
@@ -351,62 +506,188 @@ public:
      * @param linker Linker command
      */
     void linkObject(const char *cInPath, const char *oOutPath, const char *linker) {
+        auto start = std::chrono::steady_clock::now();
+
         //  Link object file with compiled object cInPath
         if (Linker::Link(cInPath, oOutPath, linker) != 0) {
             std::cerr << "ERROR@LINK: Linking failed" << std::endl;
             isSuccess = false;
         }
+
+        infoln("Link: linked in " + std::to_string(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count()) + " ms");
+    }
+
+    /**
+     * Defines the C entry point an executable built from this module
+     * starts in: `main` calls mast(), prints its result the same way
+     * `print` would, and returns 0 -- what Linker used to get by compiling
+     * a small C++ <iostream> wrapper alongside the object on every single
+     * link, which cost far more than the link itself. With `main` in the
+     * object, linking is object-only.
+     *
+     * Weak, so a program that embeds Pudl code and brings its own `main`
+     * (see README's "Linking compiled object files to other languages")
+     * links cleanly and simply replaces this one.
+     *
+     * Must run before optimize() -- that can delete `.formati` from a
+     * program that never prints an integer itself.
+     */
+    void emitEntryPoint() {
+        if (module->getFunction("main") != nullptr) {
+            return;
+        }
+
+        // Declared, not required to be defined: a program without mast()
+        // still fails at link time, just as it always has.
+        FunctionCallee mast = module->getOrInsertFunction(
+                "mast", FunctionType::get(builder.getInt32Ty(), false)
+        );
+
+        Function *main = Function::Create(
+                FunctionType::get(builder.getInt32Ty(), false), Function::WeakAnyLinkage, "main", module
+        );
+        builder.SetInsertPoint(BasicBlock::Create(getContext(), "entry", main));
+
+        Value *result = builder.CreateCall(mast);
+        Value *format = builder.CreateInBoundsGEP(
+                formati->getValueType(), formati,
+                {builder.getInt32(0), builder.getInt32(0)}, formati->getName()
+        );
+        builder.CreateCall(print, {format, result});
+        builder.CreateRet(builder.getInt32(0));
+    }
+
+    /**
+     * Compiles the module to an object file in memory
+     * @param aObject Receives the object file's bytes
+     * @return 0 if successful, != 0 if failed
+     */
+    int emitObject(SmallVectorImpl<char> &aObject) {
+        raw_svector_ostream dest(aObject);
+
+        legacy::PassManager pass;
+        auto FileType = llvm::CodeGenFileType::ObjectFile;
+
+        if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, FileType)) {
+            errs() << "TheTargetMachine can't emit a file of this type";
+            return 1;
+        }
+
+        pass.run(*module);
+
+        return 0;
+    }
+
+    /// Views of objects emitObjects() compiled, for what takes them.
+    static std::vector<StringRef> ObjectRefs(const std::vector<SmallVector<char, 0>> &aObjects) {
+        std::vector<StringRef> refs;
+        for (const SmallVector<char, 0> &object: aObjects) {
+            refs.emplace_back(object.data(), object.size());
+        }
+        return refs;
+    }
+
+    /**
+     * emitObject(), split up: compiles the module to up to aPartitions
+     * object files in memory, at once. llvm::splitCodeGen() partitions
+     * the module's functions (llvm::SplitModule -- functions that have to
+     * stay together, e.g. through a shared local, stay together), clones
+     * each partition into a context of its own, and runs instruction
+     * selection, register allocation and object emission for each on its
+     * own thread. For a big module that back-end time is most of a build,
+     * and the single legacy::PassManager in emitObject() runs it on one
+     * core.
+     *
+     * Which functions land in which partition depends only on the module
+     * and aPartitions, so the objects are the same from run to run; linked
+     * together they make the same program as emitObject()'s one object.
+     * Locals referenced across partitions become hidden globals to make
+     * that possible.
+     *
+     * @param aObjects Receives the objects' bytes, one per partition
+     * @return 0 if successful, != 0 if failed
+     */
+    int emitObjects(std::vector<SmallVector<char, 0>> &aObjects, unsigned aPartitions) {
+        // No point in more partitions than there are functions to put in
+        // them.
+        unsigned definitions = 0;
+        for (Function &func: *module) {
+            definitions += func.isDeclaration() ? 0 : 1;
+        }
+        aPartitions = std::max(1u, std::min(aPartitions, definitions));
+
+        aObjects.assign(aPartitions, {});
+        if (aPartitions == 1) {
+            return emitObject(aObjects[0]);
+        }
+
+        // One TargetMachine per partition, created here rather than on
+        // splitCodeGen()'s threads (see ParallelCodegen.cpp), each as
+        // configured as targetMachine itself is.
+        std::vector<std::unique_ptr<TargetMachine>> machines;
+        for (unsigned i = 0; i < aPartitions; i++) {
+            std::string error;
+            machines.push_back(targetSpec.createTargetMachine(error));
+            if (!machines.back()) {
+                errs() << "Can't create a target machine for partition " << i << ": " << error << "\n";
+                return 1;
+            }
+            machines.back()->setOptLevel(targetMachine->getOptLevel());
+        }
+        std::atomic<unsigned> nextMachine{0};
+
+        std::vector<std::unique_ptr<raw_svector_ostream>> streams;
+        std::vector<raw_pwrite_stream *> partitionStreams;
+        for (SmallVector<char, 0> &object: aObjects) {
+            streams.push_back(std::make_unique<raw_svector_ostream>(object));
+            partitionStreams.push_back(streams.back().get());
+        }
+
+        splitCodeGen(*module, partitionStreams, {}, [&]() {
+            return std::move(machines[nextMachine++]);
+        }, llvm::CodeGenFileType::ObjectFile);
+
+        return 0;
     }
 
     /**
      * Compiles source code to object file
      * @param oOutPath Path to output object file
+     * @param linker What combines the objects emitObjects() compiles in
+     *               parallel into one (see Linker::LinkRelocatable());
+     *               empty for Linker::DetectDefault()
      * @return 0 if successful, != 0 if failed
      */
-    int compile(const char *cOutPath) {
-        // Pudl only ever emits object code for the host machine (there is
-        // no cross-compilation flag anywhere in the CLI/AST), so only the
-        // native target needs to be initialized. InitializeAllTargets() et
-        // al. require *every* target library LLVM's headers declare to be
-        // linkable, which is fragile across LLVM distributions that ship
-        // different subsets of (particularly experimental) targets -- e.g.
-        // the official LLVM Windows release omits M68k, which some distro
-        // packages include.
-        InitializeNativeTarget();
-        InitializeNativeTargetAsmParser();
-        InitializeNativeTargetAsmPrinter();
-
-        auto TargetTriple = sys::getDefaultTargetTriple();
-        module->setTargetTriple(TargetTriple);
-
-        std::string Error;
-        auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
-
-        // Print an error and exit if we couldn't find the requested target.
-        // This generally occurs if we've forgotten to initialise the
-        // TargetRegistry or we have a bogus target triple.
-        if (!Target) {
-            errs() << Error;
+    int compile(const char *cOutPath, const char *linker = "") {
+        // Without a way to combine them, one object it is.
+        unsigned partitions = jobs > 1 && Linker::CanLinkRelocatable(linker) ? jobs : 1;
+
+        std::vector<SmallVector<char, 0>> objects;
+        if (emitObjects(objects, partitions) != 0) {
             return 1;
         }
 
-        auto CPU = "generic";
-        auto Features = "";
-
-        TargetOptions opt;
-        // Leaving this as std::nullopt lets the TargetMachine pick its own
-        // default, which is not necessarily position-independent -- linking
-        // a non-PIC object with a modern PIE-by-default linker driver (e.g.
-        // current clang++/ld defaults on most Linux distros) fails with
-        // "relocation R_X86_64_32 against .rodata can not be used when
-        // making a PIE object". Pudl always emits a full standalone
-        // executable's worth of code (no shared-library use case), so PIC
-        // is simply the safe, always-linkable choice.
-        auto RM = std::optional<Reloc::Model>(Reloc::PIC_);
-        auto TheTargetMachine =
-                Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
+        return writeObjects(ObjectRefs(objects), cOutPath, linker);
+    }
 
-        module->setDataLayout(TheTargetMachine->createDataLayout());
+    /**
+     * Writes object files in memory -- compile()'s, or a CompilationCache
+     * entry's -- to one object file, combining them first if there are
+     * several (see compile())
+     * @return 0 if successful, != 0 if failed
+     */
+    int writeObjects(ArrayRef<StringRef> aObjects, const char *cOutPath, const char *linker = "") {
+        if (aObjects.size() > 1) {
+            std::string combiner = *linker != '\0' ? linker : Linker::DetectDefault();
+            if (Linker::LinkRelocatable(aObjects, cOutPath, combiner.c_str()) != 0) {
+                errs() << "Could not combine partial objects into " << cOutPath << "\n";
+                return 1;
+            }
+            outs() << "Wrote " << cOutPath << "\n";
+            return 0;
+        }
+        StringRef object = aObjects[0];
 
         std::error_code EC;
         raw_fd_ostream dest(cOutPath, EC, sys::fs::OF_None);
@@ -416,16 +697,7 @@ public:
             return 1;
         }
 
-        legacy::PassManager pass;
-        auto FileType = llvm::CodeGenFileType::ObjectFile;
-
-        if (TheTargetMachine->addPassesToEmitFile(pass, dest, nullptr, FileType)) {
-            errs() << "TheTargetMachine can't emit a file of this type";
-            return 1;
-        }
-
-        pass.run(*module);
-
+        dest.write(object.data(), object.size());
         dest.flush();
 
         outs() << "Wrote " << cOutPath << "\n";
@@ -456,42 +728,159 @@ public:
         module->print(errs(), nullptr);
     }
 
-    /// Generates IR for all nodes in vector
-    void visit(VectorNode &aNode) {
-        for (Node *node: aNode.getNodes()) {
-            node->accept((*this));
+    // Each kind of node's IR is generated by a gen*() template below,
+    // written once for both AST representations: N is a pointer to the
+    // node's class for a Node tree (from visit()), a FlatNode for a FlatAST
+    // (from generate(FlatNode)). Children are generated through
+    // generate(), which dispatches on whichever of the two it's given --
+    // with one switch over the node's kind either way.
+
+    /// Generates IR for a Node and its children: StaticVisitor's switch
+    /// picks the visit() below for aNode's class.
+    void generate(Node *aNode) { dispatch(aNode); }
+
+    /// Generates IR for a FlatAST node and its children -- for the
+    /// program's root, what generate(Node *) is for a tree.
+    void generate(FlatNode aNode) {
+        switch (aNode->getKind()) {
+            case NodeKind::Vector:
+                genVector(aNode);
+                break;
+            case NodeKind::Var:
+                genVar(aNode);
+                break;
+            case NodeKind::Funcall:
+                genFuncall(aNode);
+                break;
+            case NodeKind::Boolean:
+                genBoolean(aNode->getBoolValue());
+                break;
+            case NodeKind::Integer:
+                genInteger(aNode->getIntValue());
+                break;
+            case NodeKind::Float:
+                genFloat(aNode->getFloatValue());
+                break;
+            case NodeKind::Binary:
+                genBinary(aNode);
+                break;
+            case NodeKind::Unary:
+                genUnary(aNode);
+                break;
+            case NodeKind::Assignment:
+                genAssignment(aNode);
+                break;
+            case NodeKind::FunctionDef:
+                genFunctionDef(aNode, createFunction(aNode));
+                break;
+            case NodeKind::BlockStatement:
+                genBlockStatement(aNode);
+                break;
+            case NodeKind::IfStatement:
+                genIfStatement(aNode);
+                break;
+            case NodeKind::WhileStatement:
+                genWhileStatement(aNode);
+                break;
+            case NodeKind::DoWhileStatement:
+                genDoWhileStatement(aNode);
+                break;
+            case NodeKind::IoPrint:
+                genIoPrint(aNode);
+                break;
+            case NodeKind::Return:
+                genReturn(aNode);
+                break;
+            case NodeKind::Dummy:
+            case NodeKind::ExpressionWrapper:
+                // See visit(DummyNode)/visit(ExpressionWrapperNode).
+                break;
         }
     }
 
+    void visit(VectorNode &aNode) { genVector(&aNode); }
+
     //// Do nothing
     void visit(DummyNode &aNode) {}
 
+    void visit(VarNode &aNode) { genVar(&aNode); }
+
+    void visit(BooleanNode &aNode) { genBoolean(aNode.getValue()); }
+
+    void visit(IntegerNode &aNode) { genInteger(aNode.getValue()); }
+
+    void visit(FloatNode &aNode) { genFloat(aNode.getValue()); }
+
+    void visit(AssignmentNode &aNode) { genAssignment(&aNode); }
+
+    void visit(BinaryNode &aNode) { genBinary(&aNode); }
+
+    void visit(UnaryNode &aNode) { genUnary(&aNode); }
+
+    void visit(FuncallNode &aNode) { genFuncall(&aNode); }
+
+    void visit(FunctionDefNode &aNode) {
+        // A ParallelCodegen shard declares every function up front, so
+        // calls to functions generated on other threads resolve.
+        Function *func = astFuncs.lookup(aNode.getSymbol()) == &aNode
+                         ? funcs.lookup(aNode.getSymbol())
+                         : declareFunction(aNode);
+        genFunctionDef(&aNode, func);
+    }
+
+    void visit(BlockStatementNode &aNode) { genBlockStatement(&aNode); }
+
+    void visit(IfStatementNode &aNode) { genIfStatement(&aNode); }
+
+    void visit(WhileStatementNode &aNode) { genWhileStatement(&aNode); }
+
+    void visit(DoWhileStatementNode &aNode) { genDoWhileStatement(&aNode); }
+
+    // <expression>
+    void visit(ExpressionWrapperNode &aNode) {
+        // generate(aNode.getExpr());
+    }
+
+    void visit(IoPrintNode &aNode) { genIoPrint(&aNode); }
+
+    void visit(ReturnNode &aNode) { genReturn(&aNode); }
+
+private:
+    /// Generates IR for all nodes in vector
+    template<typename N>
+    void genVector(N aNode) {
+        for (auto node: aNode->getNodes()) {
+            generate(node);
+        }
+    }
+
     /**
     Generates IR for variable
     \return Returns via stack LOAD instruction if variable is presented in symbol table,
       else generates ERROR
     */
-    void visit(VarNode &aNode) {
-        Value *val = scopeStack.lookup(aNode.getName());
-        Type *type = toLLVMType(aNode.getType());
+    template<typename N>
+    void genVar(N aNode) {
+        Value *val = scopes.lookup(aNode->getSymbol());
+        Type *type = toLLVMType(aNode->getType());
 
         if (val == NULL) {
-            error("Can't find variable " + aNode.getName());
+            error("Can't find variable " + std::string(aNode->getName()));
             return;
         }
 
-        // Parameters are alloca'd in visit(FunctionDefNode) exactly like
+        // Parameters are alloca'd in genFunctionDef() exactly like
         // any other local now, so every binding this can find is a
         // pointer needing a load -- no more separate "is this a raw
         // Argument SSA value" case.
-        Value *loadInstr = builder.CreateLoad(type, val, aNode.getName());
+        Value *loadInstr = builder.CreateLoad(type, val, aNode->getName());
         operands.push(loadInstr);
     }
 
-    void visit(BooleanNode &aNode) {
+    void genBoolean(bool aValue) {
         Value *val = ConstantInt::get(
                 /*IntegerType=*/ builder.getInt1Ty(),
-                /*value=*/ aNode.getValue(),
+                /*value=*/ aValue,
                 /*isSigned*/ false
         );
         operands.push(val);
@@ -501,10 +890,10 @@ public:
     Generates IR for integer
     \return Returns via stack I32 constant
     */
-    void visit(IntegerNode &aNode) {
+    void genInteger(int aValue) {
         Value *val = ConstantInt::get(
                 /*IntegerType=*/ builder.getInt32Ty(),
-                /*value=*/ aNode.getValue(),
+                /*value=*/ aValue,
                 /*isSigned*/ false
         );
         operands.push(val);
@@ -514,12 +903,14 @@ public:
     Generates IR for float
     \return Returns via stack FP constant
     */
-    void visit(FloatNode &aNode) {
-        infoln(std::to_string(aNode.getValue()));
+    void genFloat(float aValue) {
+        if (isDebugMode) {
+            infoln(std::to_string(aValue));
+        }
 
         Value *val = ConstantFP::get(
                 /*Type=*/ builder.getFloatTy(),
-                /*value=*/ aNode.getValue()
+                /*value=*/ aValue
         );
         operands.push(val);
     }
@@ -531,31 +922,32 @@ public:
       STORE
       IR: Name = alloca LLVMType, LLVMType Value
     */
-    void visit(AssignmentNode &aNode) {
-        VarNode *variable = aNode.getLHS();
+    template<typename N>
+    void genAssignment(N aNode) {
+        auto variable = aNode->getLHS();
         // Searches the whole scope chain, not just the innermost level --
         // this is what makes assigning to a parameter (bound in the
         // function's outermost scope) actually reassign it instead of
         // silently creating a new shadowing local, which is what happened
         // when parameters lived in a completely separate map that this
         // lookup never consulted.
-        Value *alloca = scopeStack.lookup(variable->getName());
+        Value *alloca = scopes.lookup(variable->getSymbol());
 
-        infoln("Assignment: " + variable->getName());
+        infoln("Assignment: ", variable->getName());
 
-        aNode.getRHS()->accept((*this));
+        generate(aNode->getRHS());
         if (!isSuccess) { return; }
 
         if (alloca == NULL) {
             alloca = builder.CreateAlloca(
-                    toLLVMType(aNode.getType()),
+                    toLLVMType(aNode->getType()),
                     NULL,
                     variable->getName()
             );
 
             Value *rhs = operands.top();
-            if (variable->getType() != aNode.getRHS()->getType()) {
-                rhs = cast(rhs, aNode.getRHS()->getType(), variable->getType());
+            if (variable->getType() != aNode->getRHS()->getType()) {
+                rhs = cast(rhs, aNode->getRHS()->getType(), variable->getType());
             }
             builder.CreateStore(rhs, alloca);
             operands.pop();
@@ -564,46 +956,36 @@ public:
             // inside an if/while body no longer leaks into the enclosing
             // function scope or collides with a same-named variable
             // outside the block.
-            scopeStack.declare(variable->getName(), alloca);
+            scopes.declare(variable->getSymbol(), alloca);
 
-            infoln("gen?: Declared variable " + variable->getName());
+            infoln("gen?: Declared variable ", variable->getName());
         } else {
             Value *rhs = operands.top();
-            if (variable->getType() != aNode.getRHS()->getType()) {
-                rhs = cast(rhs, aNode.getRHS()->getType(), variable->getType());
+            if (variable->getType() != aNode->getRHS()->getType()) {
+                rhs = cast(rhs, aNode->getRHS()->getType(), variable->getType());
             }
 
             builder.CreateStore(rhs, alloca);
             operands.pop();
 
-            infoln("gen?: Assigned variable " + variable->getName());
+            infoln("gen?: Assigned variable ", variable->getName());
         }
     }
 
     /**
-    Generates IR for binary arithmetic operation:
-      LHS IR
-      RHS IR
+    Generates IR for binary arithmetic operation, given the IR already
+    generated for both operands:
       [Cast LHS to FP]
       [Cast RHS to FP]
       OpCode LHS RHS
     \return Result of operation
     */
-    Value *biarithmetic(BinaryNode aNode) {
-        TType lhsTy = aNode.getLHS()->getType();
-        TType rhsTy = aNode.getRHS()->getType();
-
-        aNode.getLHS()->accept((*this));
-        if (!isSuccess) { return NULL; }
-        aNode.getRHS()->accept((*this));
-        if (!isSuccess) { return NULL; }
+    template<typename N>
+    Value *biarithmetic(N aNode, Value *lhs, Value *rhs) {
+        TType lhsTy = aNode->getLHS()->getType();
+        TType rhsTy = aNode->getRHS()->getType();
 
-        Value *rhs = operands.top();
-        operands.pop();
-        Value *lhs = operands.top();
-        operands.pop();
-
-        OperatorKind op = aNode.getOp();
+        OperatorKind op = aNode->getOp();
         if (lhsTy == TType::FLOAT || rhsTy == TType::FLOAT) {
             lhs = cast(lhs, lhsTy, TType::FLOAT);
             rhs = cast(rhs, rhsTy, TType::FLOAT);
@@ -631,21 +1013,12 @@ public:
         return NULL;
     }
 
-    Value *birel(BinaryNode aNode) {
-        TType lhsTy = aNode.getLHS()->getType();
-        TType rhsTy = aNode.getRHS()->getType();
+    template<typename N>
+    Value *birel(N aNode, Value *lhs, Value *rhs) {
+        TType lhsTy = aNode->getLHS()->getType();
+        TType rhsTy = aNode->getRHS()->getType();
 
-        aNode.getLHS()->accept((*this));
-        if (!isSuccess) { return NULL; }
-        aNode.getRHS()->accept((*this));
-        if (!isSuccess) { return NULL; }
-
-        Value *rhs = operands.top();
-        operands.pop();
-        Value *lhs = operands.top();
-        operands.pop();
-
-        OperatorKind op = aNode.getOp();
+        OperatorKind op = aNode->getOp();
 
         if (lhsTy == TType::FLOAT || rhsTy == TType::FLOAT) {
             lhs = cast(lhs, lhsTy, TType::FLOAT);
@@ -687,37 +1060,52 @@ public:
     // evaluate rhs; true || rhs must never evaluate rhs). The eager
     // "evaluate both sides, then combine" shape every other binary
     // operator uses is wrong here -- this branches instead, the same way
-    // visit(IfStatementNode) does, threading the result through an alloca
+    // genIfStatement() does, threading the result through an alloca
     // rather than a manually-built PHI node (mem2reg turns this into an
-    // SSA phi automatically when opt_promote_to_reg() is enabled, same as
-    // every other variable in this file).
-    Value *bilogShortCircuit(BinaryNode aNode) {
-        Function *func = funcs[currentFunc->getName()];
-        OperatorKind op = aNode.getOp();
+    // SSA phi automatically at any -O level above -O0, same as every
+    // other variable in this file).
+    //
+    // `a && b && c && ...` leans left as deep as the chain is long, as the
+    // chains genBinary() walks do, so the left spine of the same operator
+    // is taken in one go too: one result slot and one merge block for the
+    // whole chain, each operand branching straight to the merge once it
+    // decides the result, instead of a nested call (and merge) per operator.
+    template<typename N>
+    Value *bilogShortCircuit(N aNode) {
+        Function *func = currentFunction;
+        OperatorKind op = aNode->getOp();
+
+        std::vector<N> spine{aNode};
+        for (N lhs = aNode->getLHS()->asBinary();
+             lhs != nullptr && lhs->getOp() == op; lhs = lhs->getLHS()->asBinary()) {
+            spine.push_back(lhs);
+        }
 
-        aNode.getLHS()->accept((*this));
+        generate(spine.back()->getLHS());
         if (!isSuccess) { return nullptr; }
-        Value *lhsVal = pop();
+        Value *value = pop();
 
         Value *resultSlot = builder.CreateAlloca(builder.getInt1Ty(), nullptr, "shortCircuitResult");
-        builder.CreateStore(lhsVal, resultSlot);
-
-        BasicBlock *rhsBb = BasicBlock::Create(getGlobalContext(), "ShortCircuitRhs", func);
-        BasicBlock *mergeBb = BasicBlock::Create(getGlobalContext(), "ShortCircuitMerge");
+        BasicBlock *mergeBb = BasicBlock::Create(getContext(), "ShortCircuitMerge");
+
+        for (auto node = spine.rbegin(); node != spine.rend(); ++node) {
+            builder.CreateStore(value, resultSlot);
+            BasicBlock *rhsBb = BasicBlock::Create(getContext(), "ShortCircuitRhs", func);
+
+            if (op == OperatorKind::And) {
+                // lhs && rhs: rhs only matters (and must only run) if lhs is true.
+                builder.CreateCondBr(value, rhsBb, mergeBb);
+            } else {
+                // lhs || rhs: rhs only matters (and must only run) if lhs is false.
+                builder.CreateCondBr(value, mergeBb, rhsBb);
+            }
 
-        if (op == OperatorKind::And) {
-            // lhs && rhs: rhs only matters (and must only run) if lhs is true.
-            builder.CreateCondBr(lhsVal, rhsBb, mergeBb);
-        } else {
-            // lhs || rhs: rhs only matters (and must only run) if lhs is false.
-            builder.CreateCondBr(lhsVal, mergeBb, rhsBb);
+            builder.SetInsertPoint(rhsBb);
+            generate((*node)->getRHS());
+            if (!isSuccess) { return nullptr; }
+            value = pop();
         }
-
-        builder.SetInsertPoint(rhsBb);
-        aNode.getRHS()->accept((*this));
-        if (!isSuccess) { return nullptr; }
-        Value *rhsVal = pop();
-        builder.CreateStore(rhsVal, resultSlot);
+        builder.CreateStore(value, resultSlot);
         builder.CreateBr(mergeBb);
 
         mergeBb->insertInto(func);
@@ -726,49 +1114,70 @@ public:
         return builder.CreateLoad(builder.getInt1Ty(), resultSlot, "shortCircuitValue");
     }
 
+    static bool isShortCircuit(OperatorKind aOp) {
+        return aOp == OperatorKind::And || aOp == OperatorKind::Or;
+    }
+
+    static bool isArithmetic(OperatorKind aOp) {
+        return aOp == OperatorKind::Add || aOp == OperatorKind::Sub
+               || aOp == OperatorKind::Mul || aOp == OperatorKind::Div;
+    }
+
     /**
     Generates IR for binary operation
     \return Returns via stack result of operation
     */
-    void visit(BinaryNode &aNode) {
-        OperatorKind op = aNode.getOp();
-
-        if (op == OperatorKind::Add || op == OperatorKind::Sub || op == OperatorKind::Mul || op == OperatorKind::Div) {
-            Value *res = biarithmetic(aNode);
-            if (res == NULL) {
-                // A NULL result can mean either a genuine unhandled-op bug
-                // here, or that biarithmetic() already stopped and reported
-                // a real error (undefined variable, etc.) further down --
-                // don't paper over the latter with a second, confusing
-                // "unknown error".
-                if (isSuccess) { error("unknown error"); }
-                return;
-            }
-            operands.push(res);
-        } else if (
-                op == OperatorKind::Eq || op == OperatorKind::Ne
-                || op == OperatorKind::Gt || op == OperatorKind::Lt
-                || op == OperatorKind::Ge || op == OperatorKind::Le
-                ) {
-            Value *res = birel(aNode);
+    template<typename N>
+    void genBinary(N aNode) {
+        if (isShortCircuit(aNode->getOp())) {
+            Value *res = bilogShortCircuit(aNode);
             if (res == NULL) {
                 if (isSuccess) { error("unknown error"); }
                 return;
             }
             operands.push(res);
-        } else if (op == OperatorKind::And || op == OperatorKind::Or) {
-            Value *res = bilogShortCircuit(aNode);
+            return;
+        }
+
+        // Binary operators are left-associative, so `a - b - c - ...` is a
+        // tree leaning left as deep as the chain is long. Visiting each LHS
+        // recursively would nest generate() calls that deep (generated code
+        // has chains of thousands of terms), so walk down the left spine
+        // of eagerly-evaluated operators first, then generate IR from the
+        // innermost node outwards -- in the same order as recursing would:
+        // LHS, RHS, operation.
+        std::vector<N> spine{aNode};
+        for (N lhs = aNode->getLHS()->asBinary();
+             lhs != nullptr && !isShortCircuit(lhs->getOp()); lhs = lhs->getLHS()->asBinary()) {
+            spine.push_back(lhs);
+        }
+
+        generate(spine.back()->getLHS());
+        if (!isSuccess) { return; }
+
+        for (auto node = spine.rbegin(); node != spine.rend(); ++node) {
+            generate((*node)->getRHS());
+            if (!isSuccess) { return; }
+            Value *rhs = pop();
+            Value *lhs = pop();
+
+            // Errors in the operands (undefined variable, etc.) have already
+            // returned above, so a NULL here is a genuine unhandled-op bug.
+            Value *res = isArithmetic((*node)->getOp())
+                         ? biarithmetic(*node, lhs, rhs)
+                         : birel(*node, lhs, rhs);
             if (res == NULL) {
-                if (isSuccess) { error("unknown error"); }
+                error("unknown error");
                 return;
             }
             operands.push(res);
         }
     }
 
-    Value *unarithmetic(UnaryNode aNode) {
-        TType ty = aNode.getType();
-        aNode.getSubexpr()->accept((*this));
+    template<typename N>
+    Value *unarithmetic(N aNode) {
+        TType ty = aNode->getType();
+        generate(aNode->getSubexpr());
         if (!isSuccess) { return nullptr; }
         Value *val = pop();
         if (ty == TType::FLOAT) {
@@ -779,16 +1188,18 @@ public:
         return nullptr;
     }
 
-    Value *unlog(UnaryNode aNode) {
-        aNode.getSubexpr()->accept((*this));
+    template<typename N>
+    Value *unlog(N aNode) {
+        generate(aNode->getSubexpr());
         if (!isSuccess) { return nullptr; }
         Value *val = pop();
         return builder.CreateNot(val);
     }
 
     // (<operator> <subexpr>)
-    void visit(UnaryNode &aNode) {
-        OperatorKind op = aNode.getOp();
+    template<typename N>
+    void genUnary(N aNode) {
+        OperatorKind op = aNode->getOp();
 
         if (op == OperatorKind::Neg) {
             Value *res = unarithmetic(aNode);
@@ -810,7 +1221,7 @@ public:
             // unarithmetic() nor unlog() ran for op==Pos, so the operand
             // was never visited at all, silently desyncing the operand
             // stack for whatever consumes this node's result.
-            aNode.getSubexpr()->accept((*this));
+            generate(aNode->getSubexpr());
         }
     }
 
@@ -818,36 +1229,38 @@ public:
     Generates IR for function call
     \return Returns via stack call instruction
     */
-    void visit(FuncallNode &aNode) {
-        Function *func = funcs[aNode.getName()];
-        FunctionDefNode *ast = astFuncs[aNode.getName()];
+    template<typename N>
+    void genFuncall(N aNode) {
+        Function *func = funcs.lookup(aNode->getSymbol());
 
         if (func == NULL) {
-            error("undefined function " + aNode.getName());
+            error("undefined function " + std::string(aNode->getName()));
             return;
         }
 
-        std::vector<ExpressionNode *> args = aNode.getArgs();
-        std::vector<VarNode *> astArgs = ast->getArgs();
+        // The parameters' types are the Function's own, not the
+        // definition's: a FlatAST has no FunctionDefNode to ask.
+        auto args = aNode->getArgs();
+        FunctionType *funcType = func->getFunctionType();
         std::vector<Value *> argsVal;
 
-        if (args.size() != astArgs.size()) {
+        if (args.size() != funcType->getNumParams()) {
             error(
-                    "expected " + std::to_string(astArgs.size()) + " arguments but given "
+                    "expected " + std::to_string(funcType->getNumParams()) + " arguments but given "
                     + std::to_string(args.size())
             );
             return;
         }
 
         int idx(0);
-        for (ExpressionNode *arg: args) {
-            arg->accept((*this));
+        for (auto arg: args) {
+            generate(arg);
             if (!isSuccess) { return; }
 
             Value *res = operands.top();
             operands.pop();
 
-            res = cast(res, arg->getType(), astArgs[idx]->getType());
+            res = cast(res, arg->getType(), toTType(funcType->getParamType(idx)));
             argsVal.push_back(res);
 
             idx++;
@@ -858,40 +1271,61 @@ public:
     }
 
     /**
-    Generates IR for function
-    */
-    void visit(FunctionDefNode &aNode) {
-        infoln("gen?: generating function definition " + aNode.getName());
-
-        scopeStack.clear();
-        scopeStack.push();
-
+     * Creates aNode's Function (no body yet) and binds its name to it.
+     */
+    template<typename N>
+    Function *createFunction(N aNode) {
         std::vector<Type *> argsTy;
-        std::vector<VarNode *> args = aNode.getArgs();
-        for (auto it = args.begin(); it != args.end(); ++it) {
-            argsTy.push_back(toLLVMType((*it)->getType()));
+        for (auto arg: aNode->getArgs()) {
+            argsTy.push_back(toLLVMType(arg->getType()));
         }
 
         FunctionType *funcType = FunctionType::get(
-                toLLVMType(aNode.getType()), argsTy, false
+                toLLVMType(aNode->getType()), argsTy, false
         );
         Function *func = Function::Create(
-                funcType, Function::ExternalLinkage, aNode.getName(), module
+                funcType, Function::ExternalLinkage, aNode->getName(), module
         );
 
-        infoln("DEF " + aNode.getName());
+        funcs.declare(aNode->getSymbol(), func);
+        return func;
+    }
 
-        funcs[aNode.getName()] = func;
+    /**
+     * createFunction(), for a tree, also remembering aNode as the
+     * definition the Function was created for (see visit(FunctionDefNode)).
+     */
+    Function *declareFunction(FunctionDefNode &aNode) {
+        Function *func = createFunction(&aNode);
 
         // aNode is now a reference into arena-owned storage (see Arena.h /
         // ASTVisitor.h) that outlives this call, so both maps can point
         // straight at it -- no need for the redundant heap copy this used
         // to make just to have something whose lifetime it could trust.
-        astFuncs[aNode.getName()] = &aNode;
-        currentFunc = &aNode;
+        astFuncs.declare(aNode.getSymbol(), &aNode);
+        return func;
+    }
+
+    /**
+    Generates IR for function, into func (created by createFunction())
+    */
+    template<typename N>
+    void genFunctionDef(N aNode, Function *func) {
+        infoln("gen?: generating function definition ", aNode->getName());
+
+        scopes.clear();
+
+        auto args = aNode->getArgs();
+
+        std::vector<Type *> argsTy(func->getFunctionType()->param_begin(), func->getFunctionType()->param_end());
+
+        infoln("DEF ", aNode->getName());
+
+        currentFunction = func;
+        currentReturnType = aNode->getType();
 
         BasicBlock *bb = BasicBlock::Create(
-                getGlobalContext(), "entry", func
+                getContext(), "entry", func
         );
         builder.SetInsertPoint(bb);
 
@@ -899,31 +1333,30 @@ public:
         // into it, then bind the *alloca* (not the raw Argument* SSA
         // value, as this used to) in the function's outermost scope.
         // Before this, a parameter's binding lived in a completely
-        // separate map that visit(AssignmentNode) never consulted, so
+        // separate map that genAssignment() never consulted, so
         // assigning to a parameter name silently created a new shadowing
         // local instead of erroring or actually reassigning it. This also
-        // lets visit(VarNode) treat parameters and locals identically
+        // lets genVar() treat parameters and locals identically
         // (both are just an alloca to load from) -- mem2reg still
         // promotes these back to registers exactly like it already does
         // for every other local.
         int idx(0);
         for (auto arg = func->arg_begin(); idx != argsTy.size(); ++arg, ++idx) {
-            std::string argName = args[idx]->getName();
+            std::string_view argName = args[idx]->getName();
             arg->setName(argName);
 
             Value *argAlloca = builder.CreateAlloca(argsTy[idx], nullptr, argName);
             builder.CreateStore(arg, argAlloca);
-            scopeStack.declare(argName, argAlloca);
+            scopes.declare(args[idx]->getSymbol(), argAlloca);
         }
 
-        aNode.getBody()->accept((*this));
+        generate(aNode->getBody());
 
         // A body that bailed out partway through an error (see the
         // isSuccess guards throughout this class) can leave `func` missing
-        // a terminator on some path -- running the optimizer on
-        // structurally invalid IR is exactly the kind of thing that
-        // crashes LLVM's pass infrastructure rather than just producing
-        // wrong output.
+        // a terminator on some path. Nothing downstream touches the module
+        // once isFailed() (main() checks it before optimize()), so there is
+        // nothing to patch up here.
         if (!isSuccess) { return; }
 
         // Also reachable on a *successful* parse: Pudl doesn't statically
@@ -941,11 +1374,10 @@ public:
         if (builder.GetInsertBlock()->getTerminator() == nullptr) {
             builder.CreateUnreachable();
         }
-
-        FPM.run(*func, FAM);
     }
 
-    void visit(BlockStatementNode &aNode) {
+    template<typename N>
+    void genBlockStatement(N aNode) {
         // A variable declared in this block is only visible for the
         // block's own lifetime -- pushed here, popped on every exit path
         // (including an error partway through) so it can never leak into
@@ -953,41 +1385,42 @@ public:
         // and a plain reassignment are both just an AssignmentNode (the
         // parser doesn't distinguish them in the AST either), a variable
         // declared inside this block and referenced *after* the block
-        // exits will now correctly fail to resolve in visit(VarNode) --
+        // exits will now correctly fail to resolve in genVar() --
         // Parser.cpp's own scope tracking is separately flat across the
         // whole function and doesn't enforce the same restriction, so
         // that specific mismatch is a known, currently-unexercised gap
         // (no example/test declares-then-uses-after-a-block) that would
         // need a matching parser-side fix to close completely.
-        scopeStack.push();
-        for (StatementNode *node: aNode.getStatements()) {
-            node->accept((*this));
+        scopes.push();
+        for (auto node: aNode->getStatements()) {
+            generate(node);
             if (!isSuccess) { break; }
             // A `return` mid-block already terminated the current
             // insert block -- generating any further statements from
             // this block into it would insert instructions after that
-            // terminator (invalid IR; see visit(IfStatementNode)'s
+            // terminator (invalid IR; see genIfStatement()'s
             // comment for what that silently does downstream).
             if (builder.GetInsertBlock()->getTerminator() != nullptr) { break; }
         }
-        scopeStack.pop();
+        scopes.pop();
     }
 
     // (If <expression> <statement> (Else <statement>)?
-    void visit(IfStatementNode &aNode) {
-        Function *func = funcs[currentFunc->getName()];
-        aNode.getCond()->accept((*this));
+    template<typename N>
+    void genIfStatement(N aNode) {
+        Function *func = currentFunction;
+        generate(aNode->getCond());
         if (!isSuccess) { return; }
         Value *cond = pop();
 
-        BasicBlock *thenBb = BasicBlock::Create(getGlobalContext(), "Then", func);
-        BasicBlock *elseBb = BasicBlock::Create(getGlobalContext(), "Else");
-        BasicBlock *mergeBb = BasicBlock::Create(getGlobalContext(), "Merge");
+        BasicBlock *thenBb = BasicBlock::Create(getContext(), "Then", func);
+        BasicBlock *elseBb = BasicBlock::Create(getContext(), "Else");
+        BasicBlock *mergeBb = BasicBlock::Create(getContext(), "Merge");
 
         builder.CreateCondBr(cond, thenBb, elseBb);
         builder.SetInsertPoint(thenBb);
 
-        aNode.getTrueBranch()->accept((*this));
+        generate(aNode->getTrueBranch());
         if (!isSuccess) { return; }
         // A branch ending in `return` already terminates its own block
         // (with a `ret`) -- unconditionally adding another branch here
@@ -1006,8 +1439,8 @@ public:
         elseBb->insertInto(func);
         builder.SetInsertPoint(elseBb);
 
-        if (aNode.getFalseBranch()) {
-            aNode.getFalseBranch()->accept((*this));
+        if (aNode->getFalseBranch()) {
+            generate(aNode->getFalseBranch());
             if (!isSuccess) { return; }
         }
 
@@ -1020,8 +1453,9 @@ public:
         builder.SetInsertPoint(mergeBb);
     }
 
-    void visit(WhileStatementNode &aNode) {
-        Function *func = funcs[currentFunc->getName()];
+    template<typename N>
+    void genWhileStatement(N aNode) {
+        Function *func = currentFunction;
 
         // thenBb must be attached to func immediately (3-arg Create), not
         // left detached until after the loop body has already been
@@ -1033,24 +1467,24 @@ public:
         // backtrace, not guessed: the crash was in
         // IRBuilderBase::CreateAlignedLoad -> BasicBlock::getModule()
         // while generating the loop body's first statement. The
-        // equivalent visit(IfStatementNode) path already gets this right
+        // equivalent genIfStatement() path already gets this right
         // for its own "Then" block.
-        BasicBlock *loopBb = BasicBlock::Create(getGlobalContext(), "Loop", func);
-        BasicBlock *thenBb = BasicBlock::Create(getGlobalContext(), "Then", func);
-        BasicBlock *afterBb = BasicBlock::Create(getGlobalContext(), "After");
+        BasicBlock *loopBb = BasicBlock::Create(getContext(), "Loop", func);
+        BasicBlock *thenBb = BasicBlock::Create(getContext(), "Then", func);
+        BasicBlock *afterBb = BasicBlock::Create(getContext(), "After");
 
         builder.CreateBr(loopBb);
 
         builder.SetInsertPoint(loopBb);
-        aNode.getCond()->accept((*this));
+        generate(aNode->getCond());
         if (!isSuccess) { return; }
         Value *cond = pop();
 
         builder.CreateCondBr(cond, thenBb, afterBb);
         builder.SetInsertPoint(thenBb);
-        aNode.getBody()->accept((*this));
+        generate(aNode->getBody());
         if (!isSuccess) { return; }
-        // See visit(IfStatementNode)'s comment: a body ending in `return`
+        // See genIfStatement()'s comment: a body ending in `return`
         // already terminates this block, so looping back would give it
         // two terminators (invalid IR, silently mishandled downstream).
         if (builder.GetInsertBlock()->getTerminator() == nullptr) {
@@ -1061,24 +1495,25 @@ public:
         builder.SetInsertPoint(afterBb);
     }
 
-    void visit(DoWhileStatementNode &aNode) {
+    template<typename N>
+    void genDoWhileStatement(N aNode) {
         infoln("gen?: generating do-while statement");
-        Function *func = funcs[currentFunc->getName()];
+        Function *func = currentFunction;
 
-        BasicBlock *loopBb = BasicBlock::Create(getGlobalContext(), "Loop", func);
-        BasicBlock *afterBb = BasicBlock::Create(getGlobalContext(), "After");
+        BasicBlock *loopBb = BasicBlock::Create(getContext(), "Loop", func);
+        BasicBlock *afterBb = BasicBlock::Create(getContext(), "After");
 
         builder.CreateBr(loopBb);
 
         builder.SetInsertPoint(loopBb);
-        aNode.getBody()->accept((*this));
+        generate(aNode->getBody());
         if (!isSuccess) { return; }
         // If the body already returned, this block is done -- evaluating
         // the condition and branching on it would insert more
         // instructions after that block's `ret` (same invalid-IR issue
-        // as visit(IfStatementNode)/the loop above).
+        // as genIfStatement()/the loop above).
         if (builder.GetInsertBlock()->getTerminator() == nullptr) {
-            aNode.getCond()->accept((*this));
+            generate(aNode->getCond());
             if (!isSuccess) { return; }
             Value *cond = pop();
             builder.CreateCondBr(cond, loopBb, afterBb);
@@ -1088,16 +1523,12 @@ public:
         builder.SetInsertPoint(afterBb);
     }
 
-    // <expression>
-    void visit(ExpressionWrapperNode &aNode) {
-        // aNode.getExpr()->accept((*this));
-    }
-
     /**
     Generates IR for print statement (intrinsic)
     */
-    void visit(IoPrintNode &aNode) {
-        aNode.getSubexpr()->accept((*this));
+    template<typename N>
+    void genIoPrint(N aNode) {
+        generate(aNode->getSubexpr());
         if (!isSuccess) { return; }
 
         std::vector<Value *> args;
@@ -1107,14 +1538,14 @@ public:
         ArrayRef < Value * > idxRef(idx);
 
 
-        if (aNode.getSubexpr()->getType() == TType::FLOAT) {
+        if (aNode->getSubexpr()->getType() == TType::FLOAT) {
             args.push_back(builder.CreateInBoundsGEP(formatf->getValueType(), formatf, idxRef, formatf->getName()));
             args.push_back(builder.CreateFPExt(operands.top(), builder.getDoubleTy()));
         } else {
             args.push_back(builder.CreateInBoundsGEP(formati->getValueType(), formati, idxRef, formati->getName()));
 
             Value *val = operands.top();
-            if (aNode.getSubexpr()->getType() == TType::BOOL) {
+            if (aNode->getSubexpr()->getType() == TType::BOOL) {
                 // A bare i1 passed to a variadic call (the %d format string
                 // expects i32) is not reliably widened by every target's
                 // calling convention -- it happened to print correctly on
@@ -1134,14 +1565,15 @@ public:
     /**
     Generates IR for return statement
     */
-    void visit(ReturnNode &aNode) {
-        aNode.getSubexpr()->accept((*this));
+    template<typename N>
+    void genReturn(N aNode) {
+        generate(aNode->getSubexpr());
         if (!isSuccess) { return; }
 
         Value *res = operands.top();
         operands.pop();
 
-        res = cast(res, aNode.getSubexpr()->getType(), currentFunc->getType());
+        res = cast(res, aNode->getSubexpr()->getType(), currentReturnType);
         builder.CreateRet(res);
     }
 };
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "ParallelCodegen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Codegen.h"
+
+// After Codegen.h, whose `using namespace llvm` would otherwise make its
+// own uses of Pudl's ::Linker ambiguous with llvm::Linker.
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+
+namespace {
+    /// Collects a program's function definitions, in source order.
+    class FunctionCollector : public StaticVisitor<FunctionCollector> {
+    public:
+        std::vector<FunctionDefNode *> functions;
+
+        void visit(VectorNode &aNode) {
+            for (Node *node: aNode.getNodes()) {
+                dispatch(node);
+            }
+        }
+
+        void visit(FunctionDefNode &aNode) { functions.push_back(&aNode); }
+
+        void visit(DummyNode &aNode) {}
+        void visit(VarNode &aNode) {}
+        void visit(FuncallNode &aNode) {}
+        void visit(BooleanNode &aNode) {}
+        void visit(IntegerNode &aNode) {}
+        void visit(FloatNode &aNode) {}
+        void visit(BinaryNode &aNode) {}
+        void visit(UnaryNode &aNode) {}
+        void visit(AssignmentNode &aNode) {}
+        void visit(BlockStatementNode &aNode) {}
+        void visit(IfStatementNode &aNode) {}
+        void visit(WhileStatementNode &aNode) {}
+        void visit(DoWhileStatementNode &aNode) {}
+        void visit(ExpressionWrapperNode &aNode) {}
+        void visit(IoPrintNode &aNode) {}
+        void visit(ReturnNode &aNode) {}
+    };
+}
+
+int ParallelCodegen::Generate(Codegen &aCodegen, Node &aRoot, unsigned aJobs) {
+    if (aCodegen.isFailed()) {
+        return 1;
+    }
+
+    FunctionCollector collector;
+    collector.dispatch(&aRoot);
+    const std::vector<FunctionDefNode *> &functions = collector.functions;
+
+    // Serially, a second definition of a name quietly becomes `name.1`
+    // and takes over later calls; which one a call binds to would depend
+    // on which shard got there first.
+    SymbolTable<FunctionDefNode *> defined;
+    for (FunctionDefNode *function: functions) {
+        if (defined.lookup(function->getSymbol()) != nullptr) {
+            aCodegen.error("function `" + std::string(function->getName())
+                           + "` is defined more than once (not supported with -j)");
+            return 1;
+        }
+        defined.declare(function->getSymbol(), function);
+    }
+
+    auto jobs = static_cast<unsigned>(std::min<std::size_t>(aJobs, functions.size()));
+    if (jobs == 0) {
+        return 0;
+    }
+
+    // Shards are set up here, on this thread: creating a TargetMachine
+    // goes through LLVM's target registry, which isn't meant to be used
+    // from several threads at once.
+    std::vector<std::unique_ptr<Codegen>> shards;
+    for (unsigned i = 0; i < jobs; i++) {
+        auto shard = std::make_unique<Codegen>(false, aCodegen.targetSpec);
+        if (shard->isFailed()) {
+            aCodegen.error("can't create a code generator for thread " + std::to_string(i) + ": " + shard->targetError);
+            return 1;
+        }
+        for (FunctionDefNode *function: functions) {
+            shard->declareFunction(*function);
+        }
+        // Every shard has its own private `.formati`/`.formatf`; linking
+        // would keep them all, renamed apart. linkonce_odr makes them one
+        // definition instead.
+        shard->formati->setLinkage(GlobalValue::LinkOnceODRLinkage);
+        shard->formatf->setLinkage(GlobalValue::LinkOnceODRLinkage);
+        shards.push_back(std::move(shard));
+    }
+
+    std::vector<SmallVector<char, 0>> bitcode(jobs);
+    std::atomic<std::size_t> next{0};
+
+    auto work = [&](unsigned aShard) {
+        Codegen &shard = *shards[aShard];
+        for (std::size_t i; (i = next++) < functions.size();) {
+            shard.generate(functions[i]);
+        }
+        if (shard.isFailed()) {
+            return;
+        }
+
+        // No optimization here: -O<N>'s module pipeline simplifies every
+        // function again inside its inliner anyway, and takes just as long
+        // on IR that was already simplified, so running the function
+        // simplification pipeline in the shards was pure extra work.
+        raw_svector_ostream out(bitcode[aShard]);
+        WriteBitcodeToFile(*shard.module, out);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < jobs; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    for (const auto &shard: shards) {
+        if (shard->isFailed()) {
+            aCodegen.isSuccess = false;
+            return 1;
+        }
+    }
+
+    // The module they're linked into needs the same linkage (see where
+    // the shards are set up).
+    aCodegen.formati->setLinkage(GlobalValue::LinkOnceODRLinkage);
+    aCodegen.formatf->setLinkage(GlobalValue::LinkOnceODRLinkage);
+
+    for (unsigned i = 0; i < jobs; i++) {
+        auto module = parseBitcodeFile(
+                MemoryBufferRef(StringRef(bitcode[i].data(), bitcode[i].size()), "shard"), aCodegen.getContext()
+        );
+        if (!module) {
+            aCodegen.error("can't read back thread " + std::to_string(i) + "'s module: " + toString(module.takeError()));
+            return 1;
+        }
+        if (llvm::Linker::linkModules(*aCodegen.module, std::move(*module))) {
+            aCodegen.error("can't link thread " + std::to_string(i) + "'s module");
+            return 1;
+        }
+    }
+
+    aCodegen.formati->setLinkage(GlobalValue::PrivateLinkage);
+    aCodegen.formatf->setLinkage(GlobalValue::PrivateLinkage);
+
+    for (FunctionDefNode *function: functions) {
+        Function *func = aCodegen.module->getFunction(function->getName());
+        func->removeFromParent();
+        aCodegen.module->getFunctionList().push_back(func);
+        aCodegen.funcs.declare(function->getSymbol(), func);
+        aCodegen.astFuncs.declare(function->getSymbol(), function);
+    }
+
+    return 0;
+}
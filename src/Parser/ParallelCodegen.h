@@ -0,0 +1,36 @@
+#pragma once
+
+#include "AST/AST.h"
+
+class Codegen;
+
+/**
+ * Generates IR for a program's functions on several threads at once (main.cpp's
+ * -j N).
+ *
+ * An LLVMContext, and everything created in it, can only be used by one
+ * thread at a time, so each thread gets a Codegen of its own -- its own
+ * context, module, builder and symbol tables -- called a shard. Every
+ * shard declares every function of the program up front, so a call to a
+ * function another shard generates resolves to a declaration; threads
+ * then take functions off a shared counter and generate them. Each
+ * shard's module goes back to the main thread as bitcode, is read into
+ * the main Codegen's context, and linked into its module, which then runs
+ * optimize() as usual. (The back end, the bulk of a build, is split up
+ * separately -- see Codegen::emitObjects().)
+ *
+ * Which thread gets which function varies from run to run; the result
+ * doesn't. Each function's IR depends only on its own source, and the
+ * merged module's functions are put back into source order, so the same
+ * program gives the same module for any N.
+ */
+class ParallelCodegen {
+public:
+    /**
+     * Use instead of aCodegen.generate(&aRoot): generates IR for every
+     * function in aRoot into aCodegen's module, on up to aJobs threads.
+     * Errors are reported and recorded on aCodegen (see isFailed()).
+     * @return 0 if successful, != 0 if failed
+     */
+    static int Generate(Codegen &aCodegen, Node &aRoot, unsigned aJobs);
+};
@@ -7,7 +7,8 @@ Converts string representation of type to TType
 \param aType String type
 \return AST Type
 */
-TType Parser::fromString(std::string aType) {
+template<typename Builder>
+TType BasicParser<Builder>::fromString(std::string_view aType) {
     if (aType == "int") {
         return TType::INTEGER;
     } else if (aType == "float") {
@@ -25,11 +26,13 @@ Equals token types
 \param aSuppress Suppress error if types are not equal
 \return aToken.type == aExpectedType
 */
-bool Parser::is(Token aToken, TokenType aExpectedType, bool aSuppress) {
+template<typename Builder>
+bool BasicParser<Builder>::is(const Token &aToken, TokenType aExpectedType, bool aSuppress) {
     if (aToken.getType() != aExpectedType) {
         if (!aSuppress) {
+            SourceLocation location = lexer->getLocation(aToken);
             std::cout << "error: expected " << Token::showType(aExpectedType)
-                      << " at (" << aToken.getLine() << ":" << aToken.getColumn() << ")"
+                      << " at (" << location.line << ":" << location.column << ")"
                       << " but given " << Token::showType(aToken.getType()) << std::endl;
         }
         return false;
@@ -40,25 +43,40 @@ bool Parser::is(Token aToken, TokenType aExpectedType, bool aSuppress) {
 /**
 \return AST root
 */
-Node *Parser::parse(FILE *aFile) {
-    lexer = std::make_unique<Lexer>(aFile);
+template<typename Builder>
+auto BasicParser<Builder>::parse(FILE *aFile) -> Result {
+    lexer = std::make_unique<Lexer>(aFile, interner);
+    return parseProgram();
+}
+
+/**
+\return AST root
+*/
+template<typename Builder>
+auto BasicParser<Builder>::parse(std::unique_ptr<llvm::MemoryBuffer> aSource) -> Result {
+    lexer = std::make_unique<Lexer>(std::move(aSource), interner);
+    return parseProgram();
+}
 
+// program := <function-definition>*
+template<typename Builder>
+auto BasicParser<Builder>::parseProgram() -> Result {
     next();
-    VectorNode *root = arena.construct<VectorNode>(std::vector<Node *>());
+    std::vector<Result> functions;
     while (1) {
         info("first! >> ");
         Token t = current;
-        lexinfo(t.getLexeme(), t.getType());
+        lexinfo(lexeme(t), t.getType());
 
         switch (t.getType()) {
             case ERROR_TOKEN:
-                return arena.construct<DummyNode>();
+                return builder.dummy();
             case EOF_TOKEN:
-                return root;
+                return builder.program(functions);
             case FUNC: {
-                FunctionDefNode *def = functionDef();
-                if (def == NULL) { return arena.construct<DummyNode>(); }
-                root->insert(def);
+                Func def = functionDef();
+                if (def == nullptr) { return builder.dummy(); }
+                functions.push_back(def);
                 break;
             }
             default:
@@ -70,45 +88,42 @@ Node *Parser::parse(FILE *aFile) {
                 // error() (found by fuzzing: see fuzz/fuzz_pipeline.cpp)
                 // rather than a crash, which is why it never showed up as
                 // a golden-test failure.
-                error(t.getLine(), "unexpected token `" + t.getLexeme() + "`");
+                error(t, "unexpected token `" + std::string(lexeme(t)) + "`");
                 next();
                 break;
         }
     }
 
-    return arena.construct<DummyNode>();
+    return builder.dummy();
 }
 
 // function-definition
 //  := func <name> [( <function-args> )]? : <type> <statement>
-FunctionDefNode *Parser::functionDef() {
+template<typename Builder>
+auto BasicParser<Builder>::functionDef() -> Func {
     infoln("debug?: parsing <function-definition>");
     scope.clear();
     Token t = next();
 
     if (!is(t, SYMBOL)) {
-        return NULL;
+        return nullptr;
     }
-    std::string name = t.getLexeme();
+    std::string name(lexeme(t));
+    SymbolId nameId = t.getSymbol();
 
     infoln("debug?: defining function '" + name + "'");
 
     t = next();
-    std::vector<VarNode *> args;
+    std::vector<Var> args;
     if (is(t, PL, true)) {
         next();
+        // Each argument is also declared in `scope` as it's parsed.
         args = functionArgs();
-        for (
-                std::vector<VarNode *>::iterator it = args.begin();
-                it != args.end(); ++it
-                ) {
-            scope.insert(std::pair<std::string, VarNode *>((*it)->getName(), (*it)));
-        }
     }
-    if (!is(current, COLON)) { return NULL; }
-    if (!is(t = next(), TYPE)) { return NULL; }
+    if (!is(current, COLON)) { return nullptr; }
+    if (!is(t = next(), TYPE)) { return nullptr; }
 
-    TType type = fromString(t.getLexeme());
+    TType type = fromString(lexeme(t));
     if (type == TType::UNDEFINED) {
         std::cout << "WARN: undefined type" << std::endl;
     }
@@ -123,28 +138,34 @@ FunctionDefNode *Parser::functionDef() {
     // recursion (A calls B, B calls A) still doesn't work -- that needs
     // a full pre-pass over every top-level function signature before
     // any body is parsed, which this single-pass parser doesn't do.
-    FunctionDefNode *func = arena.construct<FunctionDefNode>(name, args, nullptr, type);
-    funcs.insert(std::pair<std::string, FunctionDefNode *>(name, func));
+    Func func = builder.functionDef(interner.getName(nameId), nameId, args, type);
+    if (funcs.lookup(nameId) == nullptr) {
+        funcs.declare(nameId, func);
+    }
 
-    StatementNode *body = statement();
-    if (body == NULL) { return NULL; }
-    func->setBody(body);
+    Stmt body = statement();
+    if (body == nullptr) { return nullptr; }
+    builder.setBody(func, body);
 
     return func;
 }
 
 // function-args := [<type> <variable>,]* [<type> <variable>]?
-std::vector<VarNode *> Parser::functionArgs() {
+template<typename Builder>
+auto BasicParser<Builder>::functionArgs() -> std::vector<Var> {
     infoln("debug?: parsing <function-args>");
-    std::vector<VarNode *> args;
+    std::vector<Var> args;
     while (1) {
         if (is(current, PR, true)) { break; }
         if (!is(current, TYPE)) { return args; }
         Token ty = current;
         if (!is(next(), SYMBOL)) { return args; }
         Token var = current;
-        VarNode *arg = arena.construct<VarNode>(var.getLexeme(), fromString(ty.getLexeme()));
+        Var arg = builder.var(interner.getName(var.getSymbol()), var.getSymbol(), fromString(lexeme(ty)));
         args.push_back(arg);
+        if (scope.lookup(var.getSymbol()) == nullptr) {
+            scope.declare(var.getSymbol(), arg);
+        }
 
         next();
         if (is(current, COMMA, true)) {
@@ -161,13 +182,14 @@ std::vector<VarNode *> Parser::functionArgs() {
 
 // statement := <block> | <expression> | <compound-statement>
 // @implicit nullable
-StatementNode *Parser::statement() {
+template<typename Builder>
+auto BasicParser<Builder>::statement() -> Stmt {
     infoln("debug?: parsing <statement>");
-    lexinfo(current.getLexeme(), current.getType());
+    lexinfo(lexeme(current), current.getType());
     switch (current.getType()) {
         case EOF_TOKEN: {
-            error(current.getLine(), "unexpected End-Of-File");
-            return NULL;
+            error(current, "unexpected End-Of-File");
+            return nullptr;
         }
         case BL: {
             return blockStatement();
@@ -183,7 +205,7 @@ StatementNode *Parser::statement() {
         }
         case TYPE: {
             // <declaration>
-            StatementNode *stmt = declaration();
+            Stmt stmt = declaration();
             if (is(current, SEMICOLON, true)) { next(); }
             return stmt;
         }
@@ -194,430 +216,351 @@ StatementNode *Parser::statement() {
             if (is(lookup, PL, true)) {
                 unlex(lookup);
                 current = tmp;
-                ExpressionWrapperNode *node = _funcall();
+                Stmt node = _funcall();
                 if (is(current, SEMICOLON, true)) { next(); }
                 return node;
             }
             unlex(lookup);
             current = tmp;
-            AssignmentNode *node = assignment();
+            Stmt node = assignment();
             if (is(current, SEMICOLON, true)) { next(); }
             return node;
         }
         case IO_PRINT: {
-            IoPrintNode *iop = ioPrint();
+            Stmt iop = ioPrint();
             if (is(current, SEMICOLON, true)) { next(); }
             return iop;
         }
         case RETURN: {
-            ReturnNode *retOp = ret();
+            Stmt retOp = ret();
             if (is(current, SEMICOLON, true)) { next(); }
             return retOp;
         }
     }
-    return NULL;
+    return nullptr;
 }
 
 // ret ::= Return <expression>
-ReturnNode *Parser::ret() {
+template<typename Builder>
+auto BasicParser<Builder>::ret() -> Stmt {
     infoln("debug?: parsing <ret>");
     Token tmp = current;
-    ExpressionNode *expr = expression();
-    if (expr == NULL) {
-        error(tmp.getLine(), "expression expected after `return`");
-        return NULL;
+    Expr expr = expression();
+    if (expr == nullptr) {
+        error(tmp, "expression expected after `return`");
+        return nullptr;
     }
-    return arena.construct<ReturnNode>(expr);
+    return builder.ret(expr);
 }
 
 // io-print ::= Print <expression>
-IoPrintNode *Parser::ioPrint() {
+template<typename Builder>
+auto BasicParser<Builder>::ioPrint() -> Stmt {
     infoln("debug?: parsing <io-print>");
     Token tmp = current;
-    ExpressionNode *expr = expression();
-    if (expr == NULL) {
-        error(tmp.getLine(), "expression expected after `print`");
-        return NULL;
+    Expr expr = expression();
+    if (expr == nullptr) {
+        error(tmp, "expression expected after `print`");
+        return nullptr;
     }
-    return arena.construct<IoPrintNode>(expr);
+    return builder.ioPrint(expr);
 }
 
 // if-stmt := If \( <expression : bool> \) <statement>
 //   ( Else <statement> )?
-IfStatementNode *Parser::ifStatement() {
+template<typename Builder>
+auto BasicParser<Builder>::ifStatement() -> Stmt {
     infoln("debug?: parsing <if-stmt>");
     Token t = current;
     // if (!is(next(), PL)) { return NULL; }
-    ExpressionNode *cond = expression();
-    if (cond == NULL) { return NULL; }
+    Expr cond = expression();
+    if (cond == nullptr) { return nullptr; }
     if (cond->getType() != TType::BOOL) {
-        error(t.getLine(), "expected boolean expression");
-        return NULL;
+        error(t, "expected boolean expression");
+        return nullptr;
     }
 
     infoln("debug?: parsing <if-stmt.true>");
-    StatementNode *trueBranch = statement();
-    if (trueBranch == NULL) { return NULL; }
+    Stmt trueBranch = statement();
+    if (trueBranch == nullptr) { return nullptr; }
     if (is(current, ELSE, true)) {
         infoln("debug?: parsing <if-stmt.false>");
         next();
-        StatementNode *falseBranch = statement();
-        if (falseBranch == NULL) { return NULL; }
-        return arena.construct<IfStatementNode>(cond, trueBranch, falseBranch);
+        Stmt falseBranch = statement();
+        if (falseBranch == nullptr) { return nullptr; }
+        return builder.ifStatement(cond, trueBranch, falseBranch);
     }
-    return arena.construct<IfStatementNode>(cond, trueBranch);
+    return builder.ifStatement(cond, trueBranch);
 }
 
 // while-stmt := While <expression : bool> <statement>
-WhileStatementNode *Parser::whileStmt() {
+template<typename Builder>
+auto BasicParser<Builder>::whileStmt() -> Stmt {
     infoln("debug?: parsing <while-stmt>");
     Token t = current;
-    ExpressionNode *cond = expression();
+    Expr cond = expression();
     if (cond == nullptr) { return nullptr; }
     if (cond->getType() != TType::BOOL) {
-        error(t.getLine(), "expected boolean expression");
+        error(t, "expected boolean expression");
         return nullptr;
     }
     infoln("debug?: parsing <while-stmt.body>");
-    StatementNode *body = statement();
+    Stmt body = statement();
     if (body == nullptr) { return nullptr; }
-    return arena.construct<WhileStatementNode>(cond, body);
+    return builder.whileStatement(cond, body);
 }
 
-DoWhileStatementNode *Parser::doWhileStmt() {
+template<typename Builder>
+auto BasicParser<Builder>::doWhileStmt() -> Stmt {
     infoln("debug?: parsing <do-while-stmt>");
     Token t = current;
     next();
-    StatementNode *body = statement();
+    Stmt body = statement();
     if (body == nullptr) { return nullptr; }
 
     infoln("debug?: parsing <do-while-stmt.cond>");
     if (!is(current, WHILE)) { return nullptr; }
     Token condTok = current;
-    ExpressionNode *cond = expression();
+    Expr cond = expression();
     if (cond == nullptr) { return nullptr; }
     if (cond->getType() != TType::BOOL) {
-        error(condTok.getLine(), "expected boolean expression");
+        error(condTok, "expected boolean expression");
         return nullptr;
     }
-    return arena.construct<DoWhileStatementNode>(cond, body);
+    return builder.doWhileStatement(cond, body);
 }
 
 // block := { <statement>* }
-BlockStatementNode *Parser::blockStatement() {
+template<typename Builder>
+auto BasicParser<Builder>::blockStatement() -> Stmt {
     infoln("debug?: parsing <block>");
     next();
-    std::vector<StatementNode *> statements;
+    std::vector<Stmt> statements;
     while (!is(current, BR, true)) {
-        lexinfo(current.getLexeme());
+        lexinfo(lexeme(current));
         if (current.getType() == EOF_TOKEN) {
             is(current, BR);
-            return NULL;
+            return nullptr;
         }
 
-        StatementNode *node = statement();
-        if (node == NULL) { return NULL; }
+        Stmt node = statement();
+        if (node == nullptr) { return nullptr; }
         statements.push_back(node);
     }
     next(); // skip `}`
-    return arena.construct<BlockStatementNode>(
-            statements
-    );
+    return builder.block(statements);
 }
 
 // assignment := <variable> = <expression>
-AssignmentNode *Parser::assignment() {
+template<typename Builder>
+auto BasicParser<Builder>::assignment() -> Stmt {
     infoln("debug?: parsing <assignment>");
 
     Token t = current;
-    std::string name = t.getLexeme();
 
-    VarNode *lhs = scope[name];
-    if (lhs == NULL) {
-        error(t.getLine(), "assignment to undeclared variable " + name);
-        return NULL;
+    Var lhs = scope.lookup(t.getSymbol());
+    if (lhs == nullptr) {
+        error(t, "assignment to undeclared variable " + std::string(lexeme(t)));
+        return nullptr;
     }
 
-    if (!is(next(), ASSIGN)) { return NULL; }
+    if (!is(next(), ASSIGN)) { return nullptr; }
 
     Token op = current;
-    ExpressionNode *rhs = expression();
+    Expr rhs = expression();
 
-    if (rhs == NULL) {
-        error(op.getLine(), "expression expected after `=`");
-        return NULL;
+    if (rhs == nullptr) {
+        error(op, "expression expected after `=`");
+        return nullptr;
     }
     if (lhs->getType() == TType::BOOL && lhs->getType() != rhs->getType()) {
-        error(t.getLine(), "expected boolean but given number");
+        error(t, "expected boolean but given number");
         return nullptr;
     }
     if (lhs->getType() != TType::BOOL && rhs->getType() == TType::BOOL) {
-        error(t.getLine(), "expected number but given boolean");
+        error(t, "expected number but given boolean");
         return nullptr;
     }
 
     lexinfo(current);
     infoln("debug!: parsed <assignment>");
-    return arena.construct<AssignmentNode>(lhs, rhs);
+    return builder.assignment(lhs, rhs);
 }
 
 // declaration := Type <variable> = <expression>
-AssignmentNode *Parser::declaration() {
+template<typename Builder>
+auto BasicParser<Builder>::declaration() -> Stmt {
     infoln("debug?: parsing <declaration>");
 
     Token t = current;
 
-    TType type = fromString(current.getLexeme());
-    if (!is(next(), SYMBOL)) { return NULL; }
-
-    std::string name = current.getLexeme();
-    // scope.insert() below silently no-ops if `name` is already a key
-    // (std::map::insert() never overwrites an existing entry) -- without
-    // this check, redeclaring a name compiled without error, but which
-    // declaration later references actually resolved to was undefined
-    // behavior from the language's perspective (whichever one happened
-    // to already be in the map).
-    if (scope.find(name) != scope.end()) {
-        error(t.getLine(), "variable `" + name + "` is already declared");
+    TType type = fromString(lexeme(current));
+    if (!is(next(), SYMBOL)) { return nullptr; }
+
+    std::string name(lexeme(current));
+    SymbolId nameId = current.getSymbol();
+    // Without this check, redeclaring a name compiled without error, but
+    // which declaration later references actually resolved to was
+    // undefined behavior from the language's perspective (the scope map's
+    // insert() kept whichever one happened to already be in it).
+    if (scope.lookup(nameId) != nullptr) {
+        error(t, "variable `" + name + "` is already declared");
         return nullptr;
     }
-    VarNode *lhs = arena.construct<VarNode>(name, type);
-    if (!is(next(), ASSIGN)) { return NULL; }
+    Var lhs = builder.var(interner.getName(nameId), nameId, type);
+    if (!is(next(), ASSIGN)) { return nullptr; }
 
     Token op = current;
-    ExpressionNode *rhs = expression();
+    Expr rhs = expression();
 
-    if (rhs == NULL) {
-        error(op.getLine(), "expression expected after `=`");
-        return NULL;
+    if (rhs == nullptr) {
+        error(op, "expression expected after `=`");
+        return nullptr;
     }
     if (type == TType::BOOL && type != rhs->getType()) {
-        error(t.getLine(), "expected boolean but given number");
+        error(t, "expected boolean but given number");
         return nullptr;
     }
     if (type != TType::BOOL && rhs->getType() == TType::BOOL) {
-        error(t.getLine(), "expected number but given boolean");
+        error(t, "expected number but given boolean");
         return nullptr;
     }
 
-    scope.insert(std::pair<std::string, VarNode *>(name, lhs));
+    scope.declare(nameId, lhs);
 
     lexinfo(current);
     infoln("debug!: parsed <assignment>");
-    return arena.construct<AssignmentNode>(lhs, rhs);
+    return builder.assignment(lhs, rhs);
 }
 
-// expression := <lor>
-ExpressionNode *Parser::expression() {
+// expression := <binary>
+template<typename Builder>
+auto BasicParser<Builder>::expression() -> Expr {
     infoln("debug?: parsing <expression>");
     Token t = current;
     switch (next().getType()) {
         case EOF_TOKEN:
-            error(t.getLine(), "unexpected End-Of-File");
-            return NULL;
+            error(t, "unexpected End-Of-File");
+            return nullptr;
     }
-    ExpressionNode *node = lor();
+    Expr node = binary(1);
     return node;
 }
 
-// lor := <land> (LOr <lor : int>)?
-ExpressionNode *Parser::lor() {
-    ExpressionNode *lhs = land();
+template<typename Builder>
+int BasicParser<Builder>::precedence(TokenType aType) {
+    switch (aType) {
+        case LOR:
+            return 1;
+        case LAND:
+            return 2;
+        case CMP_EQ:
+            return 3;
+        case CMP:
+            return 4;
+        case ADD:
+            return 5;
+        case MUL:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+// binary := <unary> (BinaryOperator <unary>)*
+//
+// Precedence climbing, loosest to tightest: LOr, LAnd, Eq, Cmp, Add, Mul
+// (see precedence()); every level is left-associative.
+//
+// This used to be one right-recursive function per level (lor -> land ->
+// cmpeq -> cmp -> additive -> multiplicative), each calling itself for
+// the rest of the chain. That nested one C++ call per operator -- a long
+// generated expression could overflow the stack -- and built right-leaning
+// trees, so `10 - 3 - 2` parsed as `10 - (3 - 2)`. Here a chain of
+// same-precedence operators is consumed by the loop, and the only
+// recursion is into a tighter level for each right-hand side, so nesting
+// depth is bounded by the number of levels, not by the chain's length.
+template<typename Builder>
+auto BasicParser<Builder>::binary(int aMinPrecedence) -> Expr {
+    Expr lhs = unary();
     // A NULL lhs here means a deeper call already reported its own error
     // (e.g. unary()'s "expression expected after `+`") -- propagate it
     // rather than dereferencing it below. Found by fuzzing: an unchecked
     // lhs->getType() on a NULL lhs is a null-pointer dereference (see
-    // fuzz/fuzz_pipeline.cpp), and every sibling precedence level
-    // (land/cmpeq/cmp/additive/multiplicative) had the same gap.
-    if (lhs == NULL) { return NULL; }
-    // lexinfo(current.getLexeme(), current.getType());
-    if (is(current, LOR, true)) {
-        infoln("debug?: parsing <lor>");
-
-        Token t = current;
-        std::string op = t.getLexeme();
+    // fuzz/fuzz_pipeline.cpp).
+    if (lhs == nullptr) { return nullptr; }
 
-        next();
-        ExpressionNode *rhs = lor();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
+    while (true) {
+        int opPrecedence = precedence(current.getType());
+        if (opPrecedence == 0 || opPrecedence < aMinPrecedence) {
+            return lhs;
         }
-        if (lhs->getType() != TType::BOOL || rhs->getType() != TType::BOOL) {
-            error(t.getLine(), "expected boolean but given number");
-            return nullptr;
-        }
-
-        return arena.construct<BinaryNode>(
-                TType::BOOL, binaryOperatorFromLexeme(op), lhs, rhs
-        );
-    }
-    return lhs;
-}
-
-// land := <cmpeq> (LAnd <land : int>)?
-ExpressionNode *Parser::land() {
-    ExpressionNode *lhs = cmpeq();
-    if (lhs == NULL) { return NULL; }
-    if (is(current, LAND, true)) {
-        infoln("debug?: parsing <land>");
+        infoln("debug?: parsing <binary>");
 
         Token t = current;
-        std::string op = t.getLexeme();
-
         next();
-        ExpressionNode *rhs = land();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
-        }
-        if (lhs->getType() != TType::BOOL || rhs->getType() != TType::BOOL) {
-            error(t.getLine(), "expected boolean but given number");
+        Expr rhs = binary(opPrecedence + 1);
+        if (rhs == nullptr) {
+            error(t, "expression expected after `" + std::string(lexeme(t)) + "`");
             return nullptr;
         }
 
-        return arena.construct<BinaryNode>(
-                TType::BOOL, binaryOperatorFromLexeme(op), lhs, rhs
-        );
-    }
-    return lhs;
-}
-
-// cmpeq := <cmp> (Eq <cmpeq>)?
-ExpressionNode *Parser::cmpeq() {
-    ExpressionNode *lhs = cmp();
-    if (lhs == NULL) { return NULL; }
-    // lexinfo(current.getLexeme(), current.getType());
-    if (is(current, CMP_EQ, true)) {
-        infoln("debug?: parsing <cmpeq>");
-
-        Token t = current;
-        std::string op = t.getLexeme();
-
-        next();
-        ExpressionNode *rhs = cmpeq();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
-        }
-
-        return arena.construct<BinaryNode>(
-                TType::BOOL, binaryOperatorFromLexeme(op), lhs, rhs
-        );
+        lhs = binaryNode(t, lhs, rhs);
+        if (lhs == nullptr) { return nullptr; }
     }
-    return lhs;
 }
 
-// cmp := <add> (Cmp <cmp>)?
-ExpressionNode *Parser::cmp() {
-    ExpressionNode *lhs = additive();
-    if (lhs == NULL) { return NULL; }
-    // lexinfo(current.getLexeme(), current.getType());
-    if (is(current, CMP, true)) {
-        infoln("debug?: parsing <cmp>");
-
-        Token t = current;
-        std::string op = t.getLexeme();
-
-        next();
-        ExpressionNode *rhs = cmp();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
-        }
-        if (lhs->getType() == TType::BOOL || rhs->getType() == TType::BOOL) {
-            error(t.getLine(), "expected number but given boolean");
-            return nullptr;
-        }
-
-        return arena.construct<BinaryNode>(
-                TType::BOOL, binaryOperatorFromLexeme(op), lhs, rhs
-        );
-    }
-    return lhs;
-}
-
-// add := <mul> (Add <add>)?
-ExpressionNode *Parser::additive() {
-    ExpressionNode *lhs = multiplicative();
-    if (lhs == NULL) { return NULL; }
-    // lexinfo(current.getLexeme(), current.getType());
-    if (is(current, ADD, true)) {
-        infoln("debug?: parsing <add>");
-
-        Token t = current;
-        std::string op = t.getLexeme();
-
-        next();
-        ExpressionNode *rhs = additive();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
-        }
-        if (lhs->getType() == TType::BOOL || rhs->getType() == TType::BOOL) {
-            error(t.getLine(), "expected number but given boolean");
-            return nullptr;
-        }
-
-        TType type = TType::INTEGER;
-        if (lhs->getType() == TType::FLOAT || rhs->getType() == TType::FLOAT) {
-            type = TType::FLOAT;
-        }
-
-        return arena.construct<BinaryNode>(
-                type, binaryOperatorFromLexeme(op), lhs, rhs
-        );
-    }
-    return lhs;
-}
-
-// mul := <unary> (Mul <mul>)?
-ExpressionNode *Parser::multiplicative() {
-    ExpressionNode *lhs = unary();
-    if (lhs == NULL) { return NULL; }
-    // lexinfo(current.getLexeme(), current.getType());
-    if (is(current, MUL, true)) {
-        infoln("debug?: parsing <mul>");
-
-        Token t = current;
-        std::string op = t.getLexeme();
-
-        next();
-        ExpressionNode *rhs = multiplicative();
-        if (rhs == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
-        }
-        if (lhs->getType() == TType::BOOL || rhs->getType() == TType::BOOL) {
-            error(t.getLine(), "expected number but given boolean");
-            return NULL;
-        }
-
-        TType type = TType::INTEGER;
-        if (lhs->getType() == TType::FLOAT || rhs->getType() == TType::FLOAT) {
-            type = TType::FLOAT;
+// Type-checks one binary operation and builds its node.
+template<typename Builder>
+auto BasicParser<Builder>::binaryNode(const Token &aOp, Expr aLHS, Expr aRHS) -> Expr {
+    OperatorKind op = binaryOperatorFromLexeme(lexeme(aOp));
+    bool anyBool = aLHS->getType() == TType::BOOL || aRHS->getType() == TType::BOOL;
+
+    switch (aOp.getType()) {
+        case LOR:
+        case LAND:
+            if (aLHS->getType() != TType::BOOL || aRHS->getType() != TType::BOOL) {
+                error(aOp, "expected boolean but given number");
+                return nullptr;
+            }
+            return builder.binary(TType::BOOL, op, aLHS, aRHS);
+        case CMP_EQ:
+            return builder.binary(TType::BOOL, op, aLHS, aRHS);
+        case CMP:
+            if (anyBool) {
+                error(aOp, "expected number but given boolean");
+                return nullptr;
+            }
+            return builder.binary(TType::BOOL, op, aLHS, aRHS);
+        default: {
+            // ADD, MUL
+            if (anyBool) {
+                error(aOp, "expected number but given boolean");
+                return nullptr;
+            }
+            TType type = TType::INTEGER;
+            if (aLHS->getType() == TType::FLOAT || aRHS->getType() == TType::FLOAT) {
+                type = TType::FLOAT;
+            }
+            return builder.binary(type, op, aLHS, aRHS);
         }
-
-        return arena.construct<BinaryNode>(
-                type, binaryOperatorFromLexeme(op), lhs, rhs
-        );
     }
-    return lhs;
 }
 
 // unary := UnaryOperator? <factor>
-ExpressionNode *Parser::unary() {
+template<typename Builder>
+auto BasicParser<Builder>::unary() -> Expr {
     if (is(current, ADD, true) || is(current, NOT, true)) {
         infoln("debug?: parsing <unary>");
 
         Token t = current;
-        std::string op = t.getLexeme();
+        std::string_view op = lexeme(t);
 
         next();
-        ExpressionNode *exp = unary();
-        if (exp == NULL) {
-            error(t.getLine(), "expression expected after `" + op + "`");
-            return NULL;
+        Expr exp = unary();
+        if (exp == nullptr) {
+            error(t, "expression expected after `" + std::string(op) + "`");
+            return nullptr;
         }
 
         // t is the operator token itself, captured before next()/unary()
@@ -625,28 +568,29 @@ ExpressionNode *Parser::unary() {
         // this used to) tests whatever token follows the whole unary
         // expression instead, making these guards non-functional.
         if (t.getType() == NOT && exp->getType() != TType::BOOL) {
-            error(t.getLine(), "expected boolean but given number");
-            return NULL;
+            error(t, "expected boolean but given number");
+            return nullptr;
         }
         if (t.getType() == ADD && exp->getType() == TType::BOOL) {
-            error(t.getLine(), "expected number but given boolean");
-            return NULL;
+            error(t, "expected number but given boolean");
+            return nullptr;
         }
 
-        return arena.construct<UnaryNode>(unaryOperatorFromLexeme(op), exp);
+        return builder.unary(unaryOperatorFromLexeme(op), exp);
     }
-    ExpressionNode *node = factor();
+    Expr node = factor();
     return node;
 }
 
 // factor := <constant> | \( <expression> \)
-ExpressionNode *Parser::factor() {
+template<typename Builder>
+auto BasicParser<Builder>::factor() -> Expr {
     infoln("debug?: parsing <factor>");
     if (is(current, PL, true)) {
         infoln("lex!: PL");
         next();
-        ExpressionNode *expr = lor();
-        if (!is(current, PR)) { return NULL; }
+        Expr expr = binary(1);
+        if (!is(current, PR)) { return nullptr; }
         next();
         return expr;
     } else if (is(current, SYMBOL, true)) {
@@ -665,7 +609,8 @@ ExpressionNode *Parser::factor() {
 }
 
 // constant := <float> | <integer> | <var>
-ExpressionNode *Parser::constant() {
+template<typename Builder>
+auto BasicParser<Builder>::constant() -> Expr {
     infoln("debug?: parsing <constant>");
     switch (current.getType()) {
         case BOOL:
@@ -675,54 +620,58 @@ ExpressionNode *Parser::constant() {
         case FLOAT:
             return flt();
     }
-    return NULL;
+    return nullptr;
 }
 
 // var := Symbol | Symbol \( <funcall-args> \)
-VarNode *Parser::var() {
+template<typename Builder>
+auto BasicParser<Builder>::var() -> Var {
     infoln("debug?: parsing <var>");
 
     Token t = current;
-    std::string name = current.getLexeme();
     next();
 
-    VarNode *var = scope[name];
-    if (var != NULL) { return var; }
+    Var var = scope.lookup(t.getSymbol());
+    if (var != nullptr) { return var; }
 
-    error(t.getLine(), "variable " + name + " is not initilized");
-    return arena.construct<VarNode>(name, TType::UNDEFINED);
+    std::string name(lexeme(t));
+    error(t, "variable " + name + " is not initilized");
+    return builder.var(interner.getName(t.getSymbol()), t.getSymbol(), TType::UNDEFINED);
 }
 
-ExpressionWrapperNode *Parser::_funcall() {
-    FuncallNode *node = funcall();
-    if (node == NULL) { return NULL; }
-    return arena.construct<ExpressionWrapperNode>(node);
+template<typename Builder>
+auto BasicParser<Builder>::_funcall() -> Stmt {
+    Expr node = funcall();
+    if (node == nullptr) { return nullptr; }
+    return builder.expressionWrapper(node);
 }
 
 // funcall := Symbol \( <funcall-args> \)
-FuncallNode *Parser::funcall() {
+template<typename Builder>
+auto BasicParser<Builder>::funcall() -> Expr {
     infoln("debug?: parsing <funcall> ");
 
     Token begin = current;
-    std::string name = current.getLexeme();
+    std::string name(lexeme(current));
 
-    FunctionDefNode *func = funcs[name];
-    if (func == NULL) {
-        error(begin.getLine(), "function `" + name + "` is undefined");
-        return NULL;
+    Func func = funcs.lookup(begin.getSymbol());
+    if (func == nullptr) {
+        error(begin, "function `" + name + "` is undefined");
+        return nullptr;
     }
 
-    std::vector<ExpressionNode *> args = funcallArgs();
+    std::vector<Expr> args = funcallArgs();
     next();
-    return arena.construct<FuncallNode>(name, args, func->getType());
+    return builder.funcall(interner.getName(begin.getSymbol()), begin.getSymbol(), args, func->getType());
 }
 
 // funcall-args := <expression>*
-std::vector<ExpressionNode *> Parser::funcallArgs() {
+template<typename Builder>
+auto BasicParser<Builder>::funcallArgs() -> std::vector<Expr> {
     infoln("debug?: parsing <funcall-args>");
 
     Token tmp = current;
-    std::vector<ExpressionNode *> args;
+    std::vector<Expr> args;
     next();
 
     // Peek at the token right after '(' to detect a zero-argument call
@@ -751,9 +700,9 @@ std::vector<ExpressionNode *> Parser::funcallArgs() {
     while (1) {
         if (is(current, PR, true)) { break; }
 
-        ExpressionNode *arg = expression();
-        if (arg == NULL) {
-            error(tmp.getLine(), "expected expression");
+        Expr arg = expression();
+        if (arg == nullptr) {
+            error(tmp, "expected expression");
             return args; // TODO: skip top \)
         }
         lexinfo(current);
@@ -770,48 +719,53 @@ std::vector<ExpressionNode *> Parser::funcallArgs() {
 }
 
 // boolean := Bool
-BooleanNode *Parser::boolean() {
+template<typename Builder>
+auto BasicParser<Builder>::boolean() -> Expr {
     infoln("debug?: parsing <integer>");
-    std::string value = current.getLexeme();
+    std::string value(lexeme(current));
     next();
 
-    return value == "True"
-           ? arena.construct<BooleanNode>(true)
-           : arena.construct<BooleanNode>(false);
+    return builder.boolean(value == "True");
 }
 
 // integer := Integer
-IntegerNode *Parser::intgr() {
+template<typename Builder>
+auto BasicParser<Builder>::intgr() -> Expr {
     infoln("debug?: parsing <integer>");
     Token t = current;
-    std::string value = current.getLexeme();
+    std::string value(lexeme(current));
     next();
     // std::stoi throws std::out_of_range for a literal too large/small to
     // fit an int (found by fuzzing: an uncaught exception here unwound
     // straight out of main(), aborting the whole process instead of
     // reporting a parse error) -- every other error path in this class
     // reports via error() and returns nullptr, which the (now
-    // null-checked, see lor()/land()/etc.) precedence chain already knows
+    // null-checked, see binary()) precedence chain already knows
     // how to propagate cleanly.
     try {
-        return arena.construct<IntegerNode>(std::stoi(value));
+        return builder.integer(std::stoi(value));
     } catch (const std::exception &) {
-        error(t.getLine(), "integer literal `" + value + "` is out of range");
+        error(t, "integer literal `" + value + "` is out of range");
         return nullptr;
     }
 }
 
 // float := Float
-FloatNode *Parser::flt() {
+template<typename Builder>
+auto BasicParser<Builder>::flt() -> Expr {
     infoln("debug?: parsing <float>");
     Token t = current;
-    std::string value = current.getLexeme();
+    std::string value(lexeme(current));
     lexinfo(value);
     next();
     try {
-        return arena.construct<FloatNode>(std::stof(value));
+        return builder.floating(std::stof(value));
     } catch (const std::exception &) {
-        error(t.getLine(), "float literal `" + value + "` is out of range");
+        error(t, "float literal `" + value + "` is out of range");
         return nullptr;
     }
-}
\ No newline at end of file
+}
+
+template class BasicParser<TreeBuilder>;
+
+template class BasicParser<FlatBuilder>;
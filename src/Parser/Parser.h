@@ -2,20 +2,36 @@
 
 #include <string>
 #include <iostream>
-#include <map>
 #include <memory>
 
 #include "../Lexer/Lexer.h"
 #include "AST/ASTVisitor.h"
-#include "AST/Arena.h"
-
-class Parser {
+#include "ASTBuilder.h"
+#include "SymbolTable.h"
+
+/**
+ * The parser, for either AST representation: Parser builds a tree of
+ * Node objects, FlatParser a FlatAST (see ASTBuilder.h for what Builder
+ * is, and Parser.cpp, which instantiates both).
+ */
+template<typename Builder>
+class BasicParser {
 private:
-    // unique_ptr, not a raw owning pointer: Lexer's destructor closes the
-    // FILE* it was given, and this was previously leaked (`new Lexer`,
-    // never `delete`d) along with that open file handle. Tying it to the
-    // Parser's own lifetime fixes both without needing to hook every
-    // return point in parse().
+    using Expr = typename Builder::Expr;
+    using Stmt = typename Builder::Stmt;
+    using Var = typename Builder::Var;
+    using Func = typename Builder::Func;
+    using Result = typename Builder::Result;
+
+    // Every identifier's SymbolId (see Interner.h). Declared before lexer,
+    // which holds a reference to it.
+    Interner interner;
+
+    // unique_ptr, not a raw owning pointer: this was previously leaked
+    // (`new Lexer`, never `delete`d) along with the open file handle it
+    // was given. Tying it to the Parser's own lifetime fixes that without
+    // needing to hook every return point in parse(), and keeps the source
+    // buffer every Token's lexeme points into alive for the whole parse.
     std::unique_ptr<Lexer> lexer;
     Token current;
     bool isDebugMode;
@@ -23,14 +39,17 @@ private:
     bool isError;
 
     // Owns every AST node this Parser produces -- they live as long as
-    // this Parser does (see Arena.h). Declared before any parsing method
-    // runs and destroyed only when the Parser itself is (main() keeps the
-    // Parser alive through printing/codegen), so pointers into it -- like
-    // Codegen.h's currentFunc -- stay valid for the whole compilation.
-    Arena arena;
-
-    std::map<std::string, VarNode *> scope;
-    std::map<std::string, FunctionDefNode *> funcs;
+    // this Parser does (see Arena.h and FlatAST.h). Destroyed only when
+    // the Parser itself is (main() keeps the Parser alive through
+    // printing/codegen), so pointers into it -- like the FunctionDefNodes
+    // Codegen.h's astFuncs keeps -- stay valid for the whole compilation.
+    Builder builder;
+
+    // Keyed on the interned name (Token::getSymbol()), not the text --
+    // looking a name up never builds or hashes a string. `scope` is one
+    // flat scope per function (cleared at each function definition).
+    SymbolTable<Var> scope;
+    SymbolTable<Func> funcs;
 
     std::string show(const TType aType) {
         switch (aType) {
@@ -45,119 +64,125 @@ private:
 
     Token next() { return current = lexer->lex(); }
 
-    void unlex(Token aToken) { lexer->unlex(aToken); }
+    void unlex(const Token &aToken) { lexer->unlex(aToken); }
+
+    std::string_view lexeme(const Token &aToken) const { return lexer->getLexeme(aToken); }
 
-    bool is(Token aToken, TokenType aExpectedType, bool aSuppress = false);
+    bool is(const Token &aToken, TokenType aExpectedType, bool aSuppress = false);
 
-    TType fromString(std::string aType);
+    TType fromString(std::string_view aType);
 
-    void info(std::string aMsg) {
+    // string_view, not std::string: these run on nearly every token, debug
+    // mode or not, and most messages are literals longer than std::string's
+    // small-string buffer -- taking std::string heap-allocated every one.
+    void info(std::string_view aMsg) {
         if (isDebugMode) {
             std::cout << aMsg;
         }
     }
 
-    void infoln(std::string aMsg = "") {
+    void infoln(std::string_view aMsg = "") {
         if (isDebugMode) {
             std::cout << aMsg << std::endl;
         }
     }
 
-    void lexinfo(std::string aLexeme) {
+    void lexinfo(std::string_view aLexeme) {
         if (isDebugMode) {
             std::cout << "lex!: " << aLexeme << std::endl;
         }
     }
 
-    void lexinfo(std::string aLexeme, TokenType aType) {
+    void lexinfo(std::string_view aLexeme, TokenType aType) {
         if (isDebugMode) {
             std::cout << "lex!: " << aLexeme << " of "
                       << Token::showType(aType) << std::endl;
         }
     }
 
-    void lexinfo(Token aToken) {
+    void lexinfo(const Token &aToken) {
         if (isDebugMode) {
-            std::cout << "lex!: " << aToken.getLexeme() << " of "
+            SourceLocation location = lexer->getLocation(aToken);
+            std::cout << "lex!: " << lexeme(aToken) << " of "
                       << Token::showType(aToken.getType()) << " at ("
-                      << aToken.getLine() << ":" << aToken.getColumn() << ")"
+                      << location.line << ":" << location.column << ")"
                       << std::endl;
         }
     }
 
-    void error(int aLine, std::string aMessage) {
+    // Errors take the offending token rather than a line number: its line
+    // is only worked out here, when it's actually printed.
+    void error(const Token &aToken, std::string aMessage) {
         std::cout << "ERROR: " << aMessage
-                  << " at " << aLine << " line"
+                  << " at " << lexer->getLocation(aToken).line << " line"
                   << std::endl;
         isSuccess = false;
         isError = true;
     }
 
-    void errorty(int aLine, TType aSrc, TType aDst) {
+    void errorty(const Token &aToken, TType aSrc, TType aDst) {
         std::cout << "ERROR: can't cast from " << show(aSrc)
                   << " to " << show(aDst)
-                  << " at " << aLine << " line" << std::endl;
+                  << " at " << lexer->getLocation(aToken).line << " line" << std::endl;
         isError = true;
     }
 
-    FunctionDefNode *functionDef();
-
-    std::vector<VarNode *> functionArgs();
-
-    ExpressionWrapperNode *_funcall();
+    Result parseProgram();
 
-    FuncallNode *funcall();
+    Func functionDef();
 
-    std::vector<ExpressionNode *> funcallArgs();
+    std::vector<Var> functionArgs();
 
-    StatementNode *statement();
+    Stmt _funcall();
 
-    BlockStatementNode *blockStatement();
+    Expr funcall();
 
-    IfStatementNode *ifStatement();
+    std::vector<Expr> funcallArgs();
 
-    WhileStatementNode *whileStmt();
+    Stmt statement();
 
-    DoWhileStatementNode *doWhileStmt();
+    Stmt blockStatement();
 
-    AssignmentNode *declaration();
+    Stmt ifStatement();
 
-    AssignmentNode *assignment();
+    Stmt whileStmt();
 
-    IoPrintNode *ioPrint();
+    Stmt doWhileStmt();
 
-    ReturnNode *ret();
+    Stmt declaration();
 
-    ExpressionNode *expression();
+    Stmt assignment();
 
-    ExpressionNode *lor();
+    Stmt ioPrint();
 
-    ExpressionNode *land();
+    Stmt ret();
 
-    ExpressionNode *cmpeq();
+    Expr expression();
 
-    ExpressionNode *cmp();
+    // How tightly a binary operator token binds: LOr loosest, Mul
+    // tightest. 0 for anything that isn't a binary operator.
+    static int precedence(TokenType aType);
 
-    ExpressionNode *additive();
+    Expr binary(int aMinPrecedence);
 
-    ExpressionNode *multiplicative();
+    Expr binaryNode(const Token &aOp, Expr aLHS, Expr aRHS);
 
-    ExpressionNode *unary();
+    Expr unary();
 
-    ExpressionNode *factor();
+    Expr factor();
 
-    ExpressionNode *constant();
+    Expr constant();
 
-    BooleanNode *boolean();
+    Expr boolean();
 
-    IntegerNode *intgr();
+    Expr intgr();
 
-    FloatNode *flt();
+    Expr flt();
 
-    VarNode *var();
+    Var var();
 
 public:
-    Parser(bool debug = false) : current(EOF_TOKEN, 0, 0) {
+    BasicParser(bool debug = false) : current(EOF_TOKEN, 0, 0) {
         isDebugMode = debug;
         isSuccess = true;
         isError = false;
@@ -165,5 +190,15 @@ public:
 
     bool isFailed() { return isError; }
 
-    Node *parse(FILE *aFile);
-};
\ No newline at end of file
+    const Builder &getBuilder() const { return builder; }
+
+    Result parse(std::unique_ptr<llvm::MemoryBuffer> aSource);
+
+    /// parse(), for a FILE* (read fully into memory, then closed -- see
+    /// Lexer(FILE *)).
+    Result parse(FILE *aFile);
+};
+
+using Parser = BasicParser<TreeBuilder>;
+
+using FlatParser = BasicParser<FlatBuilder>;
\ No newline at end of file
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
-#include "AST/ASTVisitor.h"
+#include "AST/StaticVisitor.h"
+#include "AST/FlatAST.h"
 
-class Printer : public ASTVisitor {
+class Printer : public StaticVisitor<Printer> {
 private:
     std::string show(TType aType) {
         switch (aType) {
@@ -21,34 +23,33 @@ private:
         }
     }
 
-public:
-    Printer() {}
+    // As in Codegen.h, each kind of node is printed by one template, for
+    // a Node tree (N a pointer to the node's class) and a FlatAST (N a
+    // FlatNode) alike.
 
     // [node]*
-    void visit(VectorNode &aNode) {
-        for (Node *node: aNode.getNodes()) {
-            node->accept((*this));
+    template<typename N>
+    void printVector(N aNode) {
+        for (auto node: aNode->getNodes()) {
+            print(node);
         }
     }
 
-    void visit(DummyNode &aNode) {
-        std::cout << " [dummy]";
-    }
-
     // [<type> <name>]
-    void visit(VarNode &aNode) {
-        std::cout << " [" << show(aNode.getType())
-                  << " " << aNode.getName() << "]";
+    template<typename N>
+    void printVar(N aNode) {
+        std::cout << " [" << show(aNode->getType())
+                  << " " << aNode->getName() << "]";
     }
 
     // [<value>I]
-    void visit(IntegerNode &aNode) {
-        std::cout << " [" << aNode.getValue() << "I]";
+    void printInteger(int aValue) {
+        std::cout << " [" << aValue << "I]";
     }
 
     // [True] or [False]
-    void visit(BooleanNode &aNode) {
-        if (aNode.getValue()) {
+    void printBoolean(bool aValue) {
+        if (aValue) {
             std::cout << " [True]";
         } else {
             std::cout << "[False]";
@@ -56,110 +57,239 @@ public:
     }
 
     // [<value>F]
-    void visit(FloatNode &aNode) {
-        std::cout << " [" << aNode.getValue() << "F]";
+    void printFloat(float aValue) {
+        std::cout << " [" << aValue << "F]";
     }
 
     // (Assign <variable> <expression>)
-    void visit(AssignmentNode &aNode) {
+    template<typename N>
+    void printAssignment(N aNode) {
         std::cout << " (Assign ";
-        aNode.getLHS()->accept((*this));
-        aNode.getRHS()->accept((*this));
+        print(aNode->getLHS());
+        print(aNode->getRHS());
         std::cout << ")";
     }
 
     // (<operator> <lhs> <rhs>)
-    void visit(BinaryNode &aNode) {
-        std::cout << " (" << showOperator(aNode.getOp()) << " ";
-        aNode.getLHS()->accept((*this));
-        aNode.getRHS()->accept((*this));
-        std::cout << ")";
+    //
+    // A chain of operators leans left as deep as it's long (see
+    // Codegen::genBinary()), so its left spine is gathered onto a stack
+    // first rather than recursed down: every node on it opens, then the
+    // innermost lhs is printed, then each node's rhs, closing the node.
+    template<typename N>
+    void printBinary(N aNode) {
+        std::vector<N> spine{aNode};
+        for (N lhs = aNode->getLHS()->asBinary(); lhs != nullptr; lhs = lhs->getLHS()->asBinary()) {
+            spine.push_back(lhs);
+        }
+
+        for (N node: spine) {
+            std::cout << " (" << showOperator(node->getOp()) << " ";
+        }
+        print(spine.back()->getLHS());
+        for (auto node = spine.rbegin(); node != spine.rend(); ++node) {
+            print((*node)->getRHS());
+            std::cout << ")";
+        }
     }
 
     // (<operator> <subexpr>)
-    void visit(UnaryNode &aNode) {
-        std::cout << " (" << showOperator(aNode.getOp()) << " ";
-        aNode.getSubexpr()->accept((*this));
+    template<typename N>
+    void printUnary(N aNode) {
+        std::cout << " (" << showOperator(aNode->getOp()) << " ";
+        print(aNode->getSubexpr());
         std::cout << ")";
     }
 
     // (Call <name> : ( [arg]* ) -> <type>)
-    void visit(FuncallNode &aNode) {
-        std::cout << " (Call " << aNode.getName() << " : (";
-        for (ExpressionNode *node: aNode.getArgs()) {
-            node->accept((*this));
+    template<typename N>
+    void printFuncall(N aNode) {
+        std::cout << " (Call " << aNode->getName() << " : (";
+        for (auto node: aNode->getArgs()) {
+            print(node);
         }
-        std::cout << " ) -> " << show(aNode.getType()) << ")";
+        std::cout << " ) -> " << show(aNode->getType()) << ")";
     }
 
     // (Func <name> : ( [arg]* ) -> <type> <body>)
-    void visit(FunctionDefNode &aNode) {
-        std::cout << " (Func " << aNode.getName() << " : (";
-        for (VarNode *node: aNode.getArgs()) {
-            node->accept((*this));
+    template<typename N>
+    void printFunctionDef(N aNode) {
+        std::cout << " (Func " << aNode->getName() << " : (";
+        for (auto node: aNode->getArgs()) {
+            print(node);
         }
 
-        std::cout << " ) -> " << show(aNode.getType());
-        aNode.getBody()->accept((*this));
+        std::cout << " ) -> " << show(aNode->getType());
+        print(aNode->getBody());
         std::cout << ")";
     }
 
     // { [statement]* }
-    void visit(BlockStatementNode &aNode) {
+    template<typename N>
+    void printBlockStatement(N aNode) {
         std::cout << " {";
-        for (StatementNode *node: aNode.getStatements()) {
-            node->accept((*this));
+        for (auto node: aNode->getStatements()) {
+            print(node);
             std::cout << ";";
         }
         std::cout << " }";
     }
 
     // (If <expression> <statement> (Else <statement>)?
-    void visit(IfStatementNode &aNode) {
+    template<typename N>
+    void printIfStatement(N aNode) {
         std::cout << " (If ";
-        aNode.getCond()->accept((*this));
-        aNode.getTrueBranch()->accept((*this));
-        StatementNode *falseBranch = aNode.getFalseBranch();
-        if (falseBranch != NULL) {
+        print(aNode->getCond());
+        print(aNode->getTrueBranch());
+        auto falseBranch = aNode->getFalseBranch();
+        if (falseBranch != nullptr) {
             std::cout << " Else ";
-            falseBranch->accept((*this));
+            print(falseBranch);
         }
         std::cout << " )";
     }
 
     // (While <expression> <statement>)
-    void visit(WhileStatementNode &aNode) {
+    template<typename N>
+    void printWhileStatement(N aNode) {
         std::cout << " (While ";
-        aNode.getCond()->accept((*this));
-        aNode.getBody()->accept((*this));
+        print(aNode->getCond());
+        print(aNode->getBody());
         std::cout << " )";
     }
 
     // (Do <statement> While <expression>)
-    void visit(DoWhileStatementNode &aNode) {
+    template<typename N>
+    void printDoWhileStatement(N aNode) {
         std::cout << " (Do ";
-        aNode.getBody()->accept((*this));
+        print(aNode->getBody());
         std::cout << " While ";
-        aNode.getCond()->accept((*this));
+        print(aNode->getCond());
         std::cout << " )";
     }
 
-    // <expression>
-    void visit(ExpressionWrapperNode &aNode) {
-        aNode.getExpr()->accept((*this));
-    }
-
     // (Print <expression>)
-    void visit(IoPrintNode &aNode) {
+    template<typename N>
+    void printIoPrint(N aNode) {
         std::cout << " (Print ";
-        aNode.getSubexpr()->accept((*this));
+        print(aNode->getSubexpr());
         std::cout << ")";
     }
 
     // (Ret <expression>)
-    void visit(ReturnNode &aNode) {
+    template<typename N>
+    void printReturn(N aNode) {
         std::cout << " (Ret ";
-        aNode.getSubexpr()->accept((*this));
+        print(aNode->getSubexpr());
         std::cout << ")";
     }
+
+public:
+    Printer() {}
+
+    /// Prints a Node and its children, through StaticVisitor's switch.
+    void print(Node *aNode) { dispatch(aNode); }
+
+    /// Prints a FlatAST node, exactly as print(Node *) prints the same node
+    /// in a tree.
+    void print(FlatNode aNode) {
+        switch (aNode->getKind()) {
+            case NodeKind::Vector:
+                printVector(aNode);
+                break;
+            case NodeKind::Dummy:
+                std::cout << " [dummy]";
+                break;
+            case NodeKind::Var:
+                printVar(aNode);
+                break;
+            case NodeKind::Funcall:
+                printFuncall(aNode);
+                break;
+            case NodeKind::Boolean:
+                printBoolean(aNode->getBoolValue());
+                break;
+            case NodeKind::Integer:
+                printInteger(aNode->getIntValue());
+                break;
+            case NodeKind::Float:
+                printFloat(aNode->getFloatValue());
+                break;
+            case NodeKind::Binary:
+                printBinary(aNode);
+                break;
+            case NodeKind::Unary:
+                printUnary(aNode);
+                break;
+            case NodeKind::Assignment:
+                printAssignment(aNode);
+                break;
+            case NodeKind::FunctionDef:
+                printFunctionDef(aNode);
+                break;
+            case NodeKind::BlockStatement:
+                printBlockStatement(aNode);
+                break;
+            case NodeKind::IfStatement:
+                printIfStatement(aNode);
+                break;
+            case NodeKind::WhileStatement:
+                printWhileStatement(aNode);
+                break;
+            case NodeKind::DoWhileStatement:
+                printDoWhileStatement(aNode);
+                break;
+            case NodeKind::ExpressionWrapper:
+                // <expression>
+                print(aNode->getExpr());
+                break;
+            case NodeKind::IoPrint:
+                printIoPrint(aNode);
+                break;
+            case NodeKind::Return:
+                printReturn(aNode);
+                break;
+        }
+    }
+
+    void visit(VectorNode &aNode) { printVector(&aNode); }
+
+    void visit(DummyNode &aNode) {
+        std::cout << " [dummy]";
+    }
+
+    void visit(VarNode &aNode) { printVar(&aNode); }
+
+    void visit(IntegerNode &aNode) { printInteger(aNode.getValue()); }
+
+    void visit(BooleanNode &aNode) { printBoolean(aNode.getValue()); }
+
+    void visit(FloatNode &aNode) { printFloat(aNode.getValue()); }
+
+    void visit(AssignmentNode &aNode) { printAssignment(&aNode); }
+
+    void visit(BinaryNode &aNode) { printBinary(&aNode); }
+
+    void visit(UnaryNode &aNode) { printUnary(&aNode); }
+
+    void visit(FuncallNode &aNode) { printFuncall(&aNode); }
+
+    void visit(FunctionDefNode &aNode) { printFunctionDef(&aNode); }
+
+    void visit(BlockStatementNode &aNode) { printBlockStatement(&aNode); }
+
+    void visit(IfStatementNode &aNode) { printIfStatement(&aNode); }
+
+    void visit(WhileStatementNode &aNode) { printWhileStatement(&aNode); }
+
+    void visit(DoWhileStatementNode &aNode) { printDoWhileStatement(&aNode); }
+
+    // <expression>
+    void visit(ExpressionWrapperNode &aNode) {
+        print(aNode.getExpr());
+    }
+
+    void visit(IoPrintNode &aNode) { printIoPrint(&aNode); }
+
+    void visit(ReturnNode &aNode) { printReturn(&aNode); }
 };
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../Lexer/Interner.h"
+
+/**
+ * Name -> T bindings in nested scopes, keyed by interned SymbolId -- the
+ * one symbol table both the parser's semantic checks (variables, functions)
+ * and Codegen (allocas, Functions, function ASTs) use.
+ *
+ * It replaces a mix of std::map<std::string, ...> tables, where every
+ * variable reference and call did a string-comparing tree walk, and
+ * Codegen's ScopeStack, which repeated that once per enclosing scope.
+ * Functions with hundreds of locals spent most of codegen there.
+ *
+ * SymbolIds are small and dense (0, 1, 2, ... in first-seen order), so
+ * the hash table is a flat array indexed by the ID itself: no hashing, no
+ * probing, no collisions. Each slot holds the innermost binding of that
+ * name, and each binding remembers the one it shadows. So:
+ *  - lookup() is one array read, whatever the nesting depth;
+ *  - push() is O(1);
+ *  - pop() only touches the bindings made in that scope, restoring
+ *    whatever each one shadowed.
+ */
+template<typename T>
+class SymbolTable {
+private:
+    static constexpr std::uint32_t None = ~std::uint32_t(0);
+
+    struct Binding {
+        SymbolId name;
+        T value;
+        // The binding this one shadows (index into bindings), or None.
+        std::uint32_t shadowed;
+    };
+
+    // Per SymbolId: its innermost binding (index into bindings), or None.
+    std::vector<std::uint32_t> innermost;
+    std::vector<Binding> bindings;
+    // Per open scope: bindings.size() when it was pushed.
+    std::vector<std::uint32_t> scopeStarts;
+
+    std::uint32_t find(SymbolId aName) const {
+        return aName < innermost.size() ? innermost[aName] : None;
+    }
+
+public:
+    /// Starts with one (outermost) scope open.
+    SymbolTable() { push(); }
+
+    /// Drops every binding and scope, leaving one empty outermost scope.
+    void clear() {
+        innermost.clear();
+        bindings.clear();
+        scopeStarts.clear();
+        push();
+    }
+
+    void push() {
+        scopeStarts.push_back(static_cast<std::uint32_t>(bindings.size()));
+    }
+
+    void pop() {
+        std::uint32_t start = scopeStarts.back();
+        scopeStarts.pop_back();
+        while (bindings.size() > start) {
+            const Binding &binding = bindings.back();
+            innermost[binding.name] = binding.shadowed;
+            bindings.pop_back();
+        }
+    }
+
+    /**
+     * Binds aName in the innermost scope, shadowing any binding from an
+     * enclosing one. A name already bound in the innermost scope itself is
+     * rebound to aValue.
+     */
+    void declare(SymbolId aName, T aValue) {
+        std::uint32_t current = find(aName);
+        if (current != None && current >= scopeStarts.back()) {
+            bindings[current].value = aValue;
+            return;
+        }
+
+        if (aName >= innermost.size()) {
+            innermost.resize(aName + 1, None);
+        }
+        innermost[aName] = static_cast<std::uint32_t>(bindings.size());
+        bindings.push_back(Binding{aName, aValue, current});
+    }
+
+    /// The innermost binding of aName, or T() (nullptr) if it has none.
+    T lookup(SymbolId aName) const {
+        std::uint32_t current = find(aName);
+        return current != None ? bindings[current].value : T();
+    }
+};
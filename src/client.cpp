@@ -0,0 +1,6 @@
+#include "Compiler/CompileServer.h"
+
+// `pudl --client`, as a program of its own -- see CMakeLists.txt.
+int main(int argc, char *argv[]) {
+    return CompileServer::Forward(argc, argv);
+}
@@ -1,15 +1,25 @@
+#include <algorithm>
 #include <iostream>
 #include <cstdio>
+#include <cstdlib>
 
 #include "llvm/TargetParser/Host.h"
 
+#include "Parser/ASTFile.h"
 #include "Parser/Printer.h"
 #include "Parser/Codegen.h"
+#include "Parser/ParallelCodegen.h"
 #include "Parser/Parser.h"
 #include "Compiler/CLIManager.h"
+#include "Compiler/CompilationCache.h"
+#include "Compiler/CompileServer.h"
+#include "Compiler/InputFile.h"
+#include "Compiler/Target.h"
 #include "Version.h"
 
-int main(int argc, char *argv[]) {
+// One `pudl` invocation, start to finish -- run by main() directly, or by
+// a `pudl --serve` for a `pudl --client`.
+static int run(int argc, char *argv[]) {
 
     // Width computed from the banner text itself, not hardcoded to match
     // "v.0.0.1"'s length -- a version bump used to silently misalign the
@@ -29,8 +39,9 @@ int main(int argc, char *argv[]) {
     cli.warnUnknownOptions({
             "--help", "-h", "--version", "-v", "-p", "--print-ir",
             "-c", "--compile", "-o", "--output", "-l", "--linker",
-            "-d", "--debug",
-            "-O0", "-ONone", "-O1", "-O2", "-O3", "-O4", "-O5", "-O6", "-Oall"
+            "-d", "--debug", "--jit", "-j", "--jobs", "--ast", "--emit-ast", "--cache-dir", "--cache-size",
+            "-O0", "-ONone", "-O1", "-O2", "-O3", "-Oall", "-Os", "-Oz", "--passes",
+            "-march", "-mcpu", "-mattr"
     });
 
     bool isSourceFile = false;
@@ -41,7 +52,7 @@ int main(int argc, char *argv[]) {
 
     if (argc < 2 || cli.hasOption("--help") || cli.hasOption("-h")) {
         std::string help = R"(
-        ./pudl.sh <file> [--help,-h] [--version,-v] [-p,--print-ir <out file>] [-c,--compile <out file>] [-o, --output <out file>] [-O<N>] [-l,--linker <linker>]
+        ./pudl.sh <file> [--help,-h] [--version,-v] [-p,--print-ir <out file>] [-c,--compile <out file>] [-o, --output <out file>] [-O<N>] [--passes=<pipeline>] [-march=<cpu>] [-mcpu=<cpu>] [-mattr=<features>] [-l,--linker <linker>] [--jit=<mode>] [-j,--jobs <N>] [--ast=<repr>] [--emit-ast <out file>] [--cache-dir=<dir>] [--cache-size=<MB>]
 
         Every option taking a value accepts either "-o value" or "-o=value"
         (equivalently "--output value" / "--output=value").
@@ -50,26 +61,58 @@ int main(int argc, char *argv[]) {
         <file>                The file to run.
                                           - Source file
         - Compiled object file
+        - AST file (--emit-ast)
 
         -c, --compile         Compile the source file to an object file
         -o, --output          Create an executable output file
         -l, --linker          Linker command to call when linking object files.
                                                                          - Default: autodetected (see Linker::DetectDefault)
+                                                                         - lld: link in-process (builds with -DPUDL_ENABLE_LLD=ON)
         -h, --help            Get usage and available options
         -v, --version         Print the Pudl version and exit
         -p  --print-ir        Print generated LLVM IR to stdout or to a file
         -d, --debug           Print debug information
-
-        -O<N>                 Optimization level
-        - Default: OAll
-        - None: No optimizations
-        - 0: No optimizations
-        - 1: Promote allocas to registers
-        - 2: Reassociate expressions
-        - 3: Dead code elimination
-        - 4: Global value numbering
-        - 5: Simplify control flow graph (CFG)
-        - All: All optimizations
+        --jit=<mode>          How to JIT-compile a source file that is run
+                                          - eager: Compile every function before running (default)
+                                          - lazy: Compile each function on its first call
+        -j, --jobs <N>        Generate functions, and compile them to machine code, on N threads
+                                          - Default: one thread, without the per-thread split
+        --ast=<repr>          How the parsed program is held while generating IR (same IR either way)
+                                          - tree: A Node object per node (default)
+                                          - flat: Parallel arrays, walked with a switch (not with -j)
+        --emit-ast <out file> Parse the source file and save the AST to a file (default: <file>.pudlast),
+                              which can be given as <file> in place of the source
+        --cache-dir=<dir>     Keep compiled programs in <dir>, and reuse them when the same
+                              source is compiled again with the same options (when running: the
+                              same IR, per function with --jit=lazy)
+                                          - Default: $PUDL_CACHE_DIR if set, otherwise no cache
+        --cache-size=<MB>     Evict least recently used programs past this size (default: 512)
+
+        -O<N>                 Optimization level (LLVM's standard pipelines, as clang -O<N>)
+        - Default: O2
+        - 0, None: No optimizations
+        - 1: Optimize quickly, without much inlining or loop work
+        - 2: Full optimization
+        - 3, All: Full optimization, plus more aggressive inlining and loop transforms
+        - s: Like 2, but favor smaller code
+        - z: Smallest code
+        --passes=<pipeline>   Run this LLVM pass pipeline instead of -O<N>,
+                              in `opt -passes=` syntax, e.g. function(mem2reg,instcombine)
+
+        -march=<cpu>          CPU to generate code for
+        - Default: native (this machine's CPU and all of its features)
+        - generic: Baseline for the architecture, runs anywhere
+        -mcpu=<cpu>           Same as -march=, and takes precedence over it
+        -mattr=<features>     Extra features to enable/disable, e.g. +avx2,-avx512f
+
+    ./pudl.sh --serve [--socket=<path>] [--workers=<N>] [-d]
+    ./pudl.sh --client [--socket=<path>] <file> [options]
+
+        --serve               Keep LLVM initialized and serve compiles on a Unix domain socket
+        --client              Have the server run `pudl <file> [options]` here
+        --socket=<path>       Socket to serve on or connect to
+                                          - Default: $XDG_RUNTIME_DIR/pudl.sock, otherwise /tmp/pudl-<uid>/pudl.sock
+        --workers=<N>         Requests the server handles at once (default: one per core)
         )";
 
         std::cerr << help << std::endl;
@@ -77,25 +120,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Check if file is binary or ASCII
-    FILE *file = fopen(argv[1], "r");
-    if (file) {
-        int c;
-        while ((c = getc(file)) != EOF && c <= 127);
-        if (c == EOF) {
-            // File is ASCII, ostensibly a Pudl source file
-            isSourceFile = true;
-        } else {
-            // File is binary, ostensibly a compiled Pudl object file
-            isSourceFile = false;
-        }
-        rewind(file);
-    } else {
+    // Loaded once: the first few bytes decide source vs object (see
+    // InputFile.h), and a source file's buffer then goes straight to the
+    // lexer. Mapped rather than read for anything big enough that it
+    // matters, so an object file's contents past its header never are.
+    auto source = llvm::MemoryBuffer::getFile(argv[1], /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!source) {
         std::cout << "Can't open file " << argv[1] << "\n";
         return 1;
     }
+    isSourceFile = !InputFile::IsObject((*source)->getBuffer());
+    // Taken from there on as the source it was parsed from (see ASTFile.h):
+    // only the parser is skipped.
+    bool isASTFile = ASTFile::IsASTFile((*source)->getBuffer());
 
-    std::cout << "Loading " << (isSourceFile ? "source" : "object") << " file " << argv[1] << std::endl;
+    std::cout << "Loading " << (isASTFile ? "AST" : isSourceFile ? "source" : "object") << " file " << argv[1]
+              << std::endl;
 
     if (cli.hasOption("-d") || cli.hasOption("--debug")) {
         std::cout << "In debug mode" << std::endl;
@@ -108,6 +148,45 @@ int main(int argc, char *argv[]) {
         printIR = true;
     }
 
+    JIT::Mode jitMode = JIT::Mode::Eager;
+    if (cli.hasOption("--jit")) {
+        std::string mode = cli.getOptionValue("--jit");
+        if (mode == "lazy") {
+            jitMode = JIT::Mode::Lazy;
+        } else if (mode != "eager") {
+            std::cerr << "Unknown JIT mode '" << mode << "' (expected eager or lazy)" << std::endl;
+            return 1;
+        }
+    }
+
+    unsigned jobs = 0;
+    if (cli.hasOption("-j") || cli.hasOption("--jobs")) {
+        std::string value = cli.getOptionValue("-j", cli.getOptionValue("--jobs"));
+        char *end = nullptr;
+        unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed == 0 || parsed > 1024) {
+            std::cerr << "Invalid job count '" << value << "' (expected 1 to 1024)" << std::endl;
+            return 1;
+        }
+        jobs = static_cast<unsigned>(parsed);
+    }
+
+    bool flatAST = false;
+    if (cli.hasOption("--ast")) {
+        std::string representation = cli.getOptionValue("--ast");
+        if (representation == "flat") {
+            flatAST = true;
+        } else if (representation != "tree") {
+            std::cerr << "Unknown AST representation '" << representation << "' (expected tree or flat)" << std::endl;
+            return 1;
+        }
+    }
+    // ParallelCodegen hands each thread FunctionDefNodes.
+    if (flatAST && jobs > 0) {
+        std::cerr << "--ast=flat can't be combined with -j" << std::endl;
+        return 1;
+    }
+
     std::string cOut = cli.getOptionValue("-c", cli.getOptionValue("--compile"));
     if (cli.hasOption("-c") || cli.hasOption("--compile")) {
         if (cOut.empty()) {
@@ -162,85 +241,219 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    auto parser = Parser(debug);
-
-    Node *root = parser.parse(file);
+    std::string astOut = cli.getOptionValue("--emit-ast");
+    bool emitAST = cli.hasOption("--emit-ast");
+    if (emitAST) {
+        if (!isSourceFile) {
+            std::cerr << "An object file has no AST to emit" << std::endl;
+            return 1;
+        }
+        if (compile || link) {
+            std::cerr << "Can't write an AST file and compile or link at the same time" << std::endl;
+            return 1;
+        }
+        if (astOut.empty()) {
+            // If no AST output file is specified, use the input file name
+            astOut = argv[1];
+            astOut = astOut.substr(astOut.find_last_of("/\\") + 1);
+            astOut = astOut.substr(0, astOut.find_last_of('.'));
+            astOut += ".pudlast";
+        }
+        std::cout << "Emitting AST file: " << astOut << std::endl;
+        // The file is a FlatAST's arrays.
+        flatAST = true;
+    }
 
     Printer printer = Printer();
-    Codegen codegen = Codegen(debug);
-
-    bool optimizeLevelSpecified = false;
-
-    if (cli.hasOption("-O0") || cli.hasOption("-ONone")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: none" << std::endl;
+    TargetSpec target = TargetSpec::Resolve(
+            cli.getOptionValue("-march"), cli.getOptionValue("-mcpu"), cli.getOptionValue("-mattr")
+    );
+    Codegen codegen = Codegen(debug, target);
+
+    // Last -O<N> on the command line wins, like every C compiler driver.
+    // -ONone and -Oall are kept as aliases from when levels were single
+    // hand-picked passes (-O1..-O6) plus "all six of them".
+    const std::vector<std::pair<std::string, OptimizationLevel>> optLevels = {
+            {"-O0",    OptimizationLevel::O0},
+            {"-ONone", OptimizationLevel::O0},
+            {"-O1",    OptimizationLevel::O1},
+            {"-O2",    OptimizationLevel::O2},
+            {"-O3",    OptimizationLevel::O3},
+            {"-Oall",  OptimizationLevel::O3},
+            {"-Os",    OptimizationLevel::Os},
+            {"-Oz",    OptimizationLevel::Oz},
+    };
+
+    std::string optFlag;
+    for (const std::string &arg: cli.args) {
+        for (const auto &level: optLevels) {
+            if (arg == level.first) {
+                optFlag = arg;
+                codegen.setOptimizationLevel(level.second);
+            }
+        }
     }
 
-    if (cli.hasOption("-O1")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: promote allocas to registers" << std::endl;
-        codegen.opt_promote_to_reg();
+    std::string passes = cli.getOptionValue("--passes");
+    if (cli.hasOption("--passes")) {
+        std::cout << "Optimization: custom pipeline " << passes << std::endl;
+        codegen.setPassPipeline(passes);
+    } else {
+        if (optFlag.empty()) {
+            optFlag = "-O2";
+            std::cout << "No optimization level specified, using level " << optFlag << std::endl;
+        }
+        std::cout << "Optimization: " << optFlag << std::endl;
     }
 
-    if (cli.hasOption("-O2")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: instruction combining" << std::endl;
-        codegen.opt_instcombine();
-    }
+    // -c, -o or run, for a source file already compiled to object file(s).
+    auto useObjects = [&](llvm::ArrayRef<llvm::StringRef> aObjects) {
+        if (compile) {
+            codegen.writeObjects(aObjects, cOut.c_str(), linker.c_str());
+        } else if (link) {
+            codegen.linkObjects(aObjects, oOut.c_str(), linker.c_str());
+        } else {
+            codegen.runObjects(aObjects);
+        }
+    };
 
-    if (cli.hasOption("-O3")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: reassociate" << std::endl;
-        codegen.opt_reassociate();
+    // See CompilationCache.h. Source files only.
+    std::string cacheDir = cli.getOptionValue("--cache-dir");
+    if (!cli.hasOption("--cache-dir") && std::getenv("PUDL_CACHE_DIR") != nullptr) {
+        cacheDir = std::getenv("PUDL_CACHE_DIR");
     }
-
-    if (cli.hasOption("-O4")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: dead code elimination" << std::endl;
-        codegen.opt_dce();
+    std::uint64_t cacheMaxBytes = CompilationCache::DefaultMaxBytes;
+    if (cli.hasOption("--cache-size")) {
+        std::string value = cli.getOptionValue("--cache-size");
+        char *end = nullptr;
+        unsigned long long megabytes = std::strtoull(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || megabytes == 0) {
+            std::cerr << "Invalid cache size '" << value << "' (expected a number of MB)" << std::endl;
+            return 1;
+        }
+        cacheMaxBytes = megabytes * 1024 * 1024;
     }
+    CompilationCache cache(isSourceFile && !emitAST ? cacheDir : "", cacheMaxBytes, debug);
 
-    if (cli.hasOption("-O5")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: global value numbering" << std::endl;
-        codegen.opt_gvn();
+    // How many object files to compile to (see Codegen::emitObjects()):
+    // -c has to combine them into one again, which needs a linker that can.
+    unsigned partitions = std::max(1u, jobs);
+    if (partitions > 1 && compile && !Linker::CanLinkRelocatable(linker)) {
+        partitions = 1;
     }
 
-    if (cli.hasOption("-O6")) {
-        optimizeLevelSpecified = true;
-        std::cout << "Optimization: simplify CFG" << std::endl;
-        codegen.opt_simplifyCFG();
+    // The whole program, by its source -- not for --jit=lazy, which exists
+    // to compile less than the whole program, which is all such an entry
+    // can hold.
+    std::string cacheKey;
+    if (cache.isEnabled() && jitMode == JIT::Mode::Eager) {
+        cacheKey = CompilationCache::Key((*source)->getBuffer(), {
+                PUDL_VERSION, target.cpu, target.features, optFlag, passes,
+                std::to_string(jobs), std::to_string(partitions)
+        });
+
+        // A hit skips everything from lexing on -- except for -p, which
+        // needs the IR, and that isn't cached.
+        if (!printIR) {
+            if (auto entry = cache.lookup(cacheKey)) {
+                std::cout << std::endl;
+                useObjects(entry->objects);
+                std::cout << std::endl;
+                return 0;
+            }
+        }
     }
 
-    if (cli.hasOption("-Oall") || !optimizeLevelSpecified) {
+    // Running rather than -c/-o: the JIT keeps its machine code in the
+    // same directory, by IR (see JITObjectCache.h) -- per function with
+    // --jit=lazy. In eager mode the program's entry (cacheKey) is stored
+    // from there too.
+    bool runsFromJITCache = isSourceFile && !compile && !link && cache.isEnabled();
+    JITObjectCache jitCache(cache, {PUDL_VERSION, target.cpu, target.features, optFlag, passes});
+    jitCache.setProgramKey(cacheKey);
+    // And optimizes only on a miss -- unless -p needs the optimized IR.
+    bool deferOptimization = runsFromJITCache && jitMode == JIT::Mode::Eager && !printIR;
 
-        if (!cli.hasOption("-Oall") && !optimizeLevelSpecified) {
-            std::cout << "No optimization level specified, using level -Oall" << std::endl;
+    auto parser = Parser(debug);
+    auto flatParser = FlatParser(debug);
+    // An AST file's nodes, and (as a tree) the Nodes built from them.
+    // Both live as long as the parsers above do.
+    ASTFile astFile;
+    TreeBuilder treeBuilder;
+
+    // An object file has no Pudl source to parse: it goes through the rest
+    // of the pipeline (linkObject()/runObject()) as an empty program.
+    auto input = isSourceFile ? std::move(*source) : llvm::MemoryBuffer::getMemBuffer("");
+    // With --ast=flat, the program is parsed into a FlatAST instead (see
+    // FlatAST.h), and printed and generated by the same code as a tree.
+    Node *root = nullptr;
+    FlatNode flatRoot;
+    if (isASTFile) {
+        if (astFile.load(std::move(input)) != 0) {
+            return 1;
         }
+        if (flatAST) {
+            flatRoot = astFile.getRoot();
+        } else {
+            root = astFile.buildTree(treeBuilder);
+        }
+    } else if (flatAST) {
+        flatRoot = flatParser.parse(std::move(input));
+    } else {
+        root = parser.parse(std::move(input));
+    }
+    bool parseFailed = !isASTFile && (flatAST ? flatParser.isFailed() : parser.isFailed());
 
-        std::cout << "Optimization: instruction combining, " << std::endl
-                  << "\t promote allocas to registers, " << std::endl
-                  << "\t reassociate, " << std::endl
-                  << "\t dead code elimination, " << std::endl
-                  << "\t global value numbering, " << std::endl
-                  << "\t simplify CFG" << std::endl;
-
-        codegen.opt_promote_to_reg();
-        codegen.opt_instcombine();
-        codegen.opt_reassociate();
-        codegen.opt_dce();
-        codegen.opt_gvn();
-        codegen.opt_simplifyCFG();
+    if (emitAST) {
+        if (parseFailed || flatRoot == nullptr) {
+            std::cerr << "Parse failed; not writing AST file" << std::endl;
+            return 1;
+        }
+        std::error_code error;
+        llvm::raw_fd_ostream out(astOut, error);
+        if (!error) {
+            ASTFile::Write(isASTFile ? astFile.getAST() : flatParser.getBuilder().getAST(), flatRoot.getIndex(), out);
+            out.close();
+            error = out.error();
+            out.clear_error();
+        }
+        if (error) {
+            std::cerr << "ERROR@AST: Can't write " << astOut << ": " << error.message() << std::endl;
+            return 1;
+        }
+        std::cout << std::endl;
+        return 0;
     }
 
-    if (root != nullptr) {
+    if (root != nullptr || flatRoot != nullptr) {
         if (debug) {
-            root->accept(printer);
+            if (flatAST) {
+                printer.print(flatRoot);
+            } else {
+                printer.print(root);
+            }
         }
 
-        if (!parser.isFailed()) {
+        if (!parseFailed) {
             std::cout << std::endl;
-            root->accept(codegen);
+            // Without -j, generated in one pass on this thread, as always.
+            // With it (even -j 1), per-function work happens in
+            // ParallelCodegen's shards, so the result doesn't depend on N.
+            if (flatAST) {
+                codegen.generate(flatRoot);
+            } else if (jobs > 0) {
+                codegen.setJobs(jobs);
+                ParallelCodegen::Generate(codegen, *root, jobs);
+            } else {
+                codegen.generate(root);
+            }
+
+            if (isSourceFile && (compile || link || !cacheKey.empty())) {
+                // Only a standalone object/executable needs a C `main` --
+                // running in-process calls mast() directly. A cached
+                // program gets one either way, so one entry serves all three.
+                codegen.emitEntryPoint();
+            }
 
             // The per-node guards inside Codegen only stop that node's own
             // subtree from generating further IR after an error -- nothing
@@ -249,10 +462,25 @@ int main(int argc, char *argv[]) {
             // unless it's checked here.
             if (codegen.isFailed()) {
                 std::cerr << "Codegen failed; not compiling, linking, or running." << std::endl;
+            } else if (codegen.optimize(deferOptimization) != 0) {
+                std::cerr << "Optimization failed; not compiling, linking, or running." << std::endl;
+            } else if (runsFromJITCache) {
+                codegen.runSource(jitMode, &jitCache);
+            } else if (!cacheKey.empty()) {
+                // A cache miss: compile to object file(s) once, keep them
+                // for next time, and -c/-o from them.
+                std::vector<llvm::SmallVector<char, 0>> objects;
+                if (codegen.emitObjects(objects, partitions) != 0) {
+                    std::cerr << "ERROR@COMPILE: Compilation failed" << std::endl;
+                } else {
+                    std::vector<llvm::StringRef> objectRefs = Codegen::ObjectRefs(objects);
+                    cache.store(cacheKey, objectRefs);
+                    useObjects(objectRefs);
+                }
             } else {
                 if (compile) {
                     // Equivalence: gcc foo.pudl -c foo.o >> foo.o
-                    codegen.compile(cOut.c_str());
+                    codegen.compile(cOut.c_str(), linker.c_str());
                 }
 
                 if (link) {
@@ -268,7 +496,7 @@ int main(int argc, char *argv[]) {
                 // Run input file if no compile or link steps are requested
                 if (!link && !compile) {
                     if (isSourceFile) {
-                        codegen.runSource();
+                        codegen.runSource(jitMode);
                     } else {
                         if (linker.empty()) {
                             std::cout << "No linker was specified for linker step." << std::endl;
@@ -298,4 +526,29 @@ int main(int argc, char *argv[]) {
     }
 
     std::cout << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "--client") {
+        return CompileServer::Forward(argc, argv);
+    }
+
+    if (mode == "--serve") {
+        return CompileServer::Serve(argc, argv, []() {
+            // What every request gets already done: the native target's
+            // initialization, the host CPU's detection (TargetSpec::Host())
+            // and the linker probe, each kept for the process. The Codegen
+            // itself is thrown away -- a request builds its own
+            // TargetMachine and pass pipeline -- and is only run so the
+            // code behind them is paged in before the first request.
+            Codegen codegen(false, TargetSpec::Resolve("", "", ""));
+            codegen.optimize();
+            Linker::DetectDefault();
+        }, run);
+    }
+
+    return run(argc, argv);
 }
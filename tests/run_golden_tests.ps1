@@ -1,7 +1,7 @@
 # Golden-file regression tests for Pudl example programs (Windows/PowerShell).
 #
 # Usage:
-#   run_golden_tests.ps1 -Bin <path-to-pudl-binary> [-Record] [-Ir]
+#   run_golden_tests.ps1 -Bin <path-to-pudl-binary> [-Record] [-Ir] [-JitLazy] [-Jobs] [-Cache] [-FlatAst]
 #
 # See run_golden_tests.sh for full behavior notes — this is the same test
 # logic, kept in a separate script rather than requiring bash on Windows CI.
@@ -11,7 +11,11 @@ param(
     [string]$Bin,
 
     [switch]$Record,
-    [switch]$Ir
+    [switch]$Ir,
+    [switch]$JitLazy,
+    [switch]$Jobs,
+    [switch]$Cache,
+    [switch]$FlatAst
 )
 
 $ErrorActionPreference = "Stop"
@@ -25,6 +29,16 @@ $KnownBrokenFile = Join-Path $ScriptDir "KNOWN_BROKEN.md"
 
 $IrSubset = @("main", "ex1", "ex5")
 
+$ExtraArgs = @()
+if ($JitLazy) { $ExtraArgs += "--jit=lazy" }
+if ($Jobs) { $ExtraArgs += @("-j", "4") }
+if ($FlatAst) { $ExtraArgs += "--ast=flat" }
+$CacheDir = $null
+if ($Cache) {
+    $CacheDir = Join-Path ([System.IO.Path]::GetTempPath()) ("pudl-cache-" + [System.Guid]::NewGuid())
+    $ExtraArgs += "--cache-dir=$CacheDir"
+}
+
 if (-not (Test-Path $Bin)) {
     Write-Error "pudl binary not found: $Bin"
     exit 2
@@ -115,7 +129,9 @@ try {
                 $fail = $true
                 continue
             }
-            $actual = Invoke-Pudl -PudlArgs @($rel, "-p")
+            $actual = Invoke-Pudl -PudlArgs (@($rel) + $ExtraArgs + @("-p"))
+            # Host-specific -- see run_golden_tests.sh.
+            $actual = (($actual -split "`n") | Where-Object { $_ -notmatch '^target (datalayout|triple) = ' }) -join "`n"
             $ok = Invoke-CheckOrRecord -Name $name -ExpectedPath (Join-Path $GoldenIrDir "$name.ir.txt") -Actual $actual
             if (-not $ok) { $fail = $true }
         }
@@ -124,13 +140,22 @@ try {
         Get-ChildItem -Path $ExamplesDir -Filter "*.pudl" | ForEach-Object {
             $name = $_.BaseName
             $rel = "examples/$name.pudl"
-            $actual = Invoke-Pudl -PudlArgs @($rel)
+            $actual = Invoke-Pudl -PudlArgs (@($rel) + $ExtraArgs)
             $ok = Invoke-CheckOrRecord -Name $name -ExpectedPath (Join-Path $GoldenDir "$name.expected.txt") -Actual $actual
             if (-not $ok) { $fail = $true }
+            if ($Cache) {
+                # Second run: from the cache -- see run_golden_tests.sh.
+                $actual = Invoke-Pudl -PudlArgs (@($rel) + $ExtraArgs)
+                $ok = Invoke-CheckOrRecord -Name "$name (cached)" -ExpectedPath (Join-Path $GoldenDir "$name.expected.txt") -Actual $actual
+                if (-not $ok) { $fail = $true }
+            }
         }
     }
 } finally {
     Pop-Location
+    if ($CacheDir -and (Test-Path $CacheDir)) {
+        Remove-Item -Recurse -Force $CacheDir
+    }
 }
 
 if ($fail) { exit 1 } else { exit 0 }
@@ -2,7 +2,7 @@
 # Golden-file regression tests for Pudl example programs.
 #
 # Usage:
-#   run_golden_tests.sh <path-to-pudl-binary> [--record] [--ir]
+#   run_golden_tests.sh <path-to-pudl-binary> [--record] [--ir] [--jit-lazy] [--jobs] [--cache] [--flat-ast]
 #
 # Default mode: for each examples/*.pudl, runs the binary and diffs its
 # combined stdout+stderr against tests/golden/<name>.expected.txt, failing
@@ -15,7 +15,32 @@
 # --ir: instead of the full example set, runs a small representative subset
 #       with `-p` (print IR) and snapshots the emitted LLVM IR to
 #       tests/golden-ir/<name>.ir.txt, to catch codegen/optimization
-#       regressions that don't show up in program stdout.
+#       regressions that don't show up in program stdout. The module's
+#       host-specific `target datalayout`/`target triple` lines are left
+#       out of the snapshot.
+#
+# --jit-lazy: runs every example with `--jit=lazy` and diffs against the
+#             same golden files as the default mode -- compiling functions on
+#             first call instead of up front must not change a program's
+#             output.
+#
+# --jobs: runs every example with `-j 4` and diffs against the same golden
+#         files -- generating functions on several threads
+#         (Parser/ParallelCodegen.h) must not change a program's output.
+#
+# --cache: runs every example twice against a fresh --cache-dir and diffs
+#          both runs against the same golden files -- the first compiles
+#          and stores the program, the second runs it from the cache
+#          (Compiler/CompilationCache.h) without compiling it, and neither
+#          may change its output. With --jit-lazy, the second run takes
+#          each function's machine code from the JIT's object cache
+#          instead (Compiler/JIT/JITObjectCache.h).
+#
+# --flat-ast: runs every example with `--ast=flat` and diffs against the
+#             same golden files -- parsing into a FlatAST
+#             (Parser/AST/FlatAST.h) instead of a tree of Nodes must not
+#             change a program's output. With --ir, its IR must not change
+#             either.
 #
 # A mismatch for a name listed in KNOWN_BROKEN.md is reported but does not
 # fail the run — those examples are tracked bugs, not regressions, until
@@ -35,7 +60,7 @@ KNOWN_BROKEN_FILE="$SCRIPT_DIR/KNOWN_BROKEN.md"
 IR_SUBSET="main ex1 ex5"
 
 if [ "$#" -lt 1 ]; then
-  echo "Usage: $0 <path-to-pudl-binary> [--record] [--ir]" >&2
+  echo "Usage: $0 <path-to-pudl-binary> [--record] [--ir] [--jit-lazy] [--jobs] [--cache] [--flat-ast]" >&2
   exit 2
 fi
 
@@ -43,10 +68,16 @@ BIN="$1"
 shift
 RECORD=0
 IR_MODE=0
+CACHE_MODE=0
+EXTRA_ARGS=()
 for arg in "$@"; do
   case "$arg" in
     --record) RECORD=1 ;;
     --ir) IR_MODE=1 ;;
+    --jit-lazy) EXTRA_ARGS+=("--jit=lazy") ;;
+    --jobs) EXTRA_ARGS+=("-j" "4") ;;
+    --cache) CACHE_MODE=1 ;;
+    --flat-ast) EXTRA_ARGS+=("--ast=flat") ;;
     *) echo "unknown argument: $arg" >&2; exit 2 ;;
   esac
 done
@@ -102,6 +133,12 @@ check_or_record() {
 
 fail=0
 
+if [ "$CACHE_MODE" -eq 1 ]; then
+  CACHE_DIR="$(mktemp -d)"
+  trap 'rm -rf "$CACHE_DIR"' EXIT
+  EXTRA_ARGS+=("--cache-dir=$CACHE_DIR")
+fi
+
 # Run from the repo root and pass example paths relative to it (e.g.
 # "examples/main.pudl"), never absolute — the CLI echoes back whatever path
 # it was given ("Loading source file ..."), and an absolute path would bake
@@ -118,7 +155,10 @@ if [ "$IR_MODE" -eq 1 ]; then
       fail=1
       continue
     fi
-    actual="$("$BIN" "$rel" -p 2>&1)"
+    # The module's target triple and data layout are the host's own
+    # (Codegen targets the machine it runs on), so they'd differ between
+    # every CI runner and developer machine -- drop them from the snapshot.
+    actual="$("$BIN" "$rel" ${EXTRA_ARGS[@]+"${EXTRA_ARGS[@]}"} -p 2>&1 | grep -v -E '^target (datalayout|triple) = ')"
     check_or_record "$name" "$GOLDEN_IR_DIR/$name.ir.txt" "$actual" || fail=1
   done
 else
@@ -127,8 +167,12 @@ else
     [ -e "$src" ] || continue
     name="$(basename "$src" .pudl)"
     rel="examples/$name.pudl"
-    actual="$("$BIN" "$rel" 2>&1)"
+    actual="$("$BIN" "$rel" ${EXTRA_ARGS[@]+"${EXTRA_ARGS[@]}"} 2>&1)"
     check_or_record "$name" "$GOLDEN_DIR/$name.expected.txt" "$actual" || fail=1
+    if [ "$CACHE_MODE" -eq 1 ]; then
+      actual="$("$BIN" "$rel" ${EXTRA_ARGS[@]+"${EXTRA_ARGS[@]}"} 2>&1)"
+      check_or_record "$name (cached)" "$GOLDEN_DIR/$name.expected.txt" "$actual" || fail=1
+    fi
   done
 fi
 
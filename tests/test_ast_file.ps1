@@ -0,0 +1,84 @@
+# Round trip through --emit-ast (Parser/ASTFile.h) for every example.
+# See test_ast_file.sh for the full explanation.
+#
+# Usage: test_ast_file.ps1 -Bin <path-to-pudl-binary>
+
+param(
+    [Parameter(Mandatory = $true)]
+    [string]$Bin
+)
+
+$ScriptDir = Split-Path -Parent $MyInvocation.MyCommand.Path
+$RepoRoot = Split-Path -Parent $ScriptDir
+
+# Runs pudl, returning its combined output less the "Loading ... file"
+# line. See run_golden_tests.ps1's Invoke-Pudl for why this goes through
+# cmd.exe rather than PowerShell's own `&`-plus-redirection.
+function Invoke-Pudl([string[]]$PudlArgs) {
+    $quoted = (@($Bin) + $PudlArgs) | ForEach-Object { '"' + $_ + '"' }
+    $cmdLine = $quoted -join ' '
+    $lines = cmd /c "$cmdLine 2>&1"
+    return (@($lines) | Where-Object { -not "$_".StartsWith("Loading ") }) -join "`n"
+}
+
+$workDir = Join-Path ([System.IO.Path]::GetTempPath()) ("pudl-ast-" + [System.Guid]::NewGuid())
+New-Item -ItemType Directory -Path $workDir | Out-Null
+
+Push-Location $RepoRoot
+try {
+    $fail = $false
+    $count = 0
+
+    foreach ($src in Get-ChildItem -Path (Join-Path $RepoRoot "examples") -Filter "*.pudl" | Sort-Object Name) {
+        $name = $src.BaseName
+        $ast = Join-Path $workDir "$name.pudlast"
+        $count++
+
+        Invoke-Pudl @($src.FullName, "--emit-ast", $ast) | Out-Null
+        if (-not (Test-Path $ast) -or (Get-Item $ast).Length -eq 0) {
+            Write-Host "FAIL: ${name}: --emit-ast did not write an AST file"
+            $fail = $true
+            continue
+        }
+
+        $expected = Invoke-Pudl @($src.FullName)
+        foreach ($repr in @("tree", "flat")) {
+            if ((Invoke-Pudl @($ast, "--ast=$repr")) -ne $expected) {
+                Write-Host "FAIL: ${name}: running the AST file (--ast=$repr) differs from running the source"
+                $fail = $true
+            }
+        }
+
+        if ((Invoke-Pudl @($ast, "-O0", "-p")) -ne (Invoke-Pudl @($src.FullName, "-O0", "-p"))) {
+            Write-Host "FAIL: ${name}: the AST file generates different IR from the source"
+            $fail = $true
+        }
+
+        $again = Join-Path $workDir "again.pudlast"
+        Remove-Item -Path $again -ErrorAction SilentlyContinue
+        Invoke-Pudl @($ast, "--emit-ast", $again) | Out-Null
+        if (-not (Test-Path $again) -or
+                (Get-FileHash $ast).Hash -ne (Get-FileHash $again).Hash) {
+            Write-Host "FAIL: ${name}: emitting the AST file again did not write the same bytes"
+            $fail = $true
+        }
+    }
+
+    # Every example's file is well over 64 bytes.
+    $truncated = Join-Path $workDir "truncated.pudlast"
+    $bytes = [System.IO.File]::ReadAllBytes((Join-Path $workDir "main.pudlast"))
+    [System.IO.File]::WriteAllBytes($truncated, $bytes[0..63])
+    $output = Invoke-Pudl @($truncated)
+    $code = $LASTEXITCODE
+    if ($code -eq 0 -or -not $output.Contains("ERROR@AST")) {
+        Write-Host "FAIL: a truncated AST file was not refused (exit code $code)"
+        $fail = $true
+    }
+
+    if ($fail) { exit 1 }
+    Write-Host "PASS: $count examples round-trip through --emit-ast; a truncated file is refused"
+    exit 0
+} finally {
+    Pop-Location
+    Remove-Item -Recurse -Force $workDir -ErrorAction SilentlyContinue
+}
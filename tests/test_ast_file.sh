@@ -0,0 +1,79 @@
+#!/bin/bash
+# Round trip through --emit-ast (Parser/ASTFile.h) for every example: the
+# AST file, given to pudl in place of the source, must run with the same
+# output -- loaded as a tree (the default) and as a FlatAST (--ast=flat)
+# -- and generate the same IR; emitting it again from the AST file must
+# write the very same bytes. A truncated file must be refused, not read
+# past its end.
+#
+# Usage: test_ast_file.sh <path-to-pudl-binary>
+
+set -u
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+
+if [ "$#" -lt 1 ]; then
+  echo "Usage: $0 <path-to-pudl-binary>" >&2
+  exit 2
+fi
+
+BIN="$1"
+cd "$REPO_ROOT"
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# pudl's output, less the "Loading ... file" line -- the one line that
+# says which kind of file it was given.
+run() {
+  timeout 60 "$BIN" "$@" 2>&1 | grep -v '^Loading '
+}
+
+fail=0
+count=0
+
+for src in examples/*.pudl; do
+  name="$(basename "$src" .pudl)"
+  ast="$WORK_DIR/$name.pudlast"
+  count=$((count + 1))
+
+  if ! timeout 60 "$BIN" "$src" --emit-ast "$ast" >/dev/null 2>&1 || [ ! -s "$ast" ]; then
+    echo "FAIL: $name: --emit-ast did not write an AST file"
+    fail=1
+    continue
+  fi
+
+  expected="$(run "$src")"
+  for repr in tree flat; do
+    if [ "$(run "$ast" --ast=$repr)" != "$expected" ]; then
+      echo "FAIL: $name: running the AST file (--ast=$repr) differs from running the source"
+      fail=1
+    fi
+  done
+
+  if [ "$(run "$ast" -O0 -p)" != "$(run "$src" -O0 -p)" ]; then
+    echo "FAIL: $name: the AST file generates different IR from the source"
+    fail=1
+  fi
+
+  if ! timeout 60 "$BIN" "$ast" --emit-ast "$WORK_DIR/again.pudlast" >/dev/null 2>&1 \
+      || ! cmp -s "$ast" "$WORK_DIR/again.pudlast"; then
+    echo "FAIL: $name: emitting the AST file again did not write the same bytes"
+    fail=1
+  fi
+done
+
+# Every example's file is well over 64 bytes.
+head -c 64 "$WORK_DIR/main.pudlast" > "$WORK_DIR/truncated.pudlast"
+output="$(timeout 60 "$BIN" "$WORK_DIR/truncated.pudlast" 2>&1)"
+status=$?
+if [ "$status" -eq 0 ] || [ "$status" -ge 124 ] || [[ "$output" != *"ERROR@AST"* ]]; then
+  echo "FAIL: a truncated AST file was not refused (exit code $status)"
+  fail=1
+fi
+
+if [ "$fail" -eq 0 ]; then
+  echo "PASS: $count examples round-trip through --emit-ast; a truncated file is refused"
+fi
+exit $fail
@@ -11,50 +11,89 @@ param(
 $ScriptDir = Split-Path -Parent $MyInvocation.MyCommand.Path
 $RepoRoot = Split-Path -Parent $ScriptDir
 
+# Runs pudl, returning its combined output. See run_golden_tests.ps1's
+# Invoke-Pudl for why this goes through cmd.exe rather than PowerShell's
+# own `&`-plus-redirection -- also means we actually get to see what went
+# wrong below, instead of silently discarding it.
+function Invoke-Pudl([string[]]$PudlArgs) {
+    $quoted = (@($Bin) + $PudlArgs) | ForEach-Object { '"' + $_ + '"' }
+    $cmdLine = $quoted -join ' '
+    return (cmd /c "$cmdLine 2>&1") -join "`n"
+}
+
 Push-Location $RepoRoot
 try {
     $outExe = Join-Path $RepoRoot "pudl_test_compile_and_link_exe.exe"
-    Remove-Item -Path $outExe -ErrorAction SilentlyContinue
-    Remove-Item -Path "temp_*.o", "TempLinker_*.cpp" -ErrorAction SilentlyContinue
-
-    # See run_golden_tests.ps1's Invoke-Pudl for why this goes through
-    # cmd.exe rather than PowerShell's own `&`-plus-redirection -- also
-    # means we actually get to see what went wrong below, instead of
-    # silently discarding it.
-    $quoted = @($Bin, "examples/main.pudl", "-o", "pudl_test_compile_and_link_exe") | ForEach-Object { '"' + $_ + '"' }
-    $cmdLine = $quoted -join ' '
-    $buildOutput = (cmd /c "$cmdLine 2>&1") -join "`n"
-
-    if (-not (Test-Path $outExe)) {
-        Write-Host "FAIL: -o did not produce a runnable executable"
-        Write-Host "--- pudl output ---"
-        Write-Host $buildOutput
+    $outObj = "pudl_test_compile_and_link.o"
+    function Remove-Outputs {
         Remove-Item -Path $outExe -ErrorAction SilentlyContinue
-    Remove-Item -Path "temp_*.o", "TempLinker_*.cpp" -ErrorAction SilentlyContinue
-        exit 1
+        Remove-Item -Path $outObj -ErrorAction SilentlyContinue
+        Remove-Item -Path "temp_*.o" -ErrorAction SilentlyContinue
     }
 
-    $actual = ((& $outExe | Out-String) -replace "`r`n", "`n").TrimEnd("`n")
-    # The linker's generated wrapper (see Linker.h) is `int main() {
-    # std::cout << mast() << std::endl; }` -- mast()'s own return value (0)
-    # is always printed as a trailing line on top of whatever mast() itself
-    # printed.
+    # The executable's `main` (Codegen::emitEntryPoint()) prints mast()'s
+    # own return value (0) as a trailing line on top of whatever mast()
+    # itself printed.
     $expected = "1`n10`n0"
 
-    Remove-Item -Path $outExe -ErrorAction SilentlyContinue
-    Remove-Item -Path "temp_*.o", "TempLinker_*.cpp" -ErrorAction SilentlyContinue
+    # Each entry: a label and the pudl invocations that build the
+    # executable. -j N compiles the module in several pieces at once
+    # (Codegen::emitObjects()): -o links them all, -c first combines them
+    # into the one object file asked for.
+    $cases = @(
+        @{ Label = "-o"; Runs = @(,@("examples/main.pudl", "-o", "pudl_test_compile_and_link_exe")) },
+        @{ Label = "-j 4 -o"; Runs = @(,@("examples/main.pudl", "-j", "4", "-o", "pudl_test_compile_and_link_exe")) },
+        @{ Label = "-j 4 -c, then -o"; Runs = @(
+            @("examples/main.pudl", "-j", "4", "-c", $outObj),
+            @($outObj, "-o", "pudl_test_compile_and_link_exe")
+        ) }
+    )
 
-    if ($actual -ne $expected) {
-        Write-Host "FAIL: compiled+linked executable produced wrong output"
-        Write-Host "--- expected ---"
-        Write-Host $expected
-        Write-Host "--- actual ---"
-        Write-Host $actual
-        exit 1
+    # Each twice: the first run stores the object file(s) in the cache,
+    # the second writes or links them from there without compiling
+    # anything (Compiler/CompilationCache.h).
+    $cacheDir = Join-Path ([System.IO.Path]::GetTempPath()) ("pudl-cache-" + [System.Guid]::NewGuid())
+    foreach ($run in @("stored in", "from")) {
+        $cases += @{ Label = "-o ($run --cache-dir)"; Runs = @(,@("examples/main.pudl", "--cache-dir=$cacheDir", "-o", "pudl_test_compile_and_link_exe")) }
+        $cases += @{ Label = "-j 4 -c ($run --cache-dir), then -o"; Runs = @(
+            @("examples/main.pudl", "--cache-dir=$cacheDir", "-j", "4", "-c", $outObj),
+            @($outObj, "-o", "pudl_test_compile_and_link_exe")
+        ) }
     }
 
-    Write-Host "PASS: -o compile+link+run produced the correct output"
+    foreach ($case in $cases) {
+        Remove-Outputs
+        $buildOutput = ""
+        foreach ($run in $case.Runs) {
+            $buildOutput += (Invoke-Pudl $run) + "`n"
+        }
+
+        if (-not (Test-Path $outExe)) {
+            Write-Host "FAIL: $($case.Label) did not produce a runnable executable"
+            Write-Host "--- pudl output ---"
+            Write-Host $buildOutput
+            Remove-Outputs
+            exit 1
+        }
+
+        $actual = ((& $outExe | Out-String) -replace "`r`n", "`n").TrimEnd("`n")
+        Remove-Outputs
+
+        if ($actual -ne $expected) {
+            Write-Host "FAIL: $($case.Label): compiled+linked executable produced wrong output"
+            Write-Host "--- expected ---"
+            Write-Host $expected
+            Write-Host "--- actual ---"
+            Write-Host $actual
+            exit 1
+        }
+    }
+
+    Write-Host "PASS: -o and -j 4 -o/-c compile+link+run produced the correct output, with and without a cache"
     exit 0
 } finally {
     Pop-Location
+    if ($cacheDir -and (Test-Path $cacheDir)) {
+        Remove-Item -Recurse -Force $cacheDir
+    }
 }
@@ -5,7 +5,7 @@
 # relied on a hardcoded "clang++-13" linker name that doesn't exist once the
 # installed LLVM/Clang version differs -- neither of which the golden-file
 # suite exercises, since that only runs the default `pudl file.pudl`
-# (interpret-via-lli) path.
+# (JIT-and-run) path.
 #
 # Usage: test_compile_and_link.sh <path-to-pudl-binary>
 
@@ -23,34 +23,64 @@ BIN="$1"
 cd "$REPO_ROOT"
 
 OUT_EXE="./pudl_test_compile_and_link_exe"
-rm -f "$OUT_EXE" temp_*.o TempLinker_*.cpp
+OUT_OBJ="./pudl_test_compile_and_link.o"
+cleanup() {
+  rm -f "$OUT_EXE" "$OUT_OBJ" temp_*.o
+}
 
-"$BIN" examples/main.pudl -o "$OUT_EXE" >/dev/null 2>&1
-
-if [ ! -x "$OUT_EXE" ]; then
-  echo "FAIL: -o did not produce a runnable executable"
-  rm -f "$OUT_EXE" temp_*.o TempLinker_*.cpp
-  exit 1
-fi
-
-actual="$("$OUT_EXE")"
-# The linker's generated wrapper (see Linker.h) is `int main() { std::cout
-# << mast() << std::endl; }` -- mast()'s own return value (0) is always
-# printed as a trailing line on top of whatever mast() itself printed.
+# The executable's `main` (Codegen::emitEntryPoint()) prints mast()'s own
+# return value (0) as a trailing line on top of whatever mast() itself
+# printed.
 expected="1
 10
 0"
 
-rm -f "$OUT_EXE" temp_*.o TempLinker_*.cpp
+# Builds $OUT_EXE with the given pudl invocation(s), runs it, and checks
+# its output. -j N compiles the module in several pieces at once
+# (Codegen::emitObjects()): -o links them all, -c first combines them into
+# the one object file asked for.
+check() {
+  local label="$1"
+  shift
+  cleanup
+  "$@" >/dev/null 2>&1
 
-if [ "$actual" != "$expected" ]; then
-  echo "FAIL: compiled+linked executable produced wrong output"
-  echo "--- expected ---"
-  echo "$expected"
-  echo "--- actual ---"
-  echo "$actual"
-  exit 1
-fi
+  if [ ! -x "$OUT_EXE" ]; then
+    echo "FAIL: $label did not produce a runnable executable"
+    cleanup
+    exit 1
+  fi
+
+  local actual
+  actual="$("$OUT_EXE")"
+  cleanup
+
+  if [ "$actual" != "$expected" ]; then
+    echo "FAIL: $label: compiled+linked executable produced wrong output"
+    echo "--- expected ---"
+    echo "$expected"
+    echo "--- actual ---"
+    echo "$actual"
+    exit 1
+  fi
+}
+
+check "-o" "$BIN" examples/main.pudl -o "$OUT_EXE"
+check "-j 4 -o" "$BIN" examples/main.pudl -j 4 -o "$OUT_EXE"
+check "-j 4 -c, then -o" \
+  bash -c '"$1" examples/main.pudl -j 4 -c "$2" && "$1" "$2" -o "$3"' _ "$BIN" "$OUT_OBJ" "$OUT_EXE"
+
+# Each twice: the first run stores the object file(s) in the cache, the
+# second writes or links them from there without compiling anything
+# (Compiler/CompilationCache.h).
+CACHE_DIR="$(mktemp -d)"
+trap 'rm -rf "$CACHE_DIR"' EXIT
+for run in "stored in" "from"; do
+  check "-o ($run --cache-dir)" "$BIN" examples/main.pudl --cache-dir="$CACHE_DIR" -o "$OUT_EXE"
+  check "-j 4 -c ($run --cache-dir), then -o" \
+    bash -c '"$1" examples/main.pudl --cache-dir="$4" -j 4 -c "$2" && "$1" "$2" -o "$3"' \
+    _ "$BIN" "$OUT_OBJ" "$OUT_EXE" "$CACHE_DIR"
+done
 
-echo "PASS: -o compile+link+run produced the correct output"
+echo "PASS: -o and -j 4 -o/-c compile+link+run produced the correct output, with and without a cache"
 exit 0
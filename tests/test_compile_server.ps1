@@ -0,0 +1,33 @@
+# Test for `pudl --serve` / `pudl --client`. See test_compile_server.sh for
+# the full test; the server needs fork(), so on Windows all there is to
+# check is that both say they aren't supported and fail, rather than
+# hanging or being taken for a source file.
+#
+# Usage: test_compile_server.ps1 -Bin <path-to-pudl-binary>
+
+param(
+    [Parameter(Mandatory = $true)]
+    [string]$Bin
+)
+
+$ScriptDir = Split-Path -Parent $MyInvocation.MyCommand.Path
+$RepoRoot = Split-Path -Parent $ScriptDir
+
+$fail = $false
+Push-Location $RepoRoot
+try {
+    foreach ($mode in @("--serve", "--client")) {
+        $output = (& $Bin $mode examples/main.pudl 2>&1 | Out-String)
+        if ($LASTEXITCODE -eq 0 -or $output -notmatch "isn't supported on Windows") {
+            Write-Host "FAIL: pudl $mode on Windows didn't report itself unsupported (exit code $LASTEXITCODE)"
+            Write-Host $output
+            $fail = $true
+        }
+    }
+} finally {
+    Pop-Location
+}
+
+if ($fail) { exit 1 }
+Write-Host "PASS: --serve and --client report themselves unsupported on Windows"
+exit 0
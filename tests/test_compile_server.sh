@@ -0,0 +1,144 @@
+#!/bin/bash
+# Test for `pudl --serve` / `pudl --client` (Compiler/CompileServer.h): a
+# request forwarded to a server must behave exactly like running `pudl`
+# directly with the same arguments -- same output, same exit code, paths
+# relative to the client's working directory -- including with several
+# clients at once. And a server run by another user must get nothing from
+# a client: not its terminal, nor its socket path.
+#
+# Usage: test_compile_server.sh <path-to-pudl-binary> [<path-to-pudl_client>]
+
+set -u
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+
+if [ "$#" -lt 1 ]; then
+  echo "Usage: $0 <path-to-pudl-binary> [<path-to-pudl_client>]" >&2
+  exit 2
+fi
+
+BIN="$1"
+CLIENT_BIN="${2:-}"
+cd "$REPO_ROOT"
+
+WORK_DIR="$(mktemp -d)"
+SOCKET="$WORK_DIR/pudl.sock"
+SERVER_PID=""
+OTHER_PID=""
+cleanup() {
+  for pid in $SERVER_PID $OTHER_PID; do
+    kill "$pid" 2>/dev/null
+    wait "$pid" 2>/dev/null
+  done
+  rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+"$BIN" --serve --socket="$SOCKET" --workers=4 >/dev/null 2>&1 &
+SERVER_PID=$!
+for _ in $(seq 100); do
+  [ -S "$SOCKET" ] && break
+  sleep 0.1
+done
+if [ ! -S "$SOCKET" ]; then
+  echo "FAIL: pudl --serve never created its socket"
+  exit 1
+fi
+
+fail() {
+  echo "FAIL: $1"
+  exit 1
+}
+
+# A client's output and exit code, as one string.
+run() {
+  "$@" 2>&1
+  echo "exit code $?"
+}
+
+# Both ways to be a client: the pudl binary itself, and the LLVM-free one.
+clients=("$BIN --client")
+if [ -n "$CLIENT_BIN" ]; then
+  clients+=("$CLIENT_BIN")
+fi
+
+for client in "${clients[@]}"; do
+  for example in examples/main.pudl examples/ex1.pudl examples/ex7.pudl; do
+    expected="$(run "$BIN" "$example")"
+    actual="$(run $client --socket="$SOCKET" "$example")"
+    if [ "$expected" != "$actual" ]; then
+      echo "--- expected ---"
+      echo "$expected"
+      echo "--- actual ---"
+      echo "$actual"
+      fail "$client $example differs from running pudl directly"
+    fi
+  done
+
+  # An error, and its exit code, come back the same way.
+  expected="$(run "$BIN" does_not_exist.pudl)"
+  actual="$(run $client --socket="$SOCKET" does_not_exist.pudl)"
+  [ "$expected" == "$actual" ] || fail "$client with a missing file: got '$actual', expected '$expected'"
+
+  # Several clients at once, each of them getting its own output.
+  for i in 1 2 3 4 5 6 7 8; do
+    run $client --socket="$SOCKET" "examples/ex$i.pudl" >"$WORK_DIR/client$i.txt" &
+  done
+  wait $(jobs -p | grep -v "^$SERVER_PID$")
+  for i in 1 2 3 4 5 6 7 8; do
+    expected="$(run "$BIN" "examples/ex$i.pudl")"
+    [ "$expected" == "$(cat "$WORK_DIR/client$i.txt")" ] \
+      || fail "$client examples/ex$i.pudl, run alongside 7 others, differs from running pudl directly"
+  done
+
+  # Relative paths are the client's: compile and link from another directory.
+  rm -f "$WORK_DIR/main" "$WORK_DIR/main.o"
+  (cd "$WORK_DIR" && $client --socket="$SOCKET" "$REPO_ROOT/examples/main.pudl" -c main.o >/dev/null 2>&1 \
+    && $client --socket="$SOCKET" main.o -o main >/dev/null 2>&1)
+  [ -x "$WORK_DIR/main" ] || fail "$client -c/-o didn't produce $WORK_DIR/main"
+  [ "$("$WORK_DIR/main")" == "$(printf '1\n10\n0')" ] || fail "$client -c/-o produced a program with the wrong output"
+done
+
+# No server: the client says so, and fails.
+if "$BIN" --client --socket="$WORK_DIR/nobody.sock" examples/main.pudl >/dev/null 2>&1; then
+  fail "pudl --client succeeded with no server listening"
+fi
+
+# A server run by another user (nobody), on a socket it created first:
+# the client must refuse to send it anything, and --serve must refuse to
+# take the path over. Being another user takes root, so only as root.
+if [ "$(id -u)" -eq 0 ] && command -v setpriv >/dev/null; then
+  OTHER_DIR="$WORK_DIR/other"
+  OTHER_SOCKET="$OTHER_DIR/pudl.sock"
+  mkdir "$OTHER_DIR"
+  chmod 711 "$WORK_DIR"
+  chown 65534:65534 "$OTHER_DIR"
+  setpriv --reuid=65534 --regid=65534 --clear-groups "$BIN" --serve --socket="$OTHER_SOCKET" --workers=1 \
+    >/dev/null 2>&1 &
+  OTHER_PID=$!
+  for _ in $(seq 100); do
+    [ -S "$OTHER_SOCKET" ] && break
+    sleep 0.1
+  done
+  [ -S "$OTHER_SOCKET" ] || fail "pudl --serve as another user never created its socket"
+
+  for client in "${clients[@]}"; do
+    output="$($client --socket="$OTHER_SOCKET" examples/main.pudl 2>&1)"
+    status=$?
+    if [ "$status" -eq 0 ] || [[ "$output" != *"is run by another user"* ]]; then
+      fail "$client sent its request to another user's server (exit code $status): $output"
+    fi
+  done
+
+  output="$("$BIN" --serve --socket="$OTHER_SOCKET" 2>&1)"
+  status=$?
+  if [ "$status" -eq 0 ] || [[ "$output" != *"belongs to another user"* ]]; then
+    fail "pudl --serve took over another user's socket (exit code $status): $output"
+  fi
+else
+  echo "NOTE: not root, so a server run by another user isn't checked"
+fi
+
+echo "PASS: requests through pudl --serve behave like running pudl directly"
+exit 0
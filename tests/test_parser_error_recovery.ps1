@@ -80,5 +80,7 @@ if (-not (Test-NoCrash "variable redeclaration" "tests/regression/variable_redec
         "is already declared")) { $fail = $true }
 if (-not (Test-NoCrash "if with non-bool condition" "tests/regression/if_non_bool_condition.pudl" `
         "expected boolean expression")) { $fail = $true }
+if (-not (Test-NoCrash "UTF-8 comment is still source" "tests/regression/utf8_comment.pudl" `
+        "Loading source file" "Loading object file")) { $fail = $true }
 
 if ($fail) { exit 1 } else { exit 0 }
@@ -36,6 +36,9 @@
 # bug it exposed once fixed -- see examples/ex15.pudl and ex16.pudl --
 # aren't error-path regressions, so they're golden-file examples
 # instead of checks here.)
+# tests/regression/utf8_comment.pudl is a valid program with a UTF-8
+# comment, which main() used to mistake for an object file (any byte above
+# 127 meant "binary") -- it must load as source and run.
 #
 # Usage: test_parser_error_recovery.sh <path-to-pudl-binary>
 
@@ -105,5 +108,7 @@ check "variable redeclaration" "tests/regression/variable_redeclaration.pudl" \
   "is already declared"
 check "if with non-bool condition" "tests/regression/if_non_bool_condition.pudl" \
   "expected boolean expression"
+check "UTF-8 comment is still source" "tests/regression/utf8_comment.pudl" \
+  "Loading source file" "Loading object file"
 
 exit $fail